@@ -59,8 +59,6 @@ std::vector<std::vector< ts::TrainingData<float> >> readCifar(
 	// Generate the ts::TrainingData
 	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> image;
 	image.resize(IMAGE_HEIGHT, IMAGE_WIDTH);
-	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> label;
-	label.resize(10, 1);
 
 	for(unsigned i=0; i<nBatches; i++) {
 		data.push_back({});
@@ -75,13 +73,9 @@ std::vector<std::vector< ts::TrainingData<float> >> readCifar(
 				}
 			}
 
-			// Initialize Eigen Array for label
-			label.setZero(10, 1);
-			label(rawLabels[i * batchSize + j], 0) = 1.0f;
-
-			// Push a new ts::TrainingData
+			// Push a new ts::TrainingData (labeled with the class index)
 			data[i].push_back(
-				ts::TrainingData<float>(image, label)
+				ts::TrainingData<float>(image, (unsigned) rawLabels[i * batchSize + j])
 			);
 		}
 	}
@@ -250,6 +244,7 @@ int main(int argc, char *argv[]) {
 		// Dense layers (with output vector & not including first layer)
 		{256, 128, N_CLASSES}
 	);
+	model.finalActivation = &(ts::identity);
 	model.toggleGlobalOptimize(true);
 
 
@@ -278,7 +273,8 @@ int main(int argc, char *argv[]) {
 			testingData[i].input, &(model.wList)
 		);
 
-		ts::Tensor<float> result_ = model.compute(input);
+		// The model outputs logits
+		ts::Tensor<float> result_ = ts::softmax(model.compute(input));
 
 		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> result =
 		result_.getValue();
@@ -292,13 +288,8 @@ int main(int argc, char *argv[]) {
 		asciiCifar(testingData[i].input);
 
 		// Display label (expected output)
-		unsigned label = 0;
-		for(unsigned j=0; j<10; j++) {
-			if(testingData[i].expected(j, 0) == 1.0f) {
-				std::cout << "Label :" << classes[j] << std::endl;
-				label = j;
-			}
-		}
+		unsigned label = testingData[i].label;
+		std::cout << "Label :" << classes[label] << std::endl;
 
 
 		// Display prediction
@@ -126,8 +126,6 @@ std::vector<std::vector< ts::TrainingData<float> >> readMnist(
 	// Generate the ts::TrainingData
 	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> image;
 	image.resize(imageSize, 1);
-	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> label;
-	label.resize(10, 1);
 
 	for(unsigned i=0; i<nBatches; i++) {
 		data.push_back({});
@@ -139,13 +137,9 @@ std::vector<std::vector< ts::TrainingData<float> >> readMnist(
 				image(k, 0) = (float) rawImages[i * batchSize + j][k] / 255.0f;
 			}
 
-			// Initialize Eigen Array for label
-			label.setZero(10, 1);
-			label(rawLabels[i * batchSize + j], 0) = 1.0f;
-
-			// Push a new ts::TrainingData
+			// Push a new ts::TrainingData (labeled with the class index)
 			data[i].push_back(
-				ts::TrainingData<float>(image, label)
+				ts::TrainingData<float>(image, (unsigned) rawLabels[i * batchSize + j])
 			);
 		}
 	}
@@ -301,6 +295,7 @@ int main(int argc, char *argv[]) {
 
 	std::cout << "Creating model..." << std::endl;
 	ts::MultiLayerPerceptron<float> model(EXPECTED_IMAGE_SIZE, layers);
+	model.finalActivation = &(ts::identity);
 	model.toggleGlobalOptimize(true);
 
 	// Adam optimizer is now the default one
@@ -330,7 +325,8 @@ int main(int argc, char *argv[]) {
 			testingData[i].input, &(model.wList)
 		);
 
-		ts::Tensor<float> result_ = model.compute(input);
+		// The model outputs logits
+		ts::Tensor<float> result_ = ts::softmax(model.compute(input));
 
 		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> result =
 		result_.getValue();
@@ -348,13 +344,8 @@ int main(int argc, char *argv[]) {
 		asciiDigit(testingData[i].input);
 
 		// Display label (expected output)
-		unsigned label = 0;
-		for(unsigned j=0; j<10; j++) {
-			if(testingData[i].expected(j, 0) == 1.0f) {
-				std::cout << "Label :" << j << std::endl;
-				label = j;
-			}
-		}
+		unsigned label = testingData[i].label;
+		std::cout << "Label :" << label << std::endl;
 
 
 		// Display prediction
@@ -104,57 +104,18 @@ Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> rcnn(
 	// This will return the probability matrix for the image (each cell
 	// corresponds to the probability of having a vehicle in the
 	// region). The strides parameter defines the shift between each
-	// CNN forward pass. This will be help to reduce calculations despite
-	// our naive approach.
+	// region. The convolution features are computed once for the whole image
+	// and shared by overlapping regions whenever the model allows it.
 
-	unsigned width = img.cols();
-	unsigned height = img.rows() / 3;
+	std::vector<Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>> probabilities =
+	cnn.computeDense(img, {IMAGE_HEIGHT, IMAGE_WIDTH}, strides);
 
-	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> res;
-
-	// Get number of CNN forward passes to perform in order to resize res
-	unsigned nxPass = (height - IMAGE_WIDTH) / strides[0];
-	unsigned nyPass = (width - IMAGE_WIDTH) / strides[1];
-
-	res.resize(nxPass, nyPass);
-
-
-	// Perform CNN forward passes over img
-
-	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> submat;
-	submat.resize(IMAGE_HEIGHT, IMAGE_WIDTH);
-
-	for(unsigned i=0; i<nxPass; i++) {
-		for(unsigned j=0; j<nyPass; j++) {
-			// Get coords of area's top-left corner
-			unsigned x = i * strides[0];
-			unsigned y = j * strides[1];
-
-			// Prepare submatrix with 3 channels
-			// R
-			submat.block(0, 0, IMAGE_WIDTH, IMAGE_WIDTH) =
-			img.block(x, y, IMAGE_WIDTH, IMAGE_WIDTH);
-			// G
-			submat.block(IMAGE_WIDTH, 0, IMAGE_WIDTH, IMAGE_WIDTH) =
-			img.block(height + x, y, IMAGE_WIDTH, IMAGE_WIDTH);
-			// B
-			submat.block(2 * IMAGE_WIDTH, 0, IMAGE_WIDTH, IMAGE_WIDTH) =
-			img.block(2 * height + x, y, IMAGE_WIDTH, IMAGE_WIDTH);
-
-			// Create tensor & perform forward pass
-			ts::Tensor<float> base = ts::Tensor<float>(
-				submat,
-				&(cnn.wList)
-			);
-
-			ts::Tensor<float> prob = cnn.compute(base);
-			cnn.wList.reset();
-
-			res(i, j) = prob.getValue()(0, 0);
-		}
+	if(probabilities.size() == 0) {
+		return Eigen::Array<float, 0, 0>();
 	}
 
-	return res;
+	// First output is the probability of having a vehicle
+	return probabilities[0];
 }
 
 
@@ -235,21 +196,8 @@ int main(void) {
 
 		// Import the pre-trained CNN
 
-	ts::ConvolutionalNetwork<float> model(
-		// Input
-		{IMAGE_HEIGHT, IMAGE_WIDTH},
-
-		// Number of channels for input (3 for RGB)
-		ts::ChannelSplit::SPLIT_HOR, 3,
-
-		// Convolution / pooling
-		{{3, 3, 32}, {5, 5, 16}},
-		{{0,0}, {2, 2}},
-
-		// Dense layers (with output vector & not including first layer)
-		{128, 64, N_CLASSES, 1}
-	);
-	model.load("examples/rcnn.ts");
+	ts::ConvolutionalNetwork<float> model =
+	ts::ConvolutionalNetwork<float>::fromFile("examples/rcnn.ts");
 	// model.toggleGlobalOptimize(true);
 	std::cout << "Imported the CNN ..." << std::endl;
 
@@ -11,6 +11,8 @@
 
 #include <Eigen/Dense>
 
+#include "kernels.hpp"
+
 
 
 namespace ts {
@@ -19,6 +21,12 @@ namespace ts {
 	template <typename T> class ElementWiseNode;
 	template <typename T> class MatProdNode;
 	template <typename T> class ScalarNode;
+	template <typename T> class BroadcastNode;
+	template <typename T> class BatchNormNode;
+	template <typename T> class SoftmaxNode;
+	template <typename T> class ReluNode;
+	template <typename T> class SigmoidNode;
+	template <typename T> class TanhNode;
 
 	template <typename T> class WengertList;
 	template <typename T> class Tensor;
@@ -46,6 +54,26 @@ namespace ts {
 
 	template <typename T>
 	ts::Tensor<T> matProd(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	// Adds the column vector y to each column of x
+	template <typename T>
+	ts::Tensor<T> broadcastAdd(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	// Normalizes each row of x with the given (rows, 1) statistics, then
+	// scales and shifts it : scale * (x - mean) / sqrt(variance + epsilon) + shift
+	// (the statistics are constants, only x, scale and shift are derived)
+	template <typename T>
+	ts::Tensor<T> batchNorm(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &mean,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &variance,
+		T epsilon
+	);
+	// Same normalization with the mean and (biased) variance of each row of x,
+	// which are derived as well
+	template <typename T>
+	ts::Tensor<T> batchNorm(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		T epsilon
+	);
 	template <typename T>
 	ts::Tensor<T> sigmoid(const ts::Tensor<T> &x);
 	template <typename T>
@@ -53,9 +81,24 @@ namespace ts {
 	template <typename T>
 	ts::Tensor<T> leakyRelu(const ts::Tensor<T> &x);
 	template <typename T>
+	ts::Tensor<T> tanh(const ts::Tensor<T> &x);
+	// Softmax of each column of x
+	template <typename T>
+	ts::Tensor<T> softmax(const ts::Tensor<T> &x);
+	template <typename T>
 	ts::Tensor<T> rescale(const ts::Tensor<T> &x);
 	template <typename T>
 	ts::Tensor<T> squaredNorm(const ts::Tensor<T> &x);
+	// Cross entropy between softmax(x) and the classes given by labels (one
+	// per column of x), summed over the columns. Computed from the logits x
+	// in a single node, its derivative being softmax(x) - onehot(labels).
+	template <typename T>
+	ts::Tensor<T> softmaxCrossEntropy(
+		const ts::Tensor<T> &x, const std::vector<unsigned> &labels
+	);
+	// Returns x unchanged (final activation of models that output logits)
+	template <typename T>
+	ts::Tensor<T> identity(const ts::Tensor<T> &x);
 
 
 	// Forward declaration of friends
@@ -69,8 +112,23 @@ namespace ts {
 	template <typename T>
 	ts::Tensor<T> convolution(const ts::Tensor<T> &mat, const ts::Tensor<T> &ker);
 
+	// (stride is the pool size by default)
+	template <typename T>
+	ts::Tensor<T> maxPooling(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride = {}, std::vector<unsigned> padding = {0, 0},
+		unsigned nChannels = 1
+	);
+
+	template <typename T>
+	ts::Tensor<T> averagePooling(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride = {}, std::vector<unsigned> padding = {0, 0},
+		unsigned nChannels = 1
+	);
+
 	template <typename T>
-	ts::Tensor<T> maxPooling(const ts::Tensor<T> &x, std::vector<unsigned> pool);
+	ts::Tensor<T> globalAveragePooling(const ts::Tensor<T> &x, unsigned nChannels = 1);
 
 	template <typename T>
 	std::vector<ts::Tensor<T>> split(
@@ -81,14 +139,68 @@ namespace ts {
 
 	template <typename T>
 	ts::Tensor<T> vertCat(const std::vector<ts::Tensor<T>> &x);
+	template <typename T>
+	ts::Tensor<T> horCat(const std::vector<ts::Tensor<T>> &x);
 
 	template <typename T>
 	ts::Tensor<T> flattening(const ts::Tensor<T> &x);
 
+	// (default arguments of the convolution operations are defined here)
 	template <typename T>
 	ts::Tensor<T> im2col(
 		const std::vector<ts::Tensor<T>> &x,
-		std::vector<unsigned> kernelDim
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride = {1, 1},
+		std::vector<unsigned> padding = {0, 0},
+		std::vector<unsigned> dilation = {1, 1}
+	);
+
+	template <typename T>
+	ts::Tensor<T> im2col(
+		const ts::Tensor<T> &x,
+		unsigned nChannels,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride = {1, 1},
+		std::vector<unsigned> padding = {0, 0},
+		std::vector<unsigned> dilation = {1, 1}
+	);
+
+	template <typename T>
+	ts::Tensor<T> implicitConv(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride = {1, 1},
+		std::vector<unsigned> padding = {0, 0},
+		std::vector<unsigned> dilation = {1, 1}
+	);
+
+	template <typename T> class WinogradCache;
+	template <typename T>
+	ts::Tensor<T> winogradConv(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> padding = {0, 0},
+		unsigned outputTile = 2,
+		const ts::WinogradCache<T> * cache = NULL
+	);
+
+	template <typename T>
+	ts::Tensor<T> fftConv(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> padding = {0, 0}
+	);
+
+	template <typename T>
+	ts::Tensor<T> depthwiseConv(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride = {1, 1},
+		std::vector<unsigned> padding = {0, 0},
+		std::vector<unsigned> dilation = {1, 1}
 	);
 
 	template <typename T>
@@ -96,6 +208,21 @@ namespace ts {
 		const ts::Tensor<T> &x,
 		std::vector<unsigned> outputDim
 	);
+
+	template <typename T>
+	ts::Tensor<T> packedCol2im(
+		const ts::Tensor<T> &x,
+		std::vector<unsigned> outputDim
+	);
+
+	template <typename T>
+	ts::Tensor<T> convBlock(
+		const ts::Tensor<T> &conv,
+		const ts::Tensor<T> &bias,
+		std::vector<unsigned> outputDim,
+		std::vector<unsigned> pool,
+		ts::Tensor<T> (*activation)(const ts::Tensor<T>&)
+	);
 }
 
 
@@ -126,6 +253,10 @@ protected:
 
 	std::vector<int> dependencies{};
 
+	// Returns the increment of the derivative of dependencies[j]. It is called
+	// for j = 0, 1, ... in order, so nodes whose increments share most of
+	// their computations can compute all of them on the first call, then
+	// return the stored ones on the following calls.
 	virtual Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
 			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
 			unsigned &j
@@ -149,29 +280,109 @@ public:
 	friend ts::Tensor<T> operator/<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
 
 	friend ts::Tensor<T> matProd<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	friend ts::Tensor<T> broadcastAdd<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &mean,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &variance,
+		T epsilon
+	);
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		T epsilon
+	);
 	friend ts::Tensor<T> sigmoid<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> relu<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> leakyRelu<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> tanh<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> softmax<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> rescale<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> squaredNorm<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> softmaxCrossEntropy<>(
+		const ts::Tensor<T> &x, const std::vector<unsigned> &labels
+	);
 
 	friend ts::Tensor<T> convolution<>(const ts::Tensor<T> &mat, const ts::Tensor<T> &ker);
-	friend ts::Tensor<T> maxPooling<>(const ts::Tensor<T> &x, std::vector<unsigned> pool);
+	friend ts::Tensor<T> maxPooling<>(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+	friend ts::Tensor<T> averagePooling<>(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+	friend ts::Tensor<T> globalAveragePooling<>(
+		const ts::Tensor<T> &x, unsigned nChannels
+	);
 	friend std::vector<ts::Tensor<T>> split<>(
 		const ts::Tensor<T> &x,
 		ChannelSplit channelSplit,
 		unsigned nInputChannels
 	);
 	friend ts::Tensor<T> vertCat<>(const std::vector<ts::Tensor<T>> &x);
+	friend ts::Tensor<T> horCat<>(const std::vector<ts::Tensor<T>> &x);
 	friend ts::Tensor<T> flattening<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> im2col<>(
 		const std::vector<ts::Tensor<T>> &x,
-		std::vector<unsigned> kernelDim
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> im2col<>(
+		const ts::Tensor<T> &x,
+		unsigned nChannels,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> implicitConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> winogradConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> padding,
+		unsigned outputTile,
+		const ts::WinogradCache<T> * cache
+	);
+	friend ts::Tensor<T> fftConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> padding
 	);
 	friend std::vector<ts::Tensor<T>> col2im<>(
 		const ts::Tensor<T> &x,
 		std::vector<unsigned> outputDim
 	);
+	friend ts::Tensor<T> packedCol2im<>(
+		const ts::Tensor<T> &x,
+		std::vector<unsigned> outputDim
+	);
+	friend ts::Tensor<T> depthwiseConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> convBlock<>(
+		const ts::Tensor<T> &conv,
+		const ts::Tensor<T> &bias,
+		std::vector<unsigned> outputDim,
+		std::vector<unsigned> pool,
+		ts::Tensor<T> (*activation)(const ts::Tensor<T>&)
+	);
 
 };
 
@@ -256,6 +467,139 @@ private:
 
 
 
+template <typename T>
+class ts::BroadcastNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// No values are needed : the derivative of the vector is the sum of the
+	// child derivative columns
+	BroadcastNode(std::vector<long> shape, int xDep, int yDep);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	friend ts::Tensor<T> broadcastAdd<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+};
+
+
+
+template <typename T>
+class ts::BatchNormNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// values are {normalized x, scale / sqrt(variance + epsilon)}
+	BatchNormNode(
+		std::vector<long> shape,
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> normalized,
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> factor,
+		int xDep, int scaleDep, int shiftDep,
+		bool newBatchStatistics = false
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	// The statistics are the ones of x, so the derivative also flows through
+	// the mean and variance
+	bool batchStatistics;
+
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &mean,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &variance,
+		T epsilon
+	);
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		T epsilon
+	);
+};
+
+
+
+template <typename T>
+class ts::SoftmaxNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// values is {softmax output}, from which the Jacobian of each column is
+	// diag(s) - s.s^T
+	SoftmaxNode(
+		std::vector<long> shape,
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> output, int xDep
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	friend ts::Tensor<T> softmax<>(const ts::Tensor<T> &x);
+};
+
+
+
+template <typename T>
+class ts::ReluNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// The derivative is 1 where x > 0 and slope elsewhere, so it is stored as
+	// a bit-packed mask instead of values
+	ReluNode(
+		std::vector<long> shape, int xDep,
+		std::vector<uint32_t> newMask, T newSlope
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	std::vector<uint32_t> mask;
+	T slope;
+
+	friend ts::Tensor<T> relu<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> leakyRelu<>(const ts::Tensor<T> &x);
+};
+
+
+
+// Sigmoid / tanh nodes keep the activation output (values is {output}), and
+// compute their derivative from it only when a gradient is computed
+
+template <typename T>
+class ts::SigmoidNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+};
+
+
+
+template <typename T>
+class ts::TanhNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+};
+
+
+
 	// ts::WengertList
 
 template <typename T>
@@ -268,6 +612,9 @@ public:
 	int size();
 	int reset();
 
+	// Remove all nodes, including the model ones
+	void clear();
+
 	// Make a tensor optimizable
 	void toggleOptimize(ts::Tensor<T> * tensor, bool enable);
 
@@ -277,29 +624,109 @@ public:
 
 	// Other non-element wise operations (to change elementWiseOnly)
 	friend ts::Tensor<T> matProd<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	friend ts::Tensor<T> broadcastAdd<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &mean,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &variance,
+		T epsilon
+	);
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		T epsilon
+	);
 	friend ts::Tensor<T> sigmoid<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> relu<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> leakyRelu<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> tanh<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> softmax<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> rescale<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> squaredNorm<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> softmaxCrossEntropy<>(
+		const ts::Tensor<T> &x, const std::vector<unsigned> &labels
+	);
 
 	friend ts::Tensor<T> convolution<>(const ts::Tensor<T> &mat, const ts::Tensor<T> &ker);
-	friend ts::Tensor<T> maxPooling<>(const ts::Tensor<T> &x, std::vector<unsigned> pool);
+	friend ts::Tensor<T> maxPooling<>(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+	friend ts::Tensor<T> averagePooling<>(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+	friend ts::Tensor<T> globalAveragePooling<>(
+		const ts::Tensor<T> &x, unsigned nChannels
+	);
 	friend std::vector<ts::Tensor<T>> split<>(
 		const ts::Tensor<T> &x,
 		ChannelSplit channelSplit,
 		unsigned nInputChannels
 	);
 	friend ts::Tensor<T> vertCat<>(const std::vector<ts::Tensor<T>> &x);
+	friend ts::Tensor<T> horCat<>(const std::vector<ts::Tensor<T>> &x);
 	friend ts::Tensor<T> flattening<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> im2col<>(
 		const std::vector<ts::Tensor<T>> &x,
-		std::vector<unsigned> kernelDim
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> im2col<>(
+		const ts::Tensor<T> &x,
+		unsigned nChannels,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> implicitConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> winogradConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> padding,
+		unsigned outputTile,
+		const ts::WinogradCache<T> * cache
+	);
+	friend ts::Tensor<T> fftConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> padding
 	);
 	friend std::vector<ts::Tensor<T>> col2im<>(
 		const ts::Tensor<T> &x,
 		std::vector<unsigned> outputDim
 	);
+	friend ts::Tensor<T> packedCol2im<>(
+		const ts::Tensor<T> &x,
+		std::vector<unsigned> outputDim
+	);
+	friend ts::Tensor<T> depthwiseConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> convBlock<>(
+		const ts::Tensor<T> &conv,
+		const ts::Tensor<T> &bias,
+		std::vector<unsigned> outputDim,
+		std::vector<unsigned> pool,
+		ts::Tensor<T> (*activation)(const ts::Tensor<T>&)
+	);
 };
 
 
@@ -354,29 +781,109 @@ public:
 	friend ts::Tensor<T> operator/<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
 
 	friend ts::Tensor<T> matProd<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	friend ts::Tensor<T> broadcastAdd<>(const ts::Tensor<T> &x, const ts::Tensor<T> &y);
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &mean,
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &variance,
+		T epsilon
+	);
+	friend ts::Tensor<T> batchNorm<>(
+		const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+		T epsilon
+	);
 	friend ts::Tensor<T> sigmoid<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> relu<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> leakyRelu<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> tanh<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> softmax<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> rescale<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> squaredNorm<>(const ts::Tensor<T> &x);
+	friend ts::Tensor<T> softmaxCrossEntropy<>(
+		const ts::Tensor<T> &x, const std::vector<unsigned> &labels
+	);
 
 	friend ts::Tensor<T> convolution<>(const ts::Tensor<T> &mat, const ts::Tensor<T> &ker);
-	friend ts::Tensor<T> maxPooling<>(const ts::Tensor<T> &x, std::vector<unsigned> pool);
+	friend ts::Tensor<T> maxPooling<>(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+	friend ts::Tensor<T> averagePooling<>(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+	friend ts::Tensor<T> globalAveragePooling<>(
+		const ts::Tensor<T> &x, unsigned nChannels
+	);
 	friend std::vector<ts::Tensor<T>> split<>(
 		const ts::Tensor<T> &x,
 		ChannelSplit channelSplit,
 		unsigned nInputChannels
 	);
 	friend ts::Tensor<T> vertCat<>(const std::vector<ts::Tensor<T>> &x);
+	friend ts::Tensor<T> horCat<>(const std::vector<ts::Tensor<T>> &x);
 	friend ts::Tensor<T> flattening<>(const ts::Tensor<T> &x);
 	friend ts::Tensor<T> im2col<>(
 		const std::vector<ts::Tensor<T>> &x,
-		std::vector<unsigned> kernelDim
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> im2col<>(
+		const ts::Tensor<T> &x,
+		unsigned nChannels,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> implicitConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> winogradConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> padding,
+		unsigned outputTile,
+		const ts::WinogradCache<T> * cache
+	);
+	friend ts::Tensor<T> fftConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> padding
 	);
 	friend std::vector<ts::Tensor<T>> col2im<>(
 		const ts::Tensor<T> &x,
 		std::vector<unsigned> outputDim
 	);
+	friend ts::Tensor<T> packedCol2im<>(
+		const ts::Tensor<T> &x,
+		std::vector<unsigned> outputDim
+	);
+	friend ts::Tensor<T> depthwiseConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> convBlock<>(
+		const ts::Tensor<T> &conv,
+		const ts::Tensor<T> &bias,
+		std::vector<unsigned> outputDim,
+		std::vector<unsigned> pool,
+		ts::Tensor<T> (*activation)(const ts::Tensor<T>&)
+	);
 };
 
 
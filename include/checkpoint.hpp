@@ -0,0 +1,47 @@
+/*
+* Asynchronous checkpoint writer : model parameters are copied on the calling
+* thread, then written to a binary file in the background.
+*/
+
+#pragma once
+
+#include "model.hpp"
+#include "serializer.hpp"
+
+#include <string>
+#include <thread>
+
+namespace ts {
+	template <typename T> class CheckpointWriter;
+}
+
+
+
+	// ts::CheckpointWriter
+	// (at most one checkpoint is being written at a time, a new write waits
+	// for the previous one to complete)
+
+template <typename T>
+class ts::CheckpointWriter {
+private:
+	std::thread worker;
+	bool succeeded = true;
+
+	// Writes to a temporary file, flushes it and renames it to filePath
+	static bool writeFile(std::string filePath, ts::ModelSnapshot<T> &snapshot);
+
+public:
+	CheckpointWriter();
+	~CheckpointWriter();
+
+	// Not copyable because of the worker thread
+	CheckpointWriter(const ts::CheckpointWriter<T>&) = delete;
+	ts::CheckpointWriter<T>& operator=(const ts::CheckpointWriter<T>&) = delete;
+
+	// Snapshots the model and starts writing it to filePath
+	void write(ts::Model<T> &model, std::string filePath);
+
+	// Blocks until the current write is over. Returns false if the last
+	// checkpoint could not be written.
+	bool wait();
+};
@@ -11,9 +11,21 @@
 #include <vector>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <complex>
 
 #include <Eigen/Dense>
 
+// NOTE Multi-channel feature maps can be stored either as a vector of
+// channels (one tensor per channel), or as a single packed tensor with all
+// channels stacked vertically (the layout of ts::vertCat of the channels).
+// Packed maps use one node and one buffer for the whole map. In this
+// (channels * rows, cols) col-major layout, channel c is made of cols runs of
+// rows elements, with a stride of the packed map rows between them : im2col
+// reads it in place by taking this stride as the source stride.
+// Packed maps are concatenated along channels with ts::vertCat, and their
+// ts::flattening gives the same vector as the one of the channels vector.
+
 // Enum for channel splitting directions in CNN
 // (declared outside for now because scoped enum declarationb seems
 // impossible)
@@ -24,8 +36,33 @@ enum class ts::ChannelSplit : int {
 };
 
 
+// Size (in bytes) of the packing buffer used by implicitConv for each thread
+// (should fit in the L2 cache)
+#define TS_IMPLICIT_CONV_BUFFER 262144
+
+
 namespace ts {
 
+	// Algorithm used to compute the convolution layers of a CNN
+	enum class ConvAlgorithm : int {
+		IM2COL,	// Materializes the whole im2col matrix (fastest on small inputs)
+		IMPLICIT_GEMM,	// Packs im2col tiles in a small buffer (low memory)
+		WINOGRAD,	// F(4x4, 3x3) for eligible layers (3x3, stride and dilation 1)
+		FFT	// For large kernels (stride and dilation 1)
+	};
+
+	// Type of a CNN convolution layer
+	enum class ConvLayerType : int {
+		STANDARD,
+		DEPTHWISE_SEPARABLE	// Depthwise convolution, then pointwise (1x1)
+	};
+
+	// Pooling operation of a CNN pooling layer
+	enum class PoolingType : int {
+		MAX,
+		AVERAGE	// Padding counts as zeros
+	};
+
 	template <typename T>
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> convArray(
 		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &mat,
@@ -44,23 +81,174 @@ namespace ts {
 		unsigned nInputChannels
 	);
 
+	// Pools of size pool, with stride and padding given for both dimensions
+	// {rows, cols}. The pools must cover the padded matrix exactly (see
+	// ts::poolingOutputSize). Padding is never selected by max pooling.
+	// If x is a packed map of nChannels channels, each channel is pooled
+	// separately and the result is a packed map.
 	template <typename T> class PoolingNode;
 	template <typename T>
-	ts::Tensor<T> maxPooling(const ts::Tensor<T> &x, std::vector<unsigned> pool);
+	ts::Tensor<T> maxPooling(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+
+	template <typename T> class AveragePoolingNode;
+	template <typename T>
+	ts::Tensor<T> averagePooling(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+
+	// Mean of each channel of a packed map, as a (nChannels, 1) vector
+	template <typename T> class GlobalAveragePoolingNode;
+	template <typename T>
+	ts::Tensor<T> globalAveragePooling(const ts::Tensor<T> &x, unsigned nChannels);
 
 	template <typename T> class VertCatNode;
 	template <typename T>
 	ts::Tensor<T> vertCat(const std::vector<ts::Tensor<T>> &x);
 
+	// Horizontal concatenation (x[i] is on the right of x[i-1]), used to
+	// compute several inputs side by side. A single tensor is returned as is.
+	template <typename T> class HorCatNode;
+	template <typename T>
+	ts::Tensor<T> horCat(const std::vector<ts::Tensor<T>> &x);
+
 	template <typename T> class FlatteningNode;
 	template <typename T>
 	ts::Tensor<T> flattening(const ts::Tensor<T> &x);
 
+	// Low level im2col kernels on col-major buffers (with leading dimensions
+	// srcStride / dstStride), for the output rows [rowBegin, rowEnd) of one
+	// channel. Both point to the element of the first output row.
+	// im2colPack writes the patches of the channel in dst, im2colScatter adds
+	// the patches derivatives in src back to the channel derivative in dst
+	// (output rows must not overlap when it is called in parallel).
+	template <typename T>
+	void im2colPack(
+		const T * src, long srcStride,
+		const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+		T * dst, long dstStride
+	);
+	template <typename T>
+	void im2colScatter(
+		const T * src, long srcStride,
+		const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+		T * dst, long dstStride
+	);
+
+	// Low level pooling kernels on col-major buffers, for the output columns
+	// [colBegin, colEnd) of one channel. src points to the first element of
+	// the channel, dst to the element of its first output row and column.
+	// maxPoolKernel also writes the position (row + col * srcStride) of the
+	// max of each pool in src, with the same layout as dst.
+	template <typename T>
+	void maxPoolKernel(
+		const T * src, long srcStride,
+		const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+		T * dst, long * argmax, long dstStride
+	);
+	template <typename T>
+	void averagePoolKernel(
+		const T * src, long srcStride,
+		const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+		T * dst, long dstStride
+	);
+
 	template <typename T> class Im2ColNode;
+	// stride, padding (number of zeros added on each side) and dilation are
+	// given for both dimensions {rows, cols}
+	template <typename T>
+	ts::Tensor<T> im2col(
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	// Same for a packed map of nChannels channels
 	template <typename T>
 	ts::Tensor<T> im2col(
+		const ts::Tensor<T> &x,
+		unsigned nChannels,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+
+	template <typename T> class ImplicitConvNode;
+	// Computes matProd(kernel, im2col(x, ...)) without materializing the
+	// im2col matrix (kernel has the shape of a CNN kernels matrix)
+	template <typename T>
+	ts::Tensor<T> implicitConv(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+
+	template <typename T> class WinogradNode;
+	template <typename T> class WinogradCache;
+	// Computes the same result as matProd(kernel, im2col(x, {3, 3}, {1, 1},
+	// padding)) with Winograd's minimal filtering algorithm F(m x m, 3 x 3),
+	// where m = outputTile is 2 or 4. If a cache is given, its kernel
+	// transforms are used when they match the kernel size and outputTile
+	// (see ts::WinogradCache::update).
+	template <typename T>
+	ts::Tensor<T> winogradConv(
+		const ts::Tensor<T> &kernel,
 		const std::vector<ts::Tensor<T>> &x,
-		std::vector<unsigned> kernelDim
+		std::vector<unsigned> padding,
+		unsigned outputTile,
+		const ts::WinogradCache<T> * cache
+	);
+
+	// In-place radix-2 FFT of n elements (n must be a power of 2) separated
+	// by stride, where twiddles[k] = exp(-2i pi k / n) for k < n / 2. Using
+	// the conjugate twiddles gives the (unnormalized) inverse transform.
+	template <typename T>
+	void fft(
+		std::complex<T> * data, long n, long stride,
+		const std::complex<T> * twiddles
+	);
+	// 2D FFT (both dimensions must be powers of 2). The inverse transform is
+	// normalized.
+	template <typename T>
+	void fft2(
+		Eigen::Array<std::complex<T>, Eigen::Dynamic, Eigen::Dynamic> &x,
+		bool inverse
+	);
+
+	template <typename T> class FFTConvNode;
+	// Computes the same result as matProd(kernel, im2col(x, kernelDim, {1, 1},
+	// padding)) with products in the frequency domain
+	template <typename T>
+	ts::Tensor<T> fftConv(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> padding
+	);
+
+	template <typename T> class DepthwiseConvNode;
+	// Convolves each input channel x[i] with its own kernel (row i of kernel,
+	// of size kernelDim[0] * kernelDim[1]). The output has the layout of a
+	// convolution layer output (one row per channel), so a pointwise (1x1)
+	// convolution of it is a matProd.
+	template <typename T>
+	ts::Tensor<T> depthwiseConv(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
 	);
 
 	template <typename T> class Col2ImNode;
@@ -69,6 +257,33 @@ namespace ts {
 		const ts::Tensor<T> &x,
 		std::vector<unsigned> outputDim
 	);
+
+	template <typename T> class PackedCol2ImNode;
+	// Same as vertCat(col2im(x, outputDim)), in a single node
+	template <typename T>
+	ts::Tensor<T> packedCol2im(
+		const ts::Tensor<T> &x,
+		std::vector<unsigned> outputDim
+	);
+
+	template <typename T> class ConvBlockNode;
+	// Fused convolution layer output : computes the same packed map as
+	// maxPooling(packedCol2im(activation(conv + bias), outputDim), pool) in a
+	// single pass over conv, without storing the intermediate maps. bias is
+	// either of the size of conv, or a per-channel column vector. pool is a
+	// pooling layer description {rows, cols, stride, padding, type} (see
+	// ts::ConvolutionalNetwork, only rows and cols are required), and pooling
+	// is skipped if rows or cols is 0. Only non-overlapping max pooling with
+	// relu, leakyRelu or sigmoid is fused, other layers are computed with the
+	// separate operations.
+	template <typename T>
+	ts::Tensor<T> convBlock(
+		const ts::Tensor<T> &conv,
+		const ts::Tensor<T> &bias,
+		std::vector<unsigned> outputDim,
+		std::vector<unsigned> pool,
+		ts::Tensor<T> (*activation)(const ts::Tensor<T>&)
+	);
 }
 
 
@@ -96,9 +311,10 @@ private:
 	using ts::Node<T>::Node;
 
 	PoolingNode(
-		std::vector<long> shape,
-		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> xVal, int xDep,
-		std::vector<unsigned> newPool
+		std::vector<long> shape, int xDep,
+		std::vector<long> newInputShape,
+		std::vector<long> newArgmax,
+		bool newOverlap
 	);
 
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
@@ -106,10 +322,72 @@ private:
 			unsigned &j
 	);
 
-	std::vector<unsigned> pool = {};
+	long inputRows, inputCols;
+
+	// Index (in the col-major input) of the max element of each pool
+	std::vector<long> argmax;
+	bool overlap;	// Several pools can share their max element
 
 	friend ts::Tensor<T> ts::maxPooling<>(
-		const ts::Tensor<T> &x, std::vector<unsigned> pool
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+};
+
+
+
+	// ts::AveragePoolingNode
+
+template <typename T>
+class ts::AveragePoolingNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	AveragePoolingNode(
+		std::vector<long> shape, int xDep,
+		ts::ConvGeometry newGeometry,
+		unsigned newNChannels
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	ts::ConvGeometry geometry;	// Pools are kernels without dilation
+	unsigned nChannels;	// Of the packed input map
+
+	friend ts::Tensor<T> ts::averagePooling<>(
+		const ts::Tensor<T> &x, std::vector<unsigned> pool,
+		std::vector<unsigned> stride, std::vector<unsigned> padding,
+		unsigned nChannels
+	);
+};
+
+
+
+	// ts::GlobalAveragePoolingNode
+
+template <typename T>
+class ts::GlobalAveragePoolingNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	GlobalAveragePoolingNode(
+		std::vector<long> shape, int xDep,
+		std::vector<long> newInputShape
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	long inputRows, inputCols;
+
+	friend ts::Tensor<T> ts::globalAveragePooling<>(
+		const ts::Tensor<T> &x, unsigned nChannels
 	);
 };
 
@@ -174,6 +452,32 @@ private:
 
 
 
+	// ts::HorCatNode
+
+template <typename T>
+class ts::HorCatNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// Same as ts::VertCatNode, with cumulative starting columns
+	HorCatNode(
+		std::vector<long> shape,
+		std::vector<int> newDependencies,
+		std::vector<long> newWidths
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	std::vector<long> widths = {};
+
+	friend ts::Tensor<T> ts::horCat<>(const std::vector<ts::Tensor<T>> &x);
+};
+
+
+
 	// ts::FlatteningNode
 
 template <typename T>
@@ -212,7 +516,10 @@ private:
 		std::vector<int> newDependencies,
 		std::vector<long> newKernelDim,
 		std::vector<long> newMatrixDim,
-		unsigned newNChannels
+		unsigned newNChannels,
+		std::vector<long> newStride,
+		std::vector<long> newPadding,
+		std::vector<long> newDilation
 	);
 
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
@@ -224,14 +531,249 @@ private:
 	std::vector<long> matrixDim = {};	// Size of one channel
 	unsigned nChannels;	// Input nChannels
 
+	std::vector<long> stride = {};
+	std::vector<long> padding = {};
+	std::vector<long> dilation = {};
+
+	// Channels are scattered in parallel into their own increment (a packed
+	// input map is the only parent, and gets a single packed increment)
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> increments = {};
+
 	friend ts::Tensor<T> ts::im2col<>(
 		const std::vector<ts::Tensor<T>> &x,
-		std::vector<unsigned> kernelDim
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+	friend ts::Tensor<T> ts::im2col<>(
+		const ts::Tensor<T> &x,
+		unsigned nChannels,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+};
+
+
+
+	// ts::ImplicitConvNode
+
+template <typename T>
+class ts::ImplicitConvNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// This node can have n parents ! (the kernel, then all input channels,
+	// whose values are kept in this->values)
+	ImplicitConvNode(
+		std::vector<long> shape,
+		std::vector<int> newDependencies,
+		std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> newValues,
+		ts::ConvGeometry newGeometry,
+		long newTileRows
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	ts::ConvGeometry geometry;
+	long tileRows;	// Number of output rows packed at once
+
+	// Input channels increments, all scattered from the same kernel^T * dY
+	// tiles (the kernel increment is computed on its own)
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> increments = {};
+
+	friend ts::Tensor<T> ts::implicitConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+};
+
+
+
+	// ts::WinogradCache
+	// (transforms of a kernels matrix, to be reused between samples as long
+	// as the kernels are not updated)
+
+template <typename T>
+class ts::WinogradCache {
+private:
+	// Transformed kernels, one (outChannels x inChannels) matrix per
+	// element of a (m+2) x (m+2) tile (col-major)
+	typedef std::vector<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>> Transforms;
+
+	// Shared with the nodes, which keep using the old transforms when the
+	// kernels are updated
+	std::shared_ptr<const Transforms> transforms = NULL;
+	unsigned outputTile = 0;
+	long kernelRows = 0;
+	long kernelCols = 0;
+
+	// Computes the transforms of kernel, without caching them
+	static std::shared_ptr<const Transforms> transform(
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &kernel,
+		unsigned newOutputTile
+	);
+
+public:
+	// Transforms kernel. This must be called again whenever the kernel values
+	// change : convolutions only check that its size and the tile size still
+	// match, and never modify the cache themselves (so it can be shared
+	// between threads).
+	void update(
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &kernel,
+		unsigned newOutputTile
+	);
+	void clear();
+
+	friend ts::Tensor<T> ts::winogradConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> padding,
+		unsigned outputTile,
+		const ts::WinogradCache<T> * cache
+	);
+};
+
+
+
+	// ts::WinogradNode
+
+template <typename T>
+class ts::WinogradNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	typedef std::vector<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>> Transforms;
+
+	// This node can have n parents ! (the kernel, then all input channels)
+	WinogradNode(
+		std::vector<long> shape,
+		std::vector<int> newDependencies,
+		ts::ConvGeometry newGeometry,
+		unsigned newOutputTile,
+		std::shared_ptr<const Transforms> newKernelTransforms,
+		Transforms newInputTransforms
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	ts::ConvGeometry geometry;
+	unsigned outputTile;
+
+	// Same layout as the ts::WinogradCache transforms. Input transforms have
+	// one (inChannels x nTiles) matrix per element of a tile.
+	std::shared_ptr<const Transforms> kernelTransforms;
+	Transforms inputTransforms;
+
+	// Input channels increments, computed with the kernel one as they all
+	// come from the derivatives of the tiles products
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> increments = {};
+
+	friend ts::Tensor<T> ts::winogradConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> padding,
+		unsigned outputTile,
+		const ts::WinogradCache<T> * cache
+	);
+};
+
+
+
+	// ts::FFTConvNode
+
+template <typename T>
+class ts::FFTConvNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	typedef Eigen::Array<std::complex<T>, Eigen::Dynamic, Eigen::Dynamic> Spectrum;
+
+	// This node can have n parents ! (the kernel, then all input channels)
+	FFTConvNode(
+		std::vector<long> shape,
+		std::vector<int> newDependencies,
+		ts::ConvGeometry newGeometry,
+		std::vector<Spectrum> newInputSpectra,
+		std::vector<Spectrum> newKernelSpectra
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	ts::ConvGeometry geometry;
+
+	// FFTs of the padded input channels, and of all (outChannel, inChannel)
+	// kernels (at index outChannel * nInChannels + inChannel)
+	std::vector<Spectrum> inputSpectra;
+	std::vector<Spectrum> kernelSpectra;
+
+	// Input channels increments, computed with the kernel one as they all
+	// need the FFTs of the output derivatives
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> increments = {};
+
+	friend ts::Tensor<T> ts::fftConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> padding
 	);
 };
 
 
 
+	// ts::DepthwiseConvNode
+
+template <typename T>
+class ts::DepthwiseConvNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// This node can have n parents ! (the kernel, then all input channels,
+	// whose values are kept in this->values)
+	DepthwiseConvNode(
+		std::vector<long> shape,
+		std::vector<int> newDependencies,
+		std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> newValues,
+		ts::ConvGeometry newGeometry
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	ts::ConvGeometry geometry;
+
+	// Input channels increments : channel i is scattered from the same patch
+	// pass as row i of the kernel increment
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> increments = {};
+
+	friend ts::Tensor<T> ts::depthwiseConv<>(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> kernelDim,
+		std::vector<unsigned> stride,
+		std::vector<unsigned> padding,
+		std::vector<unsigned> dilation
+	);
+};
+
+
 	// ts::Col2ImNode
 
 template <typename T>
@@ -260,3 +802,81 @@ private:
 		std::vector<unsigned> outputDim
 	) ;
 };
+
+
+
+	// ts::PackedCol2ImNode
+
+template <typename T>
+class ts::PackedCol2ImNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	PackedCol2ImNode(
+		std::vector<long> shape,
+		int xDep,
+		std::vector<long> newOutputDim
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	long outputRows, outputCols;	// Size of one channel
+
+	friend ts::Tensor<T> ts::packedCol2im<>(
+		const ts::Tensor<T> &x,
+		std::vector<unsigned> outputDim
+	);
+};
+
+
+
+	// ts::ConvBlockNode
+
+template <typename T>
+class ts::ConvBlockNode : public ts::Node<T> {
+private:
+	using ts::Node<T>::Node;
+
+	// Binary node (convolution, then bias) for the packed output map
+	ConvBlockNode(
+		std::vector<long> shape,
+		int convDep, int biasDep,
+		std::vector<long> newInputShape,
+		std::vector<long> newArgmax,
+		std::vector<uint32_t> newMask, T newSlope,
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newOutput,
+		bool newChannelBias
+	);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> incrementGradient(
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+			unsigned &j
+	);
+
+	long inputRows, inputCols;	// Shape of conv (and of a full bias)
+	bool channelBias;	// The bias is a (inputRows, 1) vector
+
+	// Index (in the col-major conv) of the max element of each pool. Empty
+	// without pooling, as each output element then has a single source.
+	std::vector<long> argmax;
+
+	// relu / leakyRelu derivative of each output element (see ts::ReluNode),
+	// or sigmoid output, from which its derivative is computed
+	std::vector<uint32_t> mask;
+	T slope;
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> output;
+
+	// Both parents get the same increment, computed on the first call
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment;
+
+	friend ts::Tensor<T> ts::convBlock<>(
+		const ts::Tensor<T> &conv,
+		const ts::Tensor<T> &bias,
+		std::vector<unsigned> outputDim,
+		std::vector<unsigned> pool,
+		ts::Tensor<T> (*activation)(const ts::Tensor<T>&)
+	);
+};
@@ -0,0 +1,95 @@
+/*
+* Element-wise kernels of the activation functions, arithmetic operators and
+* optimizers. Each kernel computes its values (and derivatives) in a single
+* pass on raw arrays, so that the compiler can vectorize it (with simd loops
+* or Eigen packet expressions).
+* Kernels written as plain loops are also compiled for wider ISAs, and
+* selected at load time (see TS_TARGET_CLONES and ts::kernelIsa()).
+*/
+
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+
+// Number of elements per word of the bit-packed masks
+#define TS_MASK_WORD_BITS 32
+
+// Slope of ts::leakyRelu for x <= 0
+#define TS_LEAKY_RELU_SLOPE 0.1
+
+namespace ts {
+	// Number of words of a bit-packed mask of n elements
+	inline long maskSize(long n) {
+		return (n + TS_MASK_WORD_BITS - 1) / TS_MASK_WORD_BITS;
+	}
+
+	// res = max(0, x), mask = (x > 0) (bit-packed, as the derivative is
+	// either 1 or 0)
+	template <typename T>
+	void reluKernel(const T * x, long n, T * res, uint32_t * mask);
+
+	// res = x if x > 0, slope * x otherwise, mask = (x > 0)
+	template <typename T>
+	void leakyReluKernel(const T * x, long n, T slope, T * res, uint32_t * mask);
+
+	// res = d if the mask bit is set, slope * d otherwise (backward pass of
+	// relu / leakyRelu)
+	template <typename T>
+	void maskKernel(const T * d, long n, const uint32_t * mask, T slope, T * res);
+
+	// res = 1 / (1 + e^-x)
+	template <typename T>
+	void sigmoidKernel(const T * x, long n, T * res);
+
+	// res = tanh(x)
+	template <typename T>
+	void tanhKernel(const T * x, long n, T * res);
+
+	// Backward passes computed from the activation output s and the
+	// derivative d of its child : res = s * (1 - s) * d, (1 - s^2) * d
+	template <typename T>
+	void sigmoidGradKernel(const T * s, const T * d, long n, T * res);
+	template <typename T>
+	void tanhGradKernel(const T * s, const T * d, long n, T * res);
+
+	// Softmax of each column of a col-major (rows, cols) array. Its
+	// derivative is not element-wise, and is computed from res only (see
+	// ts::SoftmaxNode).
+	template <typename T>
+	void softmaxKernel(const T * x, long rows, long cols, T * res);
+
+	// Returns the cross entropy between the softmax of each column and its
+	// class in labels (summed over the columns), dx = softmax(x) - onehot
+	template <typename T>
+	T softmaxCrossEntropyKernel(
+		const T * x, long rows, long cols, const unsigned * labels, T * dx
+	);
+
+	// res = x + y, x - y, x * y (res can alias x or y)
+	template <typename T>
+	void addKernel(const T * x, const T * y, long n, T * res);
+	template <typename T>
+	void subtractKernel(const T * x, const T * y, long n, T * res);
+	template <typename T>
+	void multiplyKernel(const T * x, const T * y, long n, T * res);
+
+	// res = x / y, dx = 1 / y, dy = -x / y^2
+	template <typename T>
+	void divideKernel(const T * x, const T * y, long n, T * res, T * dx, T * dy);
+
+	// value -= rate * increment
+	template <typename T>
+	void stepKernel(const T * increment, long n, T rate, T * value);
+
+	// Updates the Adam moment estimates m and v with the gradient, and
+	// replaces it with the increment mHat / (sqrt(vHat) + epsilon), where
+	// correction1 / correction2 are the bias corrections 1 - beta^t
+	template <typename T>
+	void adamKernel(
+		T * grad, long n, T beta1, T beta2,
+		T correction1, T correction2, T epsilon,
+		T * m, T * v
+	);
+}
@@ -13,10 +13,24 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <chrono>
+
+// Number of timed runs per candidate algorithm when autotuning a CNN
+#define TS_AUTOTUNE_RUNS 3
+
+// Number of regions evaluated in each pass of
+// ConvolutionalNetwork::computeBatch
+#define TS_BATCH_SIZE 64
+
+// Output tile size of the Winograd convolution layers of a CNN
+#define TS_WINOGRAD_OUTPUT_TILE 4
 
 namespace ts {
 	template <typename T> class Model;
 
+	template <typename T> class BatchNormLayer;
+
 	template <typename T> class Polynom;
 	template <typename T> class MultiLayerPerceptron;
 	template <typename T> class ConvolutionalNetwork;
@@ -36,6 +50,10 @@ private:
 public:
 	ts::WengertList<T> wList;
 
+	// Set by ts::Optimizer during training sessions (batch normalization
+	// layers then update their running statistics)
+	bool training = false;
+
 	// Call the WengertList toggleOptimize method
 	void toggleOptimize(ts::Tensor<T> * tensor, bool enable);
 
@@ -49,11 +67,81 @@ public:
 	virtual void save(std::string filePath) = 0;
 	virtual void load(std::string filePath) = 0;
 
+	// Calls load or loadBinary depending on the file header
+	void loadFile(std::string filePath);
+
+	// Recomputes whatever the model derives from its parameters (does
+	// nothing by default). Called by ts::Optimizer after each update, and by
+	// load / restore : it must also be called after modifying parameters
+	// directly.
+	virtual void parametersUpdated();
+
+	// Copies / restores the model architecture and parameters
+	// (restore moves the parameters out of the snapshot)
+	virtual ts::ModelSnapshot<T> snapshot() = 0;
+	virtual void restore(ts::ModelSnapshot<T> &snapshot) = 0;
+
+	// Binary version of save / load (see ts::writeBinarySnapshot)
+	void saveBinary(std::string filePath);
+	void loadBinary(std::string filePath);
+
 	friend ts::GradientAccumulator<T>;
 };
 
 
 
+	// ts::BatchNormLayer
+	// (normalization of each row of a layer output, ie of each neuron or
+	// convolution channel, followed by a learned scale and shift. Samples are
+	// computed one at a time : in training mode, rows of several columns (the
+	// positions of a convolution channel) are normalized with their own
+	// statistics, and single columns (dense layers) with the running ones.
+	// Running statistics are always used outside of training mode.)
+
+template <typename T>
+class ts::BatchNormLayer {
+private:
+
+public:
+	BatchNormLayer() {};
+	BatchNormLayer(unsigned size, ts::WengertList<T> * wList);
+
+	// Learned parameters, of size (size, 1)
+	ts::Tensor<T> scale;
+	ts::Tensor<T> shift;
+
+	// Exponential moving averages of the mean and variance of each row,
+	// updated by every sample computed in training mode
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> mean;
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> variance;
+
+	T momentum = 0.1;
+	T epsilon = 1e-5;
+
+	ts::Tensor<T> compute(ts::Tensor<T> x, bool training);
+
+	// The normalization outside of training mode, as an affine function of
+	// each row : factor * x + offset
+	Eigen::Array<T, Eigen::Dynamic, 1> factor();
+	Eigen::Array<T, Eigen::Dynamic, 1> offset();
+
+	// Layers are saved as {scale, shift, mean, variance} arrays, appended to
+	// a single vector / tensors vector
+	static std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> flatten(
+		std::vector<ts::BatchNormLayer<T>> &layers
+	);
+	static std::vector<ts::BatchNormLayer<T>> unflatten(
+		std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> &arrays,
+		ts::WengertList<T> * wList
+	);
+	static std::string serialize(std::vector<ts::BatchNormLayer<T>> &layers);
+	static std::vector<ts::BatchNormLayer<T>> parse(
+		std::ifstream &in, ts::WengertList<T> * wList
+	);
+};
+
+
+
 	// ts::Polynom
 	// (element-wise polynom for nxn tensors)
 
@@ -63,9 +151,15 @@ private:
 	long nRows = 0;
 	long nCols = 0;
 
+	// Only allocates the tensors of the file (see fromFile)
+	Polynom(std::string filePath);
+
 public:
 	Polynom(unsigned order, std::vector<long> size);
 
+	// Creates the model directly from a text or binary file
+	static ts::Polynom<T> fromFile(std::string filePath);
+
 	std::vector<ts::Tensor<T>> coefficients = {};
 
 	void toggleGlobalOptimize(bool enable);
@@ -75,6 +169,9 @@ public:
 	void save(std::string filePath);
 	void load(std::string filePath);
 
+	ts::ModelSnapshot<T> snapshot();
+	void restore(ts::ModelSnapshot<T> &snapshot);
+
 	long rows();
 	long cols();
 };
@@ -86,9 +183,17 @@ public:
 template <typename T>
 class ts::MultiLayerPerceptron : public ts::Model<T> {
 private:
+	MultiLayerPerceptron(std::string filePath);
 
 public:
-	MultiLayerPerceptron(unsigned inputSize, std::vector<unsigned> layers);
+	// If batchNormalization is true, hidden layers are normalized before
+	// their bias and activation
+	MultiLayerPerceptron(
+		unsigned inputSize, std::vector<unsigned> layers,
+		bool batchNormalization = false
+	);
+
+	static ts::MultiLayerPerceptron<T> fromFile(std::string filePath);
 
 	ts::Tensor<T> (*activationFunction)(const ts::Tensor<T>&) = &(ts::relu);
 	ts::Tensor<T> (*finalActivation)(const ts::Tensor<T>&) = &(ts::sigmoid);
@@ -96,12 +201,24 @@ public:
 	std::vector<ts::Tensor<T>> weights = {};
 	std::vector<ts::Tensor<T>> biases = {};
 
+	// One per hidden layer, or empty
+	std::vector<ts::BatchNormLayer<T>> norms = {};
+
 	void toggleGlobalOptimize(bool enable);
 
+	// Merges the batch normalization layers into the weights and biases of
+	// their layers, and removes them. Outputs are unchanged outside of
+	// training mode, but don't pay for the normalization anymore (this is
+	// meant to be called once training is done, eg after loading a model).
+	void foldBatchNorm();
+
 	ts::Tensor<T> compute(ts::Tensor<T> input);
 
 	void save(std::string filePath);
 	void load(std::string filePath);
+
+	ts::ModelSnapshot<T> snapshot();
+	void restore(ts::ModelSnapshot<T> &snapshot);
 };
 
 
@@ -111,6 +228,76 @@ public:
 template <typename T>
 class ts::ConvolutionalNetwork : public ts::Model<T> {
 private:
+	ConvolutionalNetwork(std::string filePath);
+
+	// Completes a convolution layer description with default values
+	// (returns false if it is invalid)
+	static bool normalizeConvLayer(std::vector<unsigned> &convLayer);
+
+	// Same for a pooling layer, and size of its output ({0, 0} if the pooling
+	// is impossible, inputDim if it is skipped)
+	static bool normalizePoolingLayer(std::vector<unsigned> &poolingLayer);
+	static std::vector<unsigned> poolingOutputDim(
+		const std::vector<unsigned> &poolingLayer, std::vector<unsigned> inputDim
+	);
+
+	// Appends a pointwise kernel, only registered in the wList if it is not
+	// empty (ie for depthwise separable layers)
+	void addPointwiseKernel(Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> kernel);
+
+	// Algorithm of each convolution layer (see setConvAlgorithms)
+	std::vector<ts::ConvAlgorithm> convAlgorithms = {};
+
+	// Kernel transforms of the layers using ts::ConvAlgorithm::WINOGRAD (one
+	// cache per layer, empty for the other ones). They are only written by
+	// parametersUpdated, so compute() can run in several threads.
+	std::vector<ts::WinogradCache<T>> winogradCaches = {};
+
+	// Whether a layer can be computed with a convolution algorithm (im2col
+	// and implicit GEMM support all layers)
+	static bool isEligible(
+		std::vector<unsigned> &kernelDim, ts::ConvAlgorithm algorithm
+	);
+
+	// Computes one convolution layer with the given algorithm (falls back to
+	// im2col if the layer is not eligible)
+	static ts::Tensor<T> convolve(
+		const ts::Tensor<T> &kernel,
+		const std::vector<ts::Tensor<T>> &x,
+		std::vector<unsigned> &kernelDim,
+		ts::ConvAlgorithm algorithm,
+		const ts::WinogradCache<T> * cache
+	);
+
+	// Number of channels of the input maps of layer i, and network input as
+	// packed maps (see convolution.hpp)
+	unsigned inputChannels(unsigned i);
+	ts::Tensor<T> packInput(const ts::Tensor<T> &input);
+
+	// Steps of compute(), for one or several inputs (see computeBatch) :
+	// convolution of layer i for all input maps, side by side in a single
+	// tensor (followed by its batch normalization), then the bias, activation
+	// and pooling of each of them, and all layers starting from firstLayer
+	// (one output column per input). Feature maps are packed between layers.
+	ts::Tensor<T> convolveLayer(unsigned i, const std::vector<ts::Tensor<T>> &maps);
+	ts::Tensor<T> normalizeLayer(unsigned i, const ts::Tensor<T> &conv);
+	std::vector<ts::Tensor<T>> activateLayer(
+		unsigned i, const ts::Tensor<T> &conv, unsigned nMaps
+	);
+	ts::Tensor<T> computeFrom(std::vector<ts::Tensor<T>> maps, unsigned firstLayer);
+
+	// Input size of each convolution layer (of one of its channels) for a
+	// network input of size inputDim (with its channels), or {} if a layer
+	// is impossible for this size
+	std::vector<std::vector<unsigned>> layerInputDims(std::vector<unsigned> inputDim);
+
+	// Network input size of models saved without it : the smallest one giving
+	// the first convolution output size
+	std::vector<unsigned> guessInputSize();
+
+	// Times one forward / backward pass of the layer with each eligible
+	// algorithm on random inputs, and returns the fastest one
+	ts::ConvAlgorithm benchmarkLayer(unsigned i, std::vector<unsigned> inputDim);
 
 public:
 	ConvolutionalNetwork(
@@ -118,9 +305,14 @@ public:
 		ChannelSplit splitDirection, unsigned inputChannels,
 		std::vector<std::vector<unsigned>> convLayers,
 		std::vector<std::vector<unsigned>> poolingLayers,
-		std::vector<unsigned> denseLayers
+		std::vector<unsigned> denseLayers,
+		bool channelBiases = false,
+		bool globalAveragePooling = false,
+		bool batchNormalization = false
 	);
 
+	static ts::ConvolutionalNetwork<T> fromFile(std::string filePath);
+
 	ts::Tensor<T> (*convActivation)(const ts::Tensor<T>&) = &(ts::leakyRelu);
 	ts::Tensor<T> (*denseActivation)(const ts::Tensor<T>&) = &(ts::relu);
 	ts::Tensor<T> (*finalActivation)(const ts::Tensor<T>&) = &(ts::sigmoid);
@@ -129,22 +321,98 @@ public:
 
 	// Convolution section
 	std::vector<ts::Tensor<T>> convKernels = {};
+	// One bias per channel and output position, or per channel only (column
+	// vectors broadcast over positions)
 	std::vector<ts::Tensor<T>> convBiases = {};
+	// {rows, cols, stride, padding, type} (the default stride 0 is the pool
+	// size, type is a ts::PoolingType). Pooling is skipped if rows or cols is 0.
 	std::vector<std::vector<unsigned>> pooling;
+	// {rows, cols, channels, stride, padding, dilation, type} (type is a
+	// ts::ConvLayerType)
 	std::vector<std::vector<unsigned>> kernelDims;
 	std::vector<std::vector<unsigned>> outputDims;	// Outputs right after convs
 
+	// Kernels of the 1x1 convolutions of depthwise separable layers, of size
+	// (channels, input channels). convKernels then contains the depthwise
+	// kernels (one row per input channel), and the pointwise kernels of
+	// standard layers are empty.
+	std::vector<ts::Tensor<T>> pointwiseKernels = {};
+
 	// Dense section
 	std::vector<ts::Tensor<T>> weights = {};
 	std::vector<ts::Tensor<T>> fullBiases = {};
 
+	// The last feature maps are averaged over each channel instead of being
+	// flattened, so the dense layers only get one value per channel
+	bool globalPooling = false;
+
+	// Normalization of each convolution output (before its bias) and of each
+	// hidden dense layer (before its bias), or empty
+	std::vector<ts::BatchNormLayer<T>> convNorms = {};
+	std::vector<ts::BatchNormLayer<T>> denseNorms = {};
+
 	ChannelSplit channelSplit = ChannelSplit::NOSPLIT;
 	unsigned nInputChannels = 1;
+	// Input size given to the constructor (with all channels)
+	std::vector<unsigned> inputSize = {};
 
 	void toggleGlobalOptimize(bool enable);
 
+	// Algorithm of each convolution layer (layers without an entry use
+	// ConvAlgorithm::IM2COL, and ineligible Winograd / FFT layers or depthwise
+	// separable layers fall back to it). This is not saved with the model.
+	void setConvAlgorithms(std::vector<ts::ConvAlgorithm> algorithms);
+	std::vector<ts::ConvAlgorithm> getConvAlgorithms();
+
+	// Sets the algorithms to the fastest algorithm for each layer, by
+	// benchmarking them (should be called once the model is built or loaded).
+	// Layers are benchmarked for inputs of size inputDim (with all channels,
+	// eg the image size for computeDense), or inputSize by default.
+	// If cachePath is not empty, results are read from / added to this file,
+	// where they are keyed by layer shape and ts::cpuSignature(), so that
+	// later runs on the same kind of machine don't need to benchmark again.
+	void autotune(std::string cachePath = "", std::vector<unsigned> inputDim = {});
+
+	// Merges the batch normalization layers into the preceding kernels (or
+	// pointwise kernels) / weights and biases, and removes them (see
+	// ts::MultiLayerPerceptron::foldBatchNorm)
+	void foldBatchNorm();
+
 	ts::Tensor<T> compute(ts::Tensor<T> input);
 
+	// Sliding window prediction : evaluates the network on all windows of
+	// size windowDim (the input size of the network, with its channels) of
+	// image, shifted by strides. Returns one matrix per network output, whose
+	// (i, j) element corresponds to the window at (i * strides[0],
+	// j * strides[1]) in each channel. The convolution layers are computed
+	// once on the whole image when possible (see model.cpp).
+	// This resets wList.
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> computeDense(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> image,
+		std::vector<unsigned> windowDim,
+		std::vector<unsigned> strides
+	);
+
+	// Batched prediction : evaluates the network on the regions of image of
+	// size windowDim (the input size of the network, with its channels) whose
+	// top left corners are at regions[i] = {row, col} in each channel.
+	// Returns the outputs of the regions as columns. Regions are computed by
+	// batches of TS_BATCH_SIZE with the same layers as compute() (and the same
+	// convolution algorithms), im2col convolutions and dense layers being single
+	// matrix products for the whole batch.
+	// This resets wList.
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> computeBatch(
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &image,
+		std::vector<unsigned> windowDim,
+		std::vector<std::vector<unsigned>> regions
+	);
+
 	void save(std::string filePath);
 	void load(std::string filePath);
+
+	ts::ModelSnapshot<T> snapshot();
+	void restore(ts::ModelSnapshot<T> &snapshot);
+
+	// Updates the Winograd kernel transforms
+	void parametersUpdated();
 };
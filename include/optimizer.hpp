@@ -8,6 +8,7 @@
 
 #include "autodiff.hpp"
 #include "model.hpp"
+#include "checkpoint.hpp"
 
 #include <vector>
 #include <iostream>
@@ -27,6 +28,9 @@ namespace ts {
 
 	// ts::TrainingData
 	// (helper class containing both input data and its expected result)
+	// The expected result is either an array (the loss is then
+	// normFunction(output - expected)), or a class label for classification
+	// (the output is then taken as logits, with a softmaxCrossEntropy loss)
 
 template <typename T>
 class ts::TrainingData {
@@ -37,9 +41,16 @@ public:
 		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newInput,
 		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newExpected
 	);
+	TrainingData(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newInput,
+		unsigned newLabel
+	);
 
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> input;
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> expected;
+
+	bool labeled = false;
+	unsigned label = 0;
 };
 
 
@@ -84,10 +95,7 @@ private:
 
 	void reset();
 	void increment(ts::Gradient<T> &gradient);
-	void updateTensor(
-		ts::Model<T> &model, unsigned i,
-		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> value
-	);
+	void updateTensor(ts::Model<T> &model, unsigned i, T rate);
 	void clear();
 
 
@@ -109,12 +117,22 @@ private:
 protected:
 	ts::GradientAccumulator<T> gradAccumulator;
 
+	// Model of the current training session (NULL when no session is open)
+	ts::Model<T> * sessionModel = NULL;
+	unsigned nSteps = 0;	// Since the beginning of the session
+
+	ts::CheckpointWriter<T> checkpointWriter;
+
 	void resetGradAccumulator();	// Set values to 0
 	void setupGradAccumulator(ts::Model<T> &model);	// Generate 0-filled elements
 
 	// Dependent of optimizer type. Applies and the accumulated gradient.
 	virtual void updateModel(ts::Model<T> &model, unsigned batchSize) = 0;
 
+	// Dependent of optimizer type. Called on each gradient before it is
+	// added to the accumulator (does nothing by default).
+	virtual void processGradient(ts::Gradient<T> &gradient);
+
 public:
 	Optimizer();
 
@@ -122,10 +140,26 @@ public:
 
 	unsigned epochs = 1;
 
+	// If checkpointEvery is not 0, the session model is saved to
+	// checkpointPath (binary format) every checkpointEvery steps. Checkpoints
+	// are written in the background.
+	unsigned checkpointEvery = 0;
+	std::string checkpointPath = "checkpoint.tsb";
+
+	// Training session : the gradient accumulator and optimizer state are
+	// set up once by startSession(), then kept alive between step() calls
+	// until endSession() (useful for online training). The model is in
+	// training mode during the session (see ts::Model::training).
+	virtual void startSession(ts::Model<T> &model);
+	virtual void endSession();
+
+	// Trains the session model on one batch, and returns its losses
+	std::vector<T> step(std::vector< ts::TrainingData<T> > &batch);
+
 	// Optimizes the model by running its compute() method on the batches data
-	virtual std::vector<std::vector<std::vector< T >>> run(
+	std::vector<std::vector<std::vector< T >>> run(
 		ts::Model<T> &model, std::vector<std::vector< ts::TrainingData<T> >> &batches
-	) = 0;
+	);
 
 };
 
@@ -144,10 +178,6 @@ public:
 	GradientDescentOptimizer(T newLearningRate);
 
 	T learningRate = 0.1;
-
-	std::vector<std::vector<std::vector< T >>> run(
-		ts::Model<T> &model, std::vector<std::vector< ts::TrainingData<T> >> &batches
-	);
 };
 
 
@@ -163,14 +193,6 @@ private:
 	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> m = {};
 	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> v = {};
 
-	// NOTE For now, all mHat and vHat are stored in a vector. It would be
-	// possible to only use one Eigen::Array, and to resize it every time
-	// instead of storing all values.
-	// -> This is a tradeoff between time and memory, it would be interesting
-	// to benchmark both methods in the future.
-	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> mHat = {};
-	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> vHat = {};
-
 	void initMomentEstimates(
 		std::vector< std::shared_ptr<ts::Node<T>> > nodes
 	);
@@ -180,6 +202,8 @@ private:
 		std::vector<ts::GaElement<T>>& elements
 	);
 
+	void processGradient(ts::Gradient<T> &gradient);
+
 	T decayedBeta1;
 	T decayedBeta2;
 
@@ -199,7 +223,6 @@ public :
 	T beta2 = 0.999;
 	T epsilon = 0.00000001;
 
-	std::vector<std::vector<std::vector< T >>> run(
-		ts::Model<T> &model, std::vector<std::vector< ts::TrainingData<T> >> &batches
-	);
+	void startSession(ts::Model<T> &model);
+	void endSession();
 };
@@ -12,13 +12,27 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <cstdint>
+#include <limits>
+
+#include <Eigen/Dense>
+
+
+// Binary format constants
+#define TS_BINARY_MAGIC "TSLOWBIN"
+#define TS_BINARY_VERSION 1
+#define TS_BINARY_HEADER_SIZE 64
+#define TS_BINARY_ALIGNMENT 64
 
 
 namespace ts {
+	template <typename T> class ModelSnapshot;
+
 	template <typename T> std::string serializeTensor(ts::Tensor<T> &tensor);
 
+	// If model is true, parsed tensors are model parameters (see ts::Tensor)
 	template <typename T> ts::Tensor<T> parseTensor(
-		std::ifstream &in, ts::WengertList<T> * wList
+		std::ifstream &in, ts::WengertList<T> * wList, bool model = false
 	);
 
 	template <typename T> std::string serializeTensorsVector(
@@ -26,6 +40,32 @@ namespace ts {
 	);
 
 	template <typename T> std::vector<ts::Tensor<T>> parseTensorsVector(
-		std::ifstream &in, ts::WengertList<T> * wList
+		std::ifstream &in, ts::WengertList<T> * wList, bool model = false
+	);
+
+	template <typename T> bool writeBinarySnapshot(
+		std::string filePath, ts::ModelSnapshot<T> &snapshot
+	);
+
+	template <typename T> bool readBinarySnapshot(
+		std::string filePath, ts::ModelSnapshot<T> &snapshot
 	);
 }
+
+
+
+	// ts::ModelSnapshot
+	// (copy of a model's architecture and parameters, independent of any
+	// WengertList. This is what gets written in binary model files.)
+
+template <typename T>
+class ts::ModelSnapshot {
+public:
+	// Architecture description (model dependent)
+	std::vector<unsigned> metadata = {};
+
+	// Parameters, grouped the same way as in the text format
+	std::vector<std::vector<
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>
+	>> groups = {};
+};
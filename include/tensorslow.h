@@ -6,8 +6,10 @@
 
 
 #include "utils.hpp"
+#include "kernels.hpp"
 #include "autodiff.hpp"
 #include "model.hpp"
+#include "checkpoint.hpp"
 #include "optimizer.hpp"
 #include "serializer.hpp"
 #include "convolution.hpp"
@@ -3,14 +3,31 @@
 * NOTE For now, this has only been created to avoid double definition of split
 */
 
+#pragma once
+
 #include <vector>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <cstdint>
+#include <cstring>
 
 #define BARWIDTH 30
 
+// Hot kernels are compiled for several x86-64 ISA levels (SSE4.2, AVX2 + FMA
+// and AVX-512 feature sets) in addition to the baseline, and the best variant
+// supported by the CPU is selected when the library is loaded
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define TS_KERNEL_DISPATCH 1
+#define TS_TARGET_CLONES __attribute__((target_clones( \
+	"arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default" \
+)))
+#else
+#define TS_KERNEL_DISPATCH 0
+#define TS_TARGET_CLONES
+#endif
+
 namespace ts {
 	std::vector<std::string> split(std::string str, char delimeter);
 
@@ -22,5 +39,69 @@ namespace ts {
 		std::ifstream &in
 	);
 
+	// Read the next number of a text stream, directly from its buffer
+	// (numbers can be separated by commas, spaces or linebreaks)
+	bool readNumber(std::streambuf * buffer, unsigned &value);
+	bool readNumber(std::streambuf * buffer, float &value);
+	bool readNumber(std::streambuf * buffer, double &value);
+
+	// Write a number in its shortest form that can be read back exactly
+	void writeNumber(std::string &str, float value);
+	void writeNumber(std::string &str, double value);
+
+	// Store 2D unsigned vectors in a flat vector (for binary serialization)
+	void flattenUnsignedVec2D(
+		std::vector<std::vector<unsigned>> &vec2d,
+		std::vector<unsigned> &flat
+	);
+
+	std::vector<std::vector<unsigned>> unflattenUnsignedVec2D(
+		std::vector<unsigned> &flat, unsigned &position
+	);
+
+	// 64 bits FNV-1a hash, used as a checksum for binary files
+	uint64_t fnv1a(const char * data, size_t size, uint64_t hash);
+
+	// Flushes tmpPath to disk and atomically renames it to filePath
+	bool commitFile(std::string tmpPath, std::string filePath);
+
+	// Identifies the CPU features and number of threads the performance of
+	// the convolution algorithms depends on (used as an autotuning cache key)
+	std::string cpuSignature();
+
+	// Variant of the kernels selected at load time : "x86-64-v4",
+	// "x86-64-v3", "x86-64-v2" or "default"
+	std::string kernelIsa();
+
+	// Size of a convolution output along one dimension (0 if the kernel
+	// doesn't fit in the padded input)
+	unsigned convOutputSize(
+		unsigned inputSize, unsigned kernelSize,
+		unsigned stride, unsigned padding, unsigned dilation
+	);
+
+	// Size of a pooling output along one dimension (0 if the pools don't
+	// cover the padded input exactly, or if they can contain only padding)
+	unsigned poolingOutputSize(
+		unsigned inputSize, unsigned poolSize, unsigned stride, unsigned padding
+	);
+
+	// Complete description of a 2D convolution on one channel, as used by the
+	// low level im2col kernels
+	struct ConvGeometry {
+		long rows, cols;	// Input channel
+		long kernelRows, kernelCols;
+		long strideRows, strideCols;
+		long paddingRows, paddingCols;
+		long dilationRows, dilationCols;
+		long outRows, outCols;
+	};
+
+	ConvGeometry convGeometry(
+		std::vector<long> inputDim, std::vector<long> kernelDim,
+		std::vector<long> stride, std::vector<long> padding,
+		std::vector<long> dilation
+	);
+
 	void progressBar(unsigned current, unsigned max);
 }
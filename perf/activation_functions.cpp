@@ -1,5 +1,9 @@
 /*
-* Benchmark activation / classification functions + their derivation
+* Benchmark activation / classification functions + their derivation.
+* The forward pass (computing the values and derivatives with the activation
+* kernels) and the backward pass (propagating a gradient through the
+* activation node) are measured separately, on vectors of 10 to 100000
+* elements.
 */
 
 #include <iostream>
@@ -9,11 +13,15 @@
 #define SIZE_2 100
 #define SIZE_3 1000
 #define SIZE_4 5000
+#define SIZE_5 100000
 
 #include "../include/tensorslow.h"
 
 
-static void sigmoidPerf(benchmark::State& state) {
+typedef ts::Tensor<float> (*Activation)(const ts::Tensor<float>&);
+
+
+static void forward(benchmark::State& state, Activation activation) {
 	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> vec_;
 	vec_.setRandom(state.range(0), 1);
 
@@ -22,30 +30,50 @@ static void sigmoidPerf(benchmark::State& state) {
 
 
 	for(auto _ : state) {
-		ts::Tensor<float> res = ts::sigmoid(vec);
-		res.grad();
+		ts::Tensor<float> res = (*activation)(vec);
+		benchmark::DoNotOptimize(res);
+
+		// Only keep the input node
+		wList.reset();
 	}
-}
 
-BENCHMARK(sigmoidPerf)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
 
 
 
-static void reluPerf(benchmark::State& state) {
+static void backward(benchmark::State& state, Activation activation) {
 	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> vec_;
 	vec_.setRandom(state.range(0), 1);
 
 	ts::WengertList<float> wList;
 	ts::Tensor<float> vec(vec_, &wList);
 
+	// grad() doesn't modify the list, so the same graph is reused
+	ts::Tensor<float> res = (*activation)(vec);
+
 
 	for(auto _ : state) {
-		ts::Tensor<float> res = ts::relu(vec);
-		res.grad();
+		ts::Gradient<float> grad = res.grad();
+		benchmark::DoNotOptimize(grad);
 	}
+
+	state.SetItemsProcessed(state.iterations() * state.range(0));
 }
 
-BENCHMARK(reluPerf)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4);
+
+
+#define ACTIVATION_BENCHMARKS(name, function) \
+	BENCHMARK_CAPTURE(forward, name, &(function)) \
+	->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5); \
+	BENCHMARK_CAPTURE(backward, name, &(function)) \
+	->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5);
+
+ACTIVATION_BENCHMARKS(sigmoid, ts::sigmoid<float>)
+ACTIVATION_BENCHMARKS(relu, ts::relu<float>)
+ACTIVATION_BENCHMARKS(leakyRelu, ts::leakyRelu<float>)
+ACTIVATION_BENCHMARKS(tanh, ts::tanh<float>)
+ACTIVATION_BENCHMARKS(softmax, ts::softmax<float>)
 
 
 
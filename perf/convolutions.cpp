@@ -7,6 +7,10 @@
 * more efficient with high nuber of channels (as opposed to convolution with
 * very few channels). Its aim is to show the interest of the im2col method in
 * a realistic CNN.
+* The im2col packing (forward) and scatter (backward) kernels are also
+* benchmarked separately on the same layer.
+* Finally, the naive, im2col and FFT convolutions are compared on a single
+* channel for kernel sizes between 3 and 11, to find their crossover point.
 */
 
 #include <iostream>
@@ -18,6 +22,7 @@
 #define SIZE_3 100
 #define SIZE_4 250
 #define SIZE_5 500
+#define CROSSOVER_SIZE 250
 
 #include "../include/tensorslow.h"
 
@@ -123,4 +128,289 @@ BENCHMARK(im2col)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_
 
 
 
+static void packedIm2col(benchmark::State& state) {
+
+	// Same as im2col, on packed feature maps (one tensor for all channels)
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> kernel_;
+	kernel_.setRandom(32, 144);
+	ts::Tensor<float> kernel = ts::Tensor<float>(kernel_, &wList);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+	mat_.setRandom(16 * state.range(0), state.range(0));
+	ts::Tensor<float> mat = ts::Tensor<float>(mat_, &wList);
+
+
+	for(auto _ : state) {
+
+		ts::Tensor<float> im2colMat = ts::im2col(mat, 16, {KERNEL_SIZE, KERNEL_SIZE});
+		ts::Tensor<float> res = ts::matProd(kernel, im2colMat);
+		ts::Tensor<float> maps = ts::packedCol2im(
+			res,
+			{
+				(unsigned) (state.range(0) - KERNEL_SIZE + 1),
+				(unsigned) (state.range(0) - KERNEL_SIZE + 1)
+			}
+		);
+
+	}
+}
+
+BENCHMARK(packedIm2col)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5);
+
+
+
+static void im2colForward(benchmark::State& state) {
+
+	ts::WengertList<float> wList;
+
+	std::vector<ts::Tensor<float>> mat = {};
+	for(unsigned i=0; i<16; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+		mat_.setRandom(state.range(0), state.range(0));
+
+		mat.push_back(
+			ts::Tensor<float>(mat_, &wList)
+		);
+	}
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> im2colMat = ts::im2col(mat, {KERNEL_SIZE, KERNEL_SIZE});
+		benchmark::DoNotOptimize(im2colMat);
+		wList.reset();
+	}
+}
+
+BENCHMARK(im2colForward)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5);
+
+
+
+static void im2colBackward(benchmark::State& state) {
+
+	// The gradient of the sum of the im2col matrix is computed, so that almost
+	// all the work is done in the scatter of the im2col node
+
+	ts::WengertList<float> wList;
+
+	std::vector<ts::Tensor<float>> mat = {};
+	for(unsigned i=0; i<16; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+		mat_.setRandom(state.range(0), state.range(0));
+
+		mat.push_back(
+			ts::Tensor<float>(mat_, &wList)
+		);
+	}
+
+	ts::Tensor<float> im2colMat = ts::im2col(mat, {KERNEL_SIZE, KERNEL_SIZE});
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ones_;
+	ones_.setOnes(1, im2colMat.getValue().rows());
+	ts::Tensor<float> ones = ts::Tensor<float>(ones_, &wList);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> onesCol_;
+	onesCol_.setOnes(im2colMat.getValue().cols(), 1);
+	ts::Tensor<float> onesCol = ts::Tensor<float>(onesCol_, &wList);
+
+	ts::Tensor<float> sum = ts::matProd(ts::matProd(ones, im2colMat), onesCol);
+
+
+	for(auto _ : state) {
+		ts::Gradient<float> gradient = sum.grad();
+		benchmark::DoNotOptimize(gradient);
+	}
+}
+
+BENCHMARK(im2colBackward)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5);
+
+
+
+// Full convolution layers (16 -> 16 channels), computed with an explicit im2col
+// matrix or with an implicit GEMM (inputs are model tensors so they survive
+// wList.reset())
+
+static void im2colConvolution(benchmark::State& state) {
+
+	ts::WengertList<float> wList;
+
+	std::vector<ts::Tensor<float>> mat = {};
+	for(unsigned i=0; i<16; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+		mat_.setRandom(state.range(0), state.range(0));
+
+		mat.push_back(
+			ts::Tensor<float>(mat_, &wList, true)
+		);
+	}
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ker_;
+	ker_.setRandom(16, 16 * KERNEL_SIZE * KERNEL_SIZE);
+	ts::Tensor<float> ker = ts::Tensor<float>(ker_, &wList, true);
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> conv = ts::matProd(
+			ker, ts::im2col(mat, {KERNEL_SIZE, KERNEL_SIZE})
+		);
+		ts::Gradient<float> gradient = ts::squaredNorm(conv).grad();
+		benchmark::DoNotOptimize(gradient);
+		wList.reset();
+	}
+}
+
+BENCHMARK(im2colConvolution)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5);
+
+
+
+static void implicitConvolution(benchmark::State& state) {
+
+	ts::WengertList<float> wList;
+
+	std::vector<ts::Tensor<float>> mat = {};
+	for(unsigned i=0; i<16; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+		mat_.setRandom(state.range(0), state.range(0));
+
+		mat.push_back(
+			ts::Tensor<float>(mat_, &wList, true)
+		);
+	}
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ker_;
+	ker_.setRandom(16, 16 * KERNEL_SIZE * KERNEL_SIZE);
+	ts::Tensor<float> ker = ts::Tensor<float>(ker_, &wList, true);
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> conv = ts::implicitConv(
+			ker, mat, {KERNEL_SIZE, KERNEL_SIZE}
+		);
+		ts::Gradient<float> gradient = ts::squaredNorm(conv).grad();
+		benchmark::DoNotOptimize(gradient);
+		wList.reset();
+	}
+}
+
+BENCHMARK(implicitConvolution)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5);
+
+
+
+static void winogradConvolution(benchmark::State& state) {
+
+	// 3x3 kernels only (compare with KERNEL_SIZE = 3)
+
+	ts::WengertList<float> wList;
+
+	std::vector<ts::Tensor<float>> mat = {};
+	for(unsigned i=0; i<16; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+		mat_.setRandom(state.range(0), state.range(0));
+
+		mat.push_back(
+			ts::Tensor<float>(mat_, &wList, true)
+		);
+	}
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ker_;
+	ker_.setRandom(16, 16 * 3 * 3);
+	ts::Tensor<float> ker = ts::Tensor<float>(ker_, &wList, true);
+
+	ts::WinogradCache<float> cache;
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> conv = ts::winogradConv(ker, mat, {0, 0}, 4, &cache);
+		ts::Gradient<float> gradient = ts::squaredNorm(conv).grad();
+		benchmark::DoNotOptimize(gradient);
+		wList.reset();
+	}
+}
+
+BENCHMARK(winogradConvolution)->Arg(SIZE_1)->Arg(SIZE_2)->Arg(SIZE_3)->Arg(SIZE_4)->Arg(SIZE_5);
+
+
+
+// Crossover (the kernel size is the benchmark argument)
+
+static void crossoverNaive(benchmark::State& state) {
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+	mat_.setRandom(CROSSOVER_SIZE, CROSSOVER_SIZE);
+	ts::Tensor<float> mat = ts::Tensor<float>(mat_, &wList, true);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ker_;
+	ker_.setRandom(state.range(0), state.range(0));
+	ts::Tensor<float> ker = ts::Tensor<float>(ker_, &wList, true);
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> conv = ts::convolution(mat, ker);
+		benchmark::DoNotOptimize(conv);
+		wList.reset();
+	}
+}
+
+BENCHMARK(crossoverNaive)->DenseRange(3, 11, 2);
+
+
+
+static void crossoverIm2col(benchmark::State& state) {
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+	mat_.setRandom(CROSSOVER_SIZE, CROSSOVER_SIZE);
+	std::vector<ts::Tensor<float>> mat = {ts::Tensor<float>(mat_, &wList, true)};
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ker_;
+	ker_.setRandom(1, state.range(0) * state.range(0));
+	ts::Tensor<float> ker = ts::Tensor<float>(ker_, &wList, true);
+
+	unsigned kernelSize = state.range(0);
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> conv = ts::matProd(
+			ker, ts::im2col(mat, {kernelSize, kernelSize})
+		);
+		benchmark::DoNotOptimize(conv);
+		wList.reset();
+	}
+}
+
+BENCHMARK(crossoverIm2col)->DenseRange(3, 11, 2);
+
+
+
+static void crossoverFFT(benchmark::State& state) {
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mat_;
+	mat_.setRandom(CROSSOVER_SIZE, CROSSOVER_SIZE);
+	std::vector<ts::Tensor<float>> mat = {ts::Tensor<float>(mat_, &wList, true)};
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ker_;
+	ker_.setRandom(1, state.range(0) * state.range(0));
+	ts::Tensor<float> ker = ts::Tensor<float>(ker_, &wList, true);
+
+	unsigned kernelSize = state.range(0);
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> conv = ts::fftConv(ker, mat, {kernelSize, kernelSize});
+		benchmark::DoNotOptimize(conv);
+		wList.reset();
+	}
+}
+
+BENCHMARK(crossoverFFT)->DenseRange(3, 11, 2);
+
+
+
 BENCHMARK_MAIN();
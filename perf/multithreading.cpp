@@ -94,6 +94,39 @@ static void heavyCnn(benchmark::State& state) {
 BENCHMARK(heavyCnn)->Arg(NTHREADS_1)->Arg(NTHREADS_2)->Arg(NTHREADS_3)->Arg(NTHREADS_4);
 
 
+
+static void heavyCnnImplicit(benchmark::State& state) {
+
+	// Same model, but convolutions never materialize the im2col matrices
+
+	omp_set_num_threads(state.range(0));
+
+	ts::ConvolutionalNetwork<float> model(
+		{96, 32},
+		ts::ChannelSplit::SPLIT_HOR, 3,
+		{{3, 3, 128}, {5, 5, 128}},
+		{{0,0}, {2, 2}},
+		{256, 128, 10}
+	);
+	model.setConvAlgorithms({
+		ts::ConvAlgorithm::IMPLICIT_GEMM, ts::ConvAlgorithm::IMPLICIT_GEMM
+	});
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> input_;
+	input_.setRandom(96, 32);
+
+
+	for(auto _ : state) {
+		ts::Tensor<float> input = ts::Tensor<float>(input_, &(model.wList));
+		ts::squaredNorm(model.compute(input)).grad();
+		model.wList.reset();
+	}
+
+}
+
+BENCHMARK(heavyCnnImplicit)->Arg(NTHREADS_1)->Arg(NTHREADS_2)->Arg(NTHREADS_3)->Arg(NTHREADS_4);
+
+
 // MAIN
 
 BENCHMARK_MAIN();
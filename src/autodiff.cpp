@@ -164,6 +164,204 @@ Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::ScalarNode<T>::incrementGrad
 
 
 
+template <typename T>
+ts::BroadcastNode<T>::BroadcastNode(std::vector<long> shape, int xDep, int yDep) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies =  {xDep, yDep};
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::BroadcastNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a broadcast sum (the vector is reduced over columns).
+
+	if(j == 0) {
+		return childDerivative;
+	}
+
+	return childDerivative.rowwise().sum();
+}
+
+
+
+template <typename T>
+ts::BatchNormNode<T>::BatchNormNode(
+	std::vector<long> shape,
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> normalized,
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> factor,
+	int xDep, int scaleDep, int shiftDep,
+	bool newBatchStatistics
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->values = {normalized, factor};
+	this->dependencies =  {xDep, scaleDep, shiftDep};
+
+	batchStatistics = newBatchStatistics;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::BatchNormNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a batch normalization (scale and shift are reduced over columns).
+	// With the statistics of x, dx = factor * (d - mean(d) - xHat * mean(d * xHat))
+	// on each row.
+
+	if(j == 0 && batchStatistics) {
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &normalized = this->values[0];
+		Eigen::Array<T, Eigen::Dynamic, 1> meanD = childDerivative.rowwise().mean();
+		Eigen::Array<T, Eigen::Dynamic, 1> meanDx =
+		(childDerivative * normalized).rowwise().mean();
+
+		return (
+			(childDerivative.colwise() - meanD) - normalized.colwise() * meanDx
+		).colwise() * this->values[1].col(0);
+	}
+	if(j == 0) {
+		return childDerivative.colwise() * this->values[1].col(0);
+	}
+	if(j == 1) {
+		return (childDerivative * this->values[0]).rowwise().sum();
+	}
+
+	return childDerivative.rowwise().sum();
+}
+
+
+
+template <typename T>
+ts::SoftmaxNode<T>::SoftmaxNode(
+	std::vector<long> shape,
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> output, int xDep
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->values = {output};
+	this->dependencies =  {xDep};
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::SoftmaxNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a softmax : dx = s * (d - s.d), for each column.
+
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &s = this->values[0];
+
+	return s * (
+		childDerivative.rowwise() - (childDerivative * s).colwise().sum()
+	);
+}
+
+
+
+template <typename T>
+ts::ReluNode<T>::ReluNode(
+	std::vector<long> shape, int xDep,
+	std::vector<uint32_t> newMask, T newSlope
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies =  {xDep};
+
+	mask = std::move(newMask);
+	slope = newSlope;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::ReluNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a (leaky) ReLU, selecting childDerivative or slope * childDerivative
+	// with the mask.
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment(
+		childDerivative.rows(), childDerivative.cols()
+	);
+
+	ts::maskKernel(
+		childDerivative.data(), childDerivative.size(),
+		mask.data(), slope, increment.data()
+	);
+
+	return increment;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::SigmoidNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a sigmoid : dx = s * (1 - s) * d
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment(
+		childDerivative.rows(), childDerivative.cols()
+	);
+
+	ts::sigmoidGradKernel(
+		this->values[0].data(), childDerivative.data(),
+		childDerivative.size(), increment.data()
+	);
+
+	return increment;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::TanhNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a tanh : dx = (1 - s^2) * d
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment(
+		childDerivative.rows(), childDerivative.cols()
+	);
+
+	ts::tanhGradKernel(
+		this->values[0].data(), childDerivative.data(),
+		childDerivative.size(), increment.data()
+	);
+
+	return increment;
+}
+
+
+
 	// ts::WengertList
 
 template <typename T>
@@ -215,6 +413,17 @@ int ts::WengertList<T>::reset() {
 
 
 
+template <typename T>
+void ts::WengertList<T>::clear() {
+	// Used when a model replaces all its parameters (for instance when loading
+	// a file), so that its old parameters don't remain in the list.
+
+	nodes.clear();
+	elementWiseOnly = true;
+}
+
+
+
 template <typename T>
 void ts::WengertList<T>::toggleOptimize(ts::Tensor<T> * tensor, bool enable) {
 
@@ -239,7 +448,7 @@ ts::Tensor<T>::Tensor(
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newValue,
 	ts::WengertList<T> * newWList
 ) {
-	value = newValue;
+	value = std::move(newValue);
 	wList = newWList;
 
 	if(wList != NULL) {
@@ -248,7 +457,7 @@ ts::Tensor<T>::Tensor(
 
 		// Node without dependencies (input var,)
 		std::shared_ptr<ts::Node<T>> nodePtr (
-			new ts::InputNode<T>({newValue.rows(), newValue.cols()}, false)
+			new ts::InputNode<T>({value.rows(), value.cols()}, false)
 		);
 
 		wList->nodes.push_back(nodePtr);
@@ -266,7 +475,7 @@ ts::Tensor<T>::Tensor(
 	ts::WengertList<T> * newWList,
 	bool model
 ) {
-	value = newValue;
+	value = std::move(newValue);
 	wList = newWList;
 
 	if(wList != NULL) {
@@ -275,7 +484,7 @@ ts::Tensor<T>::Tensor(
 
 		// Node without dependencies (input var,)
 		std::shared_ptr<ts::Node<T>> nodePtr (
-			new ts::InputNode<T>({newValue.rows(), newValue.cols()}, model)
+			new ts::InputNode<T>({value.rows(), value.cols()}, model)
 		);
 
 		wList->nodes.push_back(nodePtr);
@@ -292,7 +501,7 @@ ts::Tensor<T>::Tensor(
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newValue,
 	ts::WengertList<T> * newWList, std::shared_ptr<ts::Node<T>> node
 ) {
-	value = newValue;
+	value = std::move(newValue);
 	wList = newWList;
 
 	if(wList != NULL) {
@@ -37,7 +37,10 @@ ts::Tensor<T> ts::operator+(const ts::Tensor<T> &x, const ts::Tensor<T> &y){
 		)
 	);
 
-	return ts::Tensor<T>(x.value + y.value, x.wList, nodePtr);
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+	ts::addKernel(x.value.data(), y.value.data(), res.size(), res.data());
+
+	return ts::Tensor<T>(res, x.wList, nodePtr);
 }
 
 
@@ -70,7 +73,10 @@ ts::Tensor<T> ts::operator-(const ts::Tensor<T> &x, const ts::Tensor<T> &y){
 		)
 	);
 
-	return ts::Tensor<T>(x.value - y.value,x.wList, nodePtr);
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+	ts::subtractKernel(x.value.data(), y.value.data(), res.size(), res.data());
+
+	return ts::Tensor<T>(res, x.wList, nodePtr);
 }
 
 
@@ -100,7 +106,10 @@ ts::Tensor<T> ts::operator*(const ts::Tensor<T> &x, const ts::Tensor<T> &y){
 		)
 	);
 
-	return ts::Tensor<T>(x.value * y.value,x.wList, nodePtr);
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+	ts::multiplyKernel(x.value.data(), y.value.data(), res.size(), res.data());
+
+	return ts::Tensor<T>(res, x.wList, nodePtr);
 }
 
 
@@ -122,15 +131,24 @@ ts::Tensor<T> ts::operator/(const ts::Tensor<T> &x, const ts::Tensor<T> &y){
 	// da / dx = 1 / y
 	// da / dy = -x / y^2
 
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> dx(x.value.rows(), x.value.cols());
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> dy(x.value.rows(), x.value.cols());
+
+	ts::divideKernel(
+		x.value.data(), y.value.data(), res.size(),
+		res.data(), dx.data(), dy.data()
+	);
+
 	std::shared_ptr<ts::Node<T>> nodePtr (
 		new ts::ElementWiseNode<T>(
 			{x.value.rows(), x.value.cols()},
-			1.0 / y.value, x.index,
-			-x.value / (y.value * y.value), y.index
+			dx, x.index,
+			dy, y.index
 		)
 	);
 
-	return ts::Tensor<T>(x.value + y.value, x.wList, nodePtr);
+	return ts::Tensor<T>(res, x.wList, nodePtr);
 }
 
 
@@ -167,6 +185,139 @@ ts::Tensor<T> ts::matProd(const ts::Tensor<T> &x, const ts::Tensor<T> &y) {
 
 
 
+template <typename T>
+ts::Tensor<T> ts::broadcastAdd(const ts::Tensor<T> &x, const ts::Tensor<T> &y) {
+	// Sum of a matrix and a column vector repeated for each column
+	// (for instance, per-channel biases of a convolution layer)
+
+	if(
+		x.wList != y.wList ||
+		x.value.rows() != y.value.rows() ||
+		y.value.cols() != 1
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+	// a = x + y.1^T
+	// da / dx = 1
+	// da / dy = 1 (summed over the columns of a)
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::BroadcastNode<T>(
+			{x.value.rows(), x.value.cols()},
+			x.index, y.index
+		)
+	);
+
+	return ts::Tensor<T>(x.value.colwise() + y.value.col(0), x.wList, nodePtr);
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::batchNorm(
+	const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &mean,
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &variance,
+	T epsilon
+) {
+	// Normalization of each row of x (ie of each neuron, or each channel of a
+	// convolution output), followed by a learned affine transform
+
+	long rows = x.value.rows();
+
+	if(
+		x.wList != scale.wList || x.wList != shift.wList ||
+		scale.value.rows() != rows || scale.value.cols() != 1 ||
+		shift.value.rows() != rows || shift.value.cols() != 1 ||
+		mean.rows() != rows || mean.cols() != 1 ||
+		variance.rows() != rows || variance.cols() != 1
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+	// a = scale * xHat + shift, with xHat = (x - mean) / sqrt(variance + epsilon)
+	// da / dx = scale / sqrt(variance + epsilon)
+	// da / dscale = xHat (summed over the columns of a)
+	// da / dshift = 1 (summed over the columns of a)
+
+	Eigen::Array<T, Eigen::Dynamic, 1> invStd = (variance.col(0) + epsilon).rsqrt();
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> normalized =
+	(x.value.colwise() - mean.col(0)).colwise() * invStd;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res =
+	(normalized.colwise() * scale.value.col(0)).colwise() + shift.value.col(0);
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::BatchNormNode<T>(
+			{rows, x.value.cols()},
+			std::move(normalized), scale.value * invStd,
+			x.index, scale.index, shift.index
+		)
+	);
+
+	return ts::Tensor<T>(std::move(res), x.wList, nodePtr);
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::batchNorm(
+	const ts::Tensor<T> &x, const ts::Tensor<T> &scale, const ts::Tensor<T> &shift,
+	T epsilon
+) {
+	// Normalization of each row of x with its own mean and variance (ie over
+	// the positions of a convolution channel), followed by a learned affine
+	// transform
+
+	long rows = x.value.rows();
+
+	if(
+		x.wList != scale.wList || x.wList != shift.wList ||
+		scale.value.rows() != rows || scale.value.cols() != 1 ||
+		shift.value.rows() != rows || shift.value.cols() != 1
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+	// a = scale * xHat + shift, with xHat = (x - mean) / sqrt(variance + epsilon)
+	// and mean, variance computed over the N columns of x
+	// da / dx = scale / sqrt(variance + epsilon) * (d - mean(d) - xHat * mean(d * xHat))
+	// da / dscale = xHat (summed over the columns of a)
+	// da / dshift = 1 (summed over the columns of a)
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> normalized =
+	x.value.colwise() - x.value.rowwise().mean();
+	Eigen::Array<T, Eigen::Dynamic, 1> invStd =
+	(normalized.square().rowwise().mean() + epsilon).rsqrt();
+	normalized.colwise() *= invStd;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res =
+	(normalized.colwise() * scale.value.col(0)).colwise() + shift.value.col(0);
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::BatchNormNode<T>(
+			{rows, x.value.cols()},
+			std::move(normalized), scale.value * invStd,
+			x.index, scale.index, shift.index, true
+		)
+	);
+
+	return ts::Tensor<T>(std::move(res), x.wList, nodePtr);
+}
+
+
+
 	// Activation functions
 
 template <typename T>
@@ -174,16 +325,21 @@ ts::Tensor<T> ts::sigmoid(const ts::Tensor<T> &x) {
 	// Element-wise sigmoid function
 
 	// a = e^x / (e^x + 1) = 1 / (1 + e^-x)
-	// da / dx = e^x / (e^x + 1)^2
+	// da / dx = e^x / (e^x + 1)^2 = a * (1 - a)
+	// (computed from a in the backward pass)
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+
+	ts::sigmoidKernel(x.value.data(), x.value.size(), res.data());
 
 	std::shared_ptr<ts::Node<T>> nodePtr (
-		new ts::ElementWiseNode<T>(
+		new ts::SigmoidNode<T>(
 			{x.value.rows(), x.value.cols()},
-			x.value.exp() / (x.value.exp() + 1).pow(2), x.index
+			res, x.index
 		)
 	);
 
-	return ts::Tensor<T>(x.value.exp() / (x.value.exp() + 1), x.wList, nodePtr);
+	return ts::Tensor<T>(std::move(res), x.wList, nodePtr);
 }
 
 
@@ -193,31 +349,22 @@ ts::Tensor<T> ts::relu(const ts::Tensor<T> &x) {
 	// Element-wise ReLU function
 	// a = max(0, x)
 	// da / dx = 0 if x<= 0 ; 1 if x > 0
-	// Output is then rescaled between 0 and 1
-
-	// Apply cwise max function
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
-	res.resize(x.value.rows(), x.value.cols());
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> dx;
-	dx.resize(x.value.rows(), x.value.cols());
 
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+	std::vector<uint32_t> mask(ts::maskSize(x.value.size()));
 
-	// #pragma omp parallel for schedule(auto)
-	for(unsigned i=0; i<res.size(); i++) {
-		res(i) = (x.value(i) <= 0) ? 0 : x.value(i);
-		dx(i) = (x.value(i) <= 0) ? 0 : 1;
-	}
+	ts::reluKernel(x.value.data(), x.value.size(), res.data(), mask.data());
 
 
 	// Return value
 	std::shared_ptr<ts::Node<T>> nodePtr (
-		new ts::ElementWiseNode<T>(
+		new ts::ReluNode<T>(
 			{x.value.rows(), x.value.cols()},
-			dx, x.index
+			x.index, std::move(mask), (T) 0
 		)
 	);
 
-	return ts::Tensor<T>(res, x.wList, nodePtr);
+	return ts::Tensor<T>(std::move(res), x.wList, nodePtr);
 
 }
 
@@ -225,39 +372,78 @@ ts::Tensor<T> ts::relu(const ts::Tensor<T> &x) {
 
 template <typename T>
 ts::Tensor<T> ts::leakyRelu(const ts::Tensor<T> &x) {
-	// Element-wise ReLU function
-	// a = max(0, x)
-	// da / dx = 0 if x<= 0 ; 1 if x > 0
-	// Output is then rescaled between 0 and 1
-
-	// Apply cwise max function
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
-	res.resize(x.value.rows(), x.value.cols());
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> dx;
-	dx.resize(x.value.rows(), x.value.cols());
+	// Element-wise leaky ReLU function
+	// a = x if x > 0 ; 0.1 * x if x <= 0
+	// da / dx = 1 if x > 0 ; 0.1 if x <= 0
 
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+	std::vector<uint32_t> mask(ts::maskSize(x.value.size()));
 
-	// #pragma omp parallel for schedule(auto)
-	for(unsigned i=0; i<res.size(); i++) {
-			res(i) = (x.value(i) <= 0) ? 0.1 * x.value(i) : x.value(i);
-			dx(i) = (x.value(i) <= 0) ? 0.1 : 1;
-	}
+	ts::leakyReluKernel(x.value.data(), x.value.size(), (T) TS_LEAKY_RELU_SLOPE, res.data(), mask.data());
 
 
 	// Return value
 	std::shared_ptr<ts::Node<T>> nodePtr (
-		new ts::ElementWiseNode<T>(
+		new ts::ReluNode<T>(
 			{x.value.rows(), x.value.cols()},
-			dx, x.index
+			x.index, std::move(mask), (T) TS_LEAKY_RELU_SLOPE
 		)
 	);
 
-	return ts::Tensor<T>(res, x.wList, nodePtr);
+	return ts::Tensor<T>(std::move(res), x.wList, nodePtr);
 
 }
 
 
 
+template <typename T>
+ts::Tensor<T> ts::tanh(const ts::Tensor<T> &x) {
+	// Element-wise hyperbolic tangent
+	// a = tanh(x)
+	// da / dx = 1 - a^2
+	// (computed from a in the backward pass)
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+
+	ts::tanhKernel(x.value.data(), x.value.size(), res.data());
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::TanhNode<T>(
+			{x.value.rows(), x.value.cols()},
+			res, x.index
+		)
+	);
+
+	return ts::Tensor<T>(std::move(res), x.wList, nodePtr);
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::softmax(const ts::Tensor<T> &x) {
+	// Softmax of each column (for instance, class probabilities)
+	// a_i = e^x_i / sum_k(e^x_k)
+	// da_i / dx_k = a_i * (1{i == k} - a_k)
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(x.value.rows(), x.value.cols());
+
+	ts::softmaxKernel(x.value.data(), x.value.rows(), x.value.cols(), res.data());
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::SoftmaxNode<T>(
+			{x.value.rows(), x.value.cols()},
+			res, x.index
+		)
+	);
+
+	return ts::Tensor<T>(std::move(res), x.wList, nodePtr);
+}
+
+
+
 template <typename T>
 ts::Tensor<T> ts::rescale(const ts::Tensor<T> &x) {
 	// Rescales tensor to 1
@@ -314,3 +500,48 @@ ts::Tensor<T> ts::squaredNorm(const ts::Tensor<T> &x) {
 
 	return ts::Tensor<T>(res, x.wList, nodePtr);
 }
+
+
+
+template <typename T>
+ts::Tensor<T> ts::softmaxCrossEntropy(
+	const ts::Tensor<T> &x, const std::vector<unsigned> &labels
+) {
+	// Classification loss on logits (one sample per column)
+	// a = sum_j(-log(softmax(x_j)_label_j))
+	// da / dx = softmax(x) - onehot(labels)
+
+	if(labels.size() != (size_t) x.value.cols()) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+	for(unsigned label : labels) {
+		if(label >= x.value.rows()) {
+			return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+		}
+	}
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> dx(x.value.rows(), x.value.cols());
+
+	Eigen::Array<T, 1, 1> res;
+	res << ts::softmaxCrossEntropyKernel(
+		x.value.data(), x.value.rows(), x.value.cols(), labels.data(), dx.data()
+	);
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::ScalarNode<T>(
+			{1, 1}, dx, x.index
+		)
+	);
+
+	return ts::Tensor<T>(res, x.wList, nodePtr);
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::identity(const ts::Tensor<T> &x) {
+	return x;
+}
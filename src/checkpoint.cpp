@@ -0,0 +1,68 @@
+/*
+* Asynchronous checkpoint writer : model parameters are copied on the calling
+* thread, then written to a binary file in the background.
+*/
+
+#include "../include/checkpoint.hpp"
+
+
+
+	// ts::CheckpointWriter
+
+template <typename T>
+ts::CheckpointWriter<T>::CheckpointWriter() {
+}
+
+
+
+template <typename T>
+ts::CheckpointWriter<T>::~CheckpointWriter() {
+	wait();
+}
+
+
+
+template <typename T>
+bool ts::CheckpointWriter<T>::writeFile(
+	std::string filePath, ts::ModelSnapshot<T> &snapshot
+) {
+	std::string tmpPath = filePath + ".tmp";
+
+	if(!ts::writeBinarySnapshot(tmpPath, snapshot)) {
+		return false;
+	}
+
+	return ts::commitFile(tmpPath, filePath);
+}
+
+
+
+template <typename T>
+void ts::CheckpointWriter<T>::write(ts::Model<T> &model, std::string filePath) {
+	wait();
+
+	// Only the copy of the parameters is done on the calling thread, so the
+	// model can be updated as soon as we return
+	ts::ModelSnapshot<T> snapshot = model.snapshot();
+
+	worker = std::thread(
+		[this, filePath, snapshot = std::move(snapshot)]() mutable {
+			succeeded = writeFile(filePath, snapshot);
+		}
+	);
+}
+
+
+
+template <typename T>
+bool ts::CheckpointWriter<T>::wait() {
+	if(worker.joinable()) {
+		worker.join();
+
+		if(!succeeded) {
+			std::cout << "ERROR: Could not write checkpoint" << std::endl;
+		}
+	}
+
+	return succeeded;
+}
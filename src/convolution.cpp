@@ -124,25 +124,68 @@ ts::Tensor<T> ts::convolution(const ts::Tensor<T> &mat, const ts::Tensor<T> &ker
 
 
 
-	// Max pooling
+	// Pooling
+
+template <typename T>
+static bool poolingGeometry(
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &x,
+	std::vector<unsigned> &pool,
+	std::vector<unsigned> &stride,
+	std::vector<unsigned> &padding,
+	unsigned nChannels,
+	ts::ConvGeometry &geometry
+) {
+	// Pools are described as convolution kernels without dilation (stride is
+	// the pool size by default), on one channel of the packed map x. Returns
+	// false if the pooling is invalid.
+
+	if(stride.size() == 0) {
+		stride = pool;
+	}
+
+	if(
+		pool.size() != 2 || stride.size() != 2 || padding.size() != 2 ||
+		nChannels == 0 || x.rows() % nChannels != 0
+	) {
+		return false;
+	}
+
+	long rows = x.rows() / nChannels;
+
+	geometry = ts::convGeometry(
+		{rows, x.cols()},
+		{pool[0], pool[1]}, {stride[0], stride[1]},
+		{padding[0], padding[1]}, {1, 1}
+	);
+
+	geometry.outRows = ts::poolingOutputSize(rows, pool[0], stride[0], padding[0]);
+	geometry.outCols = ts::poolingOutputSize(x.cols(), pool[1], stride[1], padding[1]);
+
+	return geometry.outRows != 0 && geometry.outCols != 0;
+}
+
+
 
 template <typename T>
 ts::PoolingNode<T>::PoolingNode(
-	std::vector<long> shape,
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> xVal, int xDep,
-	std::vector<unsigned> newPool
+	std::vector<long> shape, int xDep,
+	std::vector<long> newInputShape,
+	std::vector<long> newArgmax,
+	bool newOverlap
 ) {
 
-	// PoolingNode specific constructor to store the size of pools
-	// (this allows us to easily upscale the matrix in grad computation)
+	// PoolingNode specific constructor to store the position of the max
+	// element of each pool (this is all we need in grad computation)
 
 	this->rows = shape[0];
 	this->cols = shape[1];
 
-	this->values =  {xVal};	// [da/dx]
 	this->dependencies =  {xDep};
 
-	pool = newPool;
+	inputRows = newInputShape[0];
+	inputCols = newInputShape[1];
+	argmax = std::move(newArgmax);
+	overlap = newOverlap;
 }
 
 
@@ -154,55 +197,163 @@ Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::PoolingNode<T>::incrementGra
 ) {
 
 	// Used in the  ts::Tensor::grad() method. Computes the increment of a derivative
-	// for a max pooling / downsample operation.
+	// for a max pooling / downsample operation : each coefficient of
+	// childDerivative goes to the max element of its pool.
 
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.setZero(inputRows, inputCols);
 
-	// Upsample matrix of child derivative to match original size
+	// Max elements are all different if pools don't overlap
+	if(!overlap) {
+		#pragma omp parallel for
+		for(long i=0; i<childDerivative.size(); i++) {
+			res(argmax[i]) = childDerivative(i);
+		}
+	}
+	else {
+		for(long i=0; i<childDerivative.size(); i++) {
+			res(argmax[i]) += childDerivative(i);
+		}
+	}
 
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> upsample;
-	upsample.setZero(this->values[j].rows(), this->values[j].cols());
+	return res;
+}
 
 
-	// Affect coefficients of childDerivative to upsample pools by filling each
-	// pool with the corresponding value
 
-	for(unsigned i=0; i<childDerivative.cols(); i++) {
-		for(unsigned j=0; j<childDerivative.rows(); j++) {
+template <typename T>
+ts::Tensor<T> ts::maxPooling(
+	const ts::Tensor<T> &x, std::vector<unsigned> pool,
+	std::vector<unsigned> stride, std::vector<unsigned> padding,
+	unsigned nChannels
+) {
+	// Max pooling operation : we keep only the biggest element in each pool
+	// in order to reduce the size of a matrix
+	// Without stride and padding, resulting matrix is of size :
+	// (mat.x / pool.x, mat.y / pool.y)
 
-			// Fill one pool with one value
-			for(unsigned k=0; k<pool[1]; k++) {
-				for(unsigned l=0; l<pool[0]; l++) {
-					upsample(j * pool[0] + l, i * pool[1] + k) =
-					childDerivative(j, i);
-				}
+	ts::ConvGeometry g;
+	if(!poolingGeometry(x.value, pool, stride, padding, nChannels, g)) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(nChannels * g.outRows, g.outCols);
+	std::vector<long> argmax(res.size());
+
+	// Pools are clipped to the channel, so that padding is never selected
+	#pragma omp parallel for collapse(2)
+	for(long ch=0; ch<(long) nChannels; ch++) {
+		for(long c=0; c<g.outCols; c++) {
+			long outRow = ch * g.outRows;
+			long * channelArgmax = argmax.data() + outRow + c * res.rows();
+
+			ts::maxPoolKernel(
+				x.value.data() + ch * g.rows, x.value.rows(),
+				g, c, c + 1,
+				res.data() + outRow + c * res.rows(), channelArgmax, res.rows()
+			);
+
+			// Positions in the whole input
+			for(long r=0; r<g.outRows; r++) {
+				channelArgmax[r] += ch * g.rows;
 			}
 		}
 	}
 
 
-	// Compute & return element-wise product with the this->values
-	// (since this->values is 0/1-flled, we will only get the coefficients in
-	// the desired positions, and 0 anywhere else)
-	return upsample * this->values[j];
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::PoolingNode<T>(
+			{res.rows(), res.cols()},
+			x.index,
+			{x.value.rows(), x.value.cols()},
+			std::move(argmax),
+			g.strideRows < g.kernelRows || g.strideCols < g.kernelCols
+		)
+	);
+
+	return ts::Tensor<T>(res, x.wList, nodePtr);
 }
 
 
 
 template <typename T>
-ts::Tensor<T> ts::maxPooling(const ts::Tensor<T> &x, std::vector<unsigned> pool) {
-	// Max pooling operation : we keep only the biggest element in each pool
-	// in order to reduce the size of a matrix
-	// Resulting matrix is of size : (mat.x / pool.x, mat.y / pool.y)
-	// (where mat.x >= pool.x and mat.y >= pool.y)
+ts::AveragePoolingNode<T>::AveragePoolingNode(
+	std::vector<long> shape, int xDep,
+	ts::ConvGeometry newGeometry,
+	unsigned newNChannels
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
 
-	if(pool.size() != 2) {
-		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	this->dependencies =  {xDep};
+
+	geometry = newGeometry;
+	nChannels = newNChannels;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::AveragePoolingNode<T>::incrementGradient(
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+	unsigned &j
+) {
+
+	// Used in the  ts::Tensor::grad() method. Each coefficient of
+	// childDerivative is spread uniformly on its pool.
+
+	const ts::ConvGeometry &g = geometry;
+	T scale = 1 / (T) (g.kernelRows * g.kernelCols);
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.setZero(nChannels * g.rows, g.cols);
+
+	// Channels never share input elements, and pools of different output
+	// columns only share input columns if they overlap
+	bool overlap = g.strideCols < g.kernelCols;
+	long nThreadCols = overlap ? 1 : g.outCols;
+
+	#pragma omp parallel for collapse(2)
+	for(long ch=0; ch<(long) nChannels; ch++) {
+		for(long t=0; t<nThreadCols; t++) {
+			long cEnd = overlap ? g.outCols : t + 1;
+
+			for(long c=t; c<cEnd; c++) {
+				long y0 = std::max(c * g.strideCols - g.paddingCols, 0L);
+				long y1 = std::min(c * g.strideCols - g.paddingCols + g.kernelCols, g.cols);
+
+				for(long r=0; r<g.outRows; r++) {
+					long x0 = std::max(r * g.strideRows - g.paddingRows, 0L);
+					long x1 = std::min(r * g.strideRows - g.paddingRows + g.kernelRows, g.rows);
+
+					res.block(ch * g.rows + x0, y0, x1 - x0, y1 - y0) +=
+					childDerivative(ch * g.outRows + r, c) * scale;
+				}
+			}
+		}
 	}
 
-	if(
-		x.value.rows() % pool[0] != 0 ||
-		x.value.cols() % pool[1] != 0
-	) {
+	return res;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::averagePooling(
+	const ts::Tensor<T> &x, std::vector<unsigned> pool,
+	std::vector<unsigned> stride, std::vector<unsigned> padding,
+	unsigned nChannels
+) {
+	// Average pooling operation : each pool is replaced by the mean of its
+	// elements (padding counts as zeros)
+
+	ts::ConvGeometry g;
+	if(!poolingGeometry(x.value, pool, stride, padding, nChannels, g)) {
 		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
 	}
 
@@ -210,59 +361,103 @@ ts::Tensor<T> ts::maxPooling(const ts::Tensor<T> &x, std::vector<unsigned> pool)
 	x.wList->elementWiseOnly = false;
 
 
-	// Init result
 	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
-	res.setZero(x.value.rows() / pool[0], x.value.cols() / pool[1]);
+	res.resize(nChannels * g.outRows, g.outCols);
+
+	#pragma omp parallel for collapse(2)
+	for(long ch=0; ch<(long) nChannels; ch++) {
+		for(long c=0; c<g.outCols; c++) {
+			ts::averagePoolKernel(
+				x.value.data() + ch * g.rows, x.value.rows(),
+				g, c, c + 1,
+				res.data() + ch * g.outRows + c * res.rows(), res.rows()
+			);
+		}
+	}
+
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::AveragePoolingNode<T>(
+			{res.rows(), res.cols()},
+			x.index,
+			g,
+			nChannels
+		)
+	);
 
+	return ts::Tensor<T>(res, x.wList, nodePtr);
+}
 
-	// Init dx
-	// (dx is 1 for each max element, 0 elsewhere)
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> dx;
-	dx.setZero(x.value.rows(), x.value.cols());
 
 
-	unsigned xMax, yMax;
-	T maxVal;
+template <typename T>
+ts::GlobalAveragePoolingNode<T>::GlobalAveragePoolingNode(
+	std::vector<long> shape, int xDep,
+	std::vector<long> newInputShape
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
 
+	this->dependencies =  {xDep};
 
-	// Compute both pooled matrix (res) and dx
-	// #pragma omp parallel for collapse(2) schedule(auto)
-	for(unsigned i=0; i<res.cols(); i++) {
-		for(unsigned j=0; j<res.rows(); j++) {
+	inputRows = newInputShape[0];
+	inputCols = newInputShape[1];
+}
 
-			// Get index of pool's max element
-			// (for now it seems the best way is to manually iterate over
-			// elements)
 
-			xMax = j * pool[0];
-			yMax = i * pool[1];
-			maxVal = x.value(j * pool[0], i * pool[1]);
 
-			for(unsigned k=0; k<pool[1]; k++) {
-				for(unsigned l=0; l<pool[0]; l++) {
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::GlobalAveragePoolingNode<T>::incrementGradient(
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+	unsigned &j
+) {
 
-					if(x.value(j * pool[1] + l, i * pool[0] + k) > maxVal) {
-						maxVal = x.value(j * pool[1] + l, i * pool[0] + k);
-						xMax = j * pool[1] + l;
-						yMax = i * pool[0] + k;
-					}
+	// Used in the  ts::Tensor::grad() method. The derivative of each channel
+	// mean is spread uniformly on its channel.
 
-				}
-			}
+	long channelRows = inputRows / this->rows;
+	T scale = 1 / (T) (channelRows * inputCols);
 
-			// Assigning values for result and derivative
-			res(j, i) = maxVal;
-			dx(xMax, yMax) = 1.0;
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(inputRows, inputCols);
 
-		}
+	for(long c=0; c<this->rows; c++) {
+		res.middleRows(c * channelRows, channelRows).setConstant(
+			childDerivative(c, 0) * scale
+		);
+	}
+
+	return res;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::globalAveragePooling(const ts::Tensor<T> &x, unsigned nChannels) {
+	// Global average pooling : each channel of the packed map is replaced by
+	// the mean of its elements
+
+	if(nChannels == 0 || x.value.size() == 0 || x.value.rows() % nChannels != 0) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+	long channelRows = x.value.rows() / nChannels;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(nChannels, 1);
+	for(long c=0; c<(long) nChannels; c++) {
+		res(c, 0) = x.value.middleRows(c * channelRows, channelRows).mean();
 	}
 
 
 	std::shared_ptr<ts::Node<T>> nodePtr (
-		new ts::PoolingNode<T>(
+		new ts::GlobalAveragePoolingNode<T>(
 			{res.rows(), res.cols()},
-			dx, x.index,
-			pool
+			x.index,
+			{x.value.rows(), x.value.cols()}
 		)
 	);
 
@@ -516,6 +711,89 @@ ts::Tensor<T> ts::vertCat(const std::vector<ts::Tensor<T>> &x) {
 
 
 
+	// Horizontal concatenation
+
+template <typename T>
+ts::HorCatNode<T>::HorCatNode(
+	std::vector<long> shape,
+	std::vector<int> newDependencies,
+	std::vector<long> newWidths
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies =  newDependencies;
+
+	widths = newWidths;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::HorCatNode<T>::incrementGradient(
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+	unsigned &j
+) {
+
+	// Used in the  ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a horizontal concatenation (the columns of parent j).
+
+	return childDerivative.middleCols(widths[j], widths[j+1] - widths[j]);
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::horCat(const std::vector<ts::Tensor<T>> &x) {
+	// Horizontal concatenation operation
+	// x[i] will be on the right of x[i-1]
+
+	if(x.size() == 0) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	if(x.size() == 1) {
+		return x[0];
+	}
+
+	// The gradient will have to be computed for a scalar
+	x[0].wList->elementWiseOnly = false;
+
+	std::vector<long> widths = {0}; // Values are cumulative starting columns
+	long height = x[0].value.rows();
+	long width = 0;
+	std::vector<int> dependencies = {};
+
+	for(unsigned i=0; i<x.size(); i++) {
+
+		if(x[i].value.rows() != height || x[i].wList != x[0].wList) {
+			return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+		}
+
+		width += x[i].value.cols();
+		widths.push_back(width);
+		dependencies.push_back(x[i].index);
+	}
+
+	// Columns are contiguous in col-major arrays
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res(height, width);
+	for(unsigned i=0; i<x.size(); i++) {
+		res.middleCols(widths[i], widths[i+1] - widths[i]) = x[i].value;
+	}
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::HorCatNode<T>(
+			{res.rows(), res.cols()},
+			dependencies,
+			widths
+		)
+	);
+
+	return ts::Tensor<T>(std::move(res), x[0].wList, nodePtr);
+}
+
+
+
 	// Flattening
 
 template <typename T>
@@ -610,7 +888,10 @@ ts::Im2ColNode<T>::Im2ColNode(
 	std::vector<int> newDependencies,
 	std::vector<long> newKernelDim,
 	std::vector<long> newMatrixDim,
-	unsigned newNChannels
+	unsigned newNChannels,
+	std::vector<long> newStride,
+	std::vector<long> newPadding,
+	std::vector<long> newDilation
 ) {
 	// New tensor shape (vector)
 	this->rows = shape[0];
@@ -622,6 +903,10 @@ ts::Im2ColNode<T>::Im2ColNode(
 	kernelDim = newKernelDim;
 	matrixDim = newMatrixDim;
 	nChannels = newNChannels;
+
+	stride = newStride;
+	padding = newPadding;
+	dilation = newDilation;
 }
 
 
@@ -637,115 +922,1674 @@ Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::Im2ColNode<T>::incrementGrad
 
 	// childDerivative has the shape of the final matrix.
 	// The increment will have the shape of one input matrix (this method will
-	// be called once for each channel)
-
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> mat;
-	mat.setZero(matrixDim[0], matrixDim[1]);
+	// be called once for each channel), or of the whole packed map.
 
-	// This matrix will be converted back to "normal" shape
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> im2colMat = childDerivative.block(
-		j * kernelDim[0] * kernelDim[1], 0,
-		kernelDim[0] * kernelDim[1], childDerivative.cols()
-	);
+	bool packed = this->dependencies.size() == 1;
 
-	for(unsigned i=0; i<im2colMat.cols(); i++) {
-		// Each column is a col-major flattened submatrix
-		for(unsigned j=0; j<im2colMat.rows(); j++) {
-			// Get top left coords of submatrix
-			int submatTopX = i / (matrixDim[0] - kernelDim[0] + 1);
-			int submatTopY = i % (matrixDim[0] - kernelDim[0] + 1);
+	if(j == 0) {
+		ts::ConvGeometry geometry = ts::convGeometry(
+			matrixDim, kernelDim, stride, padding, dilation
+		);
+		long patchSize = kernelDim[0] * kernelDim[1];
+		long ld = childDerivative.rows();
 
-			// Get coords in submatrix
-			int submatX = j / kernelDim[1];
-			int submatY = j % kernelDim[1];
+		// Channel i of the increments starts at channels[i]
+		std::vector<T *> channels(nChannels);
+		long channelStride = packed ? nChannels * matrixDim[0] : matrixDim[0];
 
-			// Add derivative to coords in original matrix
-			mat(submatTopX + submatX, submatTopY + submatY) =
-			mat(submatTopX + submatX, submatTopY + submatY) + im2colMat(j, i);
+		increments = std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>(
+			this->dependencies.size()
+		);
+		for(unsigned i=0; i<increments.size(); i++) {
+			increments[i].setZero(channelStride, matrixDim[1]);
+		}
+		for(unsigned i=0; i<nChannels; i++) {
+			channels[i] = packed ?
+			increments[0].data() + i * matrixDim[0] : increments[i].data();
+		}
 
+		// Patches of output rows at least nPhases apart don't overlap, so
+		// they can be scattered in parallel
+		long extent = dilation[0] * (kernelDim[0] - 1) + 1;
+		long nPhases = (extent + stride[0] - 1) / stride[0];
+
+		for(long phase=0; phase<nPhases && phase<geometry.outRows; phase++) {
+			long nPhaseRows = (geometry.outRows - phase + nPhases - 1) / nPhases;
+
+			#pragma omp parallel for collapse(2) schedule(static)
+			for(long i=0; i<(long) nChannels; i++) {
+				for(long k=0; k<nPhaseRows; k++) {
+					long r = phase + k * nPhases;
+
+					ts::im2colScatter(
+						childDerivative.data() + i * patchSize +
+						r * geometry.outCols * ld, ld,
+						geometry, r, r + 1,
+						channels[i], channelStride
+					);
+				}
+			}
 		}
 	}
 
-	return mat;
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment =
+	std::move(increments[j]);
+
+	if(j == increments.size() - 1) {
+		increments.clear();
+	}
+
+	return increment;
 }
 
 
 
 template <typename T>
-ts::Tensor<T> ts::im2col(
-	const std::vector<ts::Tensor<T>> &x,
-	std::vector<unsigned> kernelDim
+TS_TARGET_CLONES
+void ts::maxPoolKernel(
+	const T * src, long srcStride,
+	const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+	T * dst, long * argmax, long dstStride
 ) {
-	// Turns a tensor vector into a single im2col matrix
-	// Using a kernels matrix, one entire conv layer could be computed in
-	// only one matrix product
+	// Pools are scanned in col-major order, keeping the first max (as
+	// Eigen's maxCoeff)
 
-	std::vector<int> dependencies = {};
-
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
-	res.resize(
-		kernelDim[0] * kernelDim[1] * x.size(),
-		(x[0].value.rows() - kernelDim[0] + 1) * (x[0].value.cols() - kernelDim[1] + 1)
-	);
+	const ts::ConvGeometry &g = geometry;
 
-	for(unsigned i=0; i<x.size(); i++) {
-		// #pragma omp parallel for collapse(2) schedule(auto)
-		for(unsigned j=0; j<x[i].value.cols() - kernelDim[0] + 1; j++) {
-			for(unsigned k=0; k<x[i].value.rows() - kernelDim[1] + 1; k++) {
-
-				Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> tmp =
-				x[i].value.block(k, j, kernelDim[0], kernelDim[1]);
+	for(long c=colBegin; c<colEnd; c++) {
+		long y0 = std::max(c * g.strideCols - g.paddingCols, 0L);
+		long y1 = std::min(c * g.strideCols - g.paddingCols + g.kernelCols, g.cols);
 
-				Eigen::Map<Eigen::Array<T, -1, 1>> map =
-				Eigen::Map<Eigen::Array<T, -1, 1>>(
-					tmp.data(), tmp.cols() * tmp.rows()
-				);
+		T * out = dst + (c - colBegin) * dstStride;
+		long * outArgmax = argmax + (c - colBegin) * dstStride;
 
-				res.block(i * kernelDim[0] * kernelDim[1], k * (x[i].value.rows() - kernelDim[0] + 1)  + j, kernelDim[0] * kernelDim[1], 1)
-				= map;
+		for(long r=0; r<g.outRows; r++) {
+			long x0 = std::max(r * g.strideRows - g.paddingRows, 0L);
+			long x1 = std::min(r * g.strideRows - g.paddingRows + g.kernelRows, g.rows);
 
+			long best = x0 + y0 * srcStride;
+			for(long y=y0; y<y1; y++) {
+				for(long x=x0; x<x1; x++) {
+					long i = x + y * srcStride;
+					if(src[i] > src[best]) {
+						best = i;
+					}
+				}
 			}
-		}
 
-		dependencies.push_back(x[i].index);
+			out[r] = src[best];
+			outArgmax[r] = best;
+		}
 	}
-
-
-	// Return
-	std::shared_ptr<ts::Node<T>> nodePtr (
-		new ts::Im2ColNode<T>(
-			{res.rows(), res.cols()},
-			dependencies,
-			{kernelDim[0], kernelDim[1]},
-			{x[0].value.rows(), x[0].value.cols()},
-			x.size()
-		)
-	);
-
-	return ts::Tensor<T>(res, x[0].wList, nodePtr);
 }
 
 
 
-	// Col2im
-
 template <typename T>
-ts::Col2ImNode<T>::Col2ImNode(
-	std::vector<long> shape,
-	int xDep,
-	unsigned newPosition,
-	long newNChannels
+TS_TARGET_CLONES
+void ts::averagePoolKernel(
+	const T * src, long srcStride,
+	const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+	T * dst, long dstStride
 ) {
-	// New tensor shape (vector)
-	this->rows = shape[0];
-	this->cols = shape[1];
+	// The columns of the pools are summed first (contiguous, vectorized),
+	// then each pool sums its rows. Padding counts as zeros.
 
-	this->dependencies =  {xDep};
+	const ts::ConvGeometry &g = geometry;
+	T scale = 1 / (T) (g.kernelRows * g.kernelCols);
 
-	// Original matrix size
-	position = newPosition;
-	nChannels = newNChannels;
-}
+	std::vector<T> rowSums(g.rows);
+
+	for(long c=colBegin; c<colEnd; c++) {
+		long y0 = std::max(c * g.strideCols - g.paddingCols, 0L);
+		long y1 = std::min(c * g.strideCols - g.paddingCols + g.kernelCols, g.cols);
+
+		std::fill(rowSums.begin(), rowSums.end(), (T) 0);
+		for(long y=y0; y<y1; y++) {
+			const T * in = src + y * srcStride;
+			for(long x=0; x<g.rows; x++) {
+				rowSums[x] += in[x];
+			}
+		}
+
+		T * out = dst + (c - colBegin) * dstStride;
+
+		for(long r=0; r<g.outRows; r++) {
+			long x0 = std::max(r * g.strideRows - g.paddingRows, 0L);
+			long x1 = std::min(r * g.strideRows - g.paddingRows + g.kernelRows, g.rows);
+
+			T sum = 0;
+			for(long x=x0; x<x1; x++) {
+				sum += rowSums[x];
+			}
+			out[r] = sum * scale;
+		}
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::im2colPack(
+	const T * src, long srcStride,
+	const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+	T * dst, long dstStride
+) {
+	const ts::ConvGeometry &g = geometry;
+
+	for(long r=rowBegin; r<rowEnd; r++) {
+		long x0 = r * g.strideRows - g.paddingRows;
+		long xEnd = x0 + g.dilationRows * (g.kernelRows - 1);
+
+		// Whole patch column inside the matrix : contiguous copies
+		bool contiguous =
+			g.dilationRows == 1 && x0 >= 0 && xEnd < g.rows;
+
+		for(long c=0; c<g.outCols; c++) {
+			long y0 = c * g.strideCols - g.paddingCols;
+			T * col = dst + ((r - rowBegin) * g.outCols + c) * dstStride;
+
+			for(long kc=0; kc<g.kernelCols; kc++) {
+				long y = y0 + kc * g.dilationCols;
+				T * out = col + kc * g.kernelRows;
+
+				if(y < 0 || y >= g.cols) {
+					std::fill(out, out + g.kernelRows, (T) 0);
+					continue;
+				}
+
+				const T * in = src + y * srcStride;
+
+				if(contiguous) {
+					std::copy(in + x0, in + x0 + g.kernelRows, out);
+				} else {
+					for(long kr=0; kr<g.kernelRows; kr++) {
+						long x = x0 + kr * g.dilationRows;
+						out[kr] = (x >= 0 && x < g.rows) ? in[x] : (T) 0;
+					}
+				}
+			}
+		}
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::im2colScatter(
+	const T * src, long srcStride,
+	const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+	T * dst, long dstStride
+) {
+	const ts::ConvGeometry &g = geometry;
+
+	for(long r=rowBegin; r<rowEnd; r++) {
+		long x0 = r * g.strideRows - g.paddingRows;
+		long xEnd = x0 + g.dilationRows * (g.kernelRows - 1);
+
+		bool contiguous =
+			g.dilationRows == 1 && x0 >= 0 && xEnd < g.rows;
+
+		for(long c=0; c<g.outCols; c++) {
+			long y0 = c * g.strideCols - g.paddingCols;
+			const T * col = src + ((r - rowBegin) * g.outCols + c) * srcStride;
+
+			for(long kc=0; kc<g.kernelCols; kc++) {
+				long y = y0 + kc * g.dilationCols;
+
+				// Derivatives of padding elements are discarded
+				if(y < 0 || y >= g.cols) {
+					continue;
+				}
+
+				const T * in = col + kc * g.kernelRows;
+				T * out = dst + y * dstStride;
+
+				if(contiguous) {
+					for(long kr=0; kr<g.kernelRows; kr++) {
+						out[x0 + kr] += in[kr];
+					}
+				} else {
+					for(long kr=0; kr<g.kernelRows; kr++) {
+						long x = x0 + kr * g.dilationRows;
+						if(x >= 0 && x < g.rows) {
+							out[x] += in[kr];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::im2col(
+	const std::vector<ts::Tensor<T>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+) {
+	// Turns a tensor vector into a single im2col matrix
+	// Using a kernels matrix, one entire conv layer could be computed in
+	// only one matrix product
+	// Each column contains the (col-major flattened) elements of one input
+	// patch for all channels. Columns are ordered according to the row-major
+	// position of the patch in the output feature map.
+
+	if(
+		x.size() == 0 || kernelDim.size() != 2 || stride.size() != 2 ||
+		padding.size() != 2 || dilation.size() != 2
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	ts::ConvGeometry geometry = ts::convGeometry(
+		{x[0].value.rows(), x[0].value.cols()},
+		{kernelDim[0], kernelDim[1]},
+		{stride[0], stride[1]},
+		{padding[0], padding[1]},
+		{dilation[0], dilation[1]}
+	);
+
+	if(geometry.outRows == 0 || geometry.outCols == 0) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// All channels must have the same size
+	std::vector<int> dependencies = {};
+	for(unsigned i=0; i<x.size(); i++) {
+		if(
+			x[i].value.rows() != geometry.rows ||
+			x[i].value.cols() != geometry.cols ||
+			x[i].wList != x[0].wList
+		) {
+			return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+		}
+		dependencies.push_back(x[i].index);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x[0].wList->elementWiseOnly = false;
+
+	long patchSize = kernelDim[0] * kernelDim[1];
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(patchSize * x.size(), geometry.outRows * geometry.outCols);
+	long ld = res.rows();
+
+	#pragma omp parallel for collapse(2) schedule(static)
+	for(long i=0; i<(long) x.size(); i++) {
+		for(long r=0; r<geometry.outRows; r++) {
+			ts::im2colPack(
+				x[i].value.data(), geometry.rows,
+				geometry, r, r + 1,
+				res.data() + i * patchSize + r * geometry.outCols * ld, ld
+			);
+		}
+	}
+
+
+	// Return
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::Im2ColNode<T>(
+			{res.rows(), res.cols()},
+			dependencies,
+			{kernelDim[0], kernelDim[1]},
+			{x[0].value.rows(), x[0].value.cols()},
+			x.size(),
+			{stride[0], stride[1]},
+			{padding[0], padding[1]},
+			{dilation[0], dilation[1]}
+		)
+	);
+
+	return ts::Tensor<T>(res, x[0].wList, nodePtr);
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::im2col(
+	const ts::Tensor<T> &x,
+	unsigned nChannels,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+) {
+	// Same as the channels vector version, reading the channels of the
+	// packed map in place
+
+	if(
+		nChannels == 0 || x.value.rows() % nChannels != 0 ||
+		kernelDim.size() != 2 || stride.size() != 2 ||
+		padding.size() != 2 || dilation.size() != 2
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	ts::ConvGeometry geometry = ts::convGeometry(
+		{x.value.rows() / nChannels, x.value.cols()},
+		{kernelDim[0], kernelDim[1]},
+		{stride[0], stride[1]},
+		{padding[0], padding[1]},
+		{dilation[0], dilation[1]}
+	);
+
+	if(geometry.outRows == 0 || geometry.outCols == 0) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x.wList->elementWiseOnly = false;
+
+	long patchSize = kernelDim[0] * kernelDim[1];
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(patchSize * nChannels, geometry.outRows * geometry.outCols);
+	long ld = res.rows();
+
+	#pragma omp parallel for collapse(2) schedule(static)
+	for(long i=0; i<(long) nChannels; i++) {
+		for(long r=0; r<geometry.outRows; r++) {
+			ts::im2colPack(
+				x.value.data() + i * geometry.rows, x.value.rows(),
+				geometry, r, r + 1,
+				res.data() + i * patchSize + r * geometry.outCols * ld, ld
+			);
+		}
+	}
+
+
+	// Return
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::Im2ColNode<T>(
+			{res.rows(), res.cols()},
+			{x.index},
+			{kernelDim[0], kernelDim[1]},
+			{geometry.rows, geometry.cols},
+			nChannels,
+			{stride[0], stride[1]},
+			{padding[0], padding[1]},
+			{dilation[0], dilation[1]}
+		)
+	);
+
+	return ts::Tensor<T>(res, x.wList, nodePtr);
+}
+
+
+
+	// Implicit GEMM convolution
+
+template <typename T>
+ts::ImplicitConvNode<T>::ImplicitConvNode(
+	std::vector<long> shape,
+	std::vector<int> newDependencies,
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> newValues,
+	ts::ConvGeometry newGeometry,
+	long newTileRows
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies = newDependencies;
+	this->values = std::move(newValues);
+
+	geometry = newGeometry;
+	tileRows = newTileRows;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::ImplicitConvNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the  ts::Tensor::grad() method. Computes the increment of a derivative
+	// for an implicit GEMM convolution.
+
+	// j == 0 is the kernel, which gets dY * im2col(x)^T (im2col tiles are packed
+	// again). The other dependencies are the input channels, which get the
+	// scattered tiles of kernel^T * dY.
+
+	const ts::ConvGeometry &g = geometry;
+	const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> &kernel =
+	this->values[0].matrix();
+
+	long nChannels = this->values.size() - 1;
+	long patchSize = g.kernelRows * g.kernelCols;
+	long tileCols = tileRows * g.outCols;
+	long nTiles = (g.outRows + tileRows - 1) / tileRows;
+
+	if(j == 0) {
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment;
+		increment.setZero(kernel.rows(), kernel.cols());
+
+		#pragma omp parallel
+		{
+			Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> buffer(kernel.cols(), tileCols);
+			Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> partial;
+			partial.setZero(kernel.rows(), kernel.cols());
+
+			#pragma omp for schedule(static)
+			for(long t=0; t<nTiles; t++) {
+				long rowBegin = t * tileRows;
+				long rowEnd = std::min(rowBegin + tileRows, g.outRows);
+				long n = (rowEnd - rowBegin) * g.outCols;
+
+				for(long i=0; i<nChannels; i++) {
+					ts::im2colPack(
+						this->values[i + 1].data(), g.rows,
+						g, rowBegin, rowEnd,
+						buffer.data() + i * patchSize, buffer.rows()
+					);
+				}
+
+				partial.noalias() +=
+				childDerivative.matrix().middleCols(rowBegin * g.outCols, n) *
+				buffer.leftCols(n).transpose();
+			}
+
+			#pragma omp critical
+			increment.matrix() += partial;
+		}
+
+		return increment;
+	}
+
+	if(j == 1) {
+		increments = std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>(
+			nChannels
+		);
+		for(long i=0; i<nChannels; i++) {
+			increments[i].setZero(g.rows, g.cols);
+		}
+
+		// tileRows is large enough for tiles 2 apart not to overlap, so even
+		// and odd tiles are scattered in 2 parallel phases
+		for(long phase=0; phase<2; phase++) {
+			#pragma omp parallel
+			{
+				Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> buffer(kernel.cols(), tileCols);
+
+				#pragma omp for schedule(static)
+				for(long t=phase; t<nTiles; t+=2) {
+					long rowBegin = t * tileRows;
+					long rowEnd = std::min(rowBegin + tileRows, g.outRows);
+					long n = (rowEnd - rowBegin) * g.outCols;
+
+					buffer.leftCols(n).noalias() = kernel.transpose() *
+					childDerivative.matrix().middleCols(rowBegin * g.outCols, n);
+
+					for(long i=0; i<nChannels; i++) {
+						ts::im2colScatter(
+							buffer.data() + i * patchSize, buffer.rows(),
+							g, rowBegin, rowEnd,
+							increments[i].data(), g.rows
+						);
+					}
+				}
+			}
+		}
+	}
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment =
+	std::move(increments[j - 1]);
+
+	if(j == nChannels) {
+		increments.clear();
+	}
+
+	return increment;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::implicitConv(
+	const ts::Tensor<T> &kernel,
+	const std::vector<ts::Tensor<T>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+) {
+	// Computes the same result as matProd(kernel, im2col(x, ...)), but the
+	// im2col matrix is never stored : tiles of a few output rows are packed
+	// in a buffer of TS_IMPLICIT_CONV_BUFFER bytes, then multiplied by the
+	// kernel, so the memory overhead stays close to the size of the inputs.
+
+	if(
+		x.size() == 0 || kernelDim.size() != 2 || stride.size() != 2 ||
+		padding.size() != 2 || dilation.size() != 2
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	ts::ConvGeometry geometry = ts::convGeometry(
+		{x[0].value.rows(), x[0].value.cols()},
+		{kernelDim[0], kernelDim[1]},
+		{stride[0], stride[1]},
+		{padding[0], padding[1]},
+		{dilation[0], dilation[1]}
+	);
+
+	long patchSize = kernelDim[0] * kernelDim[1];
+
+	if(
+		geometry.outRows == 0 || geometry.outCols == 0 ||
+		kernel.value.cols() != patchSize * (long) x.size() ||
+		kernel.wList != x[0].wList
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// All channels must have the same size
+	std::vector<int> dependencies = {kernel.index};
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> values = {
+		kernel.value
+	};
+	for(unsigned i=0; i<x.size(); i++) {
+		if(
+			x[i].value.rows() != geometry.rows ||
+			x[i].value.cols() != geometry.cols ||
+			x[i].wList != x[0].wList
+		) {
+			return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+		}
+		dependencies.push_back(x[i].index);
+		values.push_back(x[i].value);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x[0].wList->elementWiseOnly = false;
+
+	// Number of output rows per tile. The backward pass requires it to be at
+	// least the number of output rows sharing some input rows.
+	long extent = geometry.dilationRows * (geometry.kernelRows - 1) + 1;
+	long nPhases = (extent + geometry.strideRows - 1) / geometry.strideRows;
+	long tileRows = TS_IMPLICIT_CONV_BUFFER /
+	(sizeof(T) * kernel.value.cols() * geometry.outCols);
+	tileRows = std::min(std::max(tileRows, nPhases), geometry.outRows);
+
+	long tileCols = tileRows * geometry.outCols;
+	long nTiles = (geometry.outRows + tileRows - 1) / tileRows;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(kernel.value.rows(), geometry.outRows * geometry.outCols);
+
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> buffer(
+			kernel.value.cols(), tileCols
+		);
+
+		#pragma omp for schedule(static)
+		for(long t=0; t<nTiles; t++) {
+			long rowBegin = t * tileRows;
+			long rowEnd = std::min(rowBegin + tileRows, geometry.outRows);
+			long n = (rowEnd - rowBegin) * geometry.outCols;
+
+			for(long i=0; i<(long) x.size(); i++) {
+				ts::im2colPack(
+					x[i].value.data(), geometry.rows,
+					geometry, rowBegin, rowEnd,
+					buffer.data() + i * patchSize, buffer.rows()
+				);
+			}
+
+			res.matrix().middleCols(rowBegin * geometry.outCols, n).noalias() =
+			kernel.value.matrix() * buffer.leftCols(n);
+		}
+	}
+
+
+	// Return
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::ImplicitConvNode<T>(
+			{res.rows(), res.cols()},
+			dependencies,
+			std::move(values),
+			geometry,
+			tileRows
+		)
+	);
+
+	return ts::Tensor<T>(res, x[0].wList, nodePtr);
+}
+
+
+
+	// Winograd convolution
+
+// Transformation matrices of F(m x m, 3 x 3), as given by Lavin & Gray (2015)
+template <typename T>
+static void winogradMatrices(
+	unsigned outputTile,
+	Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> &BT,
+	Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> &G,
+	Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> &AT
+) {
+	if(outputTile == 2) {
+		BT.resize(4, 4);
+		BT <<
+			1, 0, -1, 0,
+			0, 1, 1, 0,
+			0, -1, 1, 0,
+			0, 1, 0, -1;
+
+		G.resize(4, 3);
+		G <<
+			1, 0, 0,
+			0.5, 0.5, 0.5,
+			0.5, -0.5, 0.5,
+			0, 0, 1;
+
+		AT.resize(2, 4);
+		AT <<
+			1, 1, 1, 0,
+			0, 1, -1, -1;
+	}
+
+	else {
+		BT.resize(6, 6);
+		BT <<
+			4, 0, -5, 0, 1, 0,
+			0, -4, -4, 1, 1, 0,
+			0, 4, -4, -1, 1, 0,
+			0, -2, -1, 2, 1, 0,
+			0, 2, -1, -2, 1, 0,
+			0, 4, 0, -5, 0, 1;
+
+		G.resize(6, 3);
+		G <<
+			1.0 / 4, 0, 0,
+			-1.0 / 6, -1.0 / 6, -1.0 / 6,
+			-1.0 / 6, 1.0 / 6, -1.0 / 6,
+			1.0 / 24, 1.0 / 12, 1.0 / 6,
+			1.0 / 24, -1.0 / 12, 1.0 / 6,
+			0, 0, 1;
+
+		AT.resize(4, 6);
+		AT <<
+			1, 1, 1, 1, 1, 0,
+			0, 1, -1, 2, -2, 0,
+			0, 1, 1, 4, 4, 0,
+			0, 1, -1, 8, -8, 1;
+	}
+}
+
+
+
+template <typename T>
+std::shared_ptr<const typename ts::WinogradCache<T>::Transforms> ts::WinogradCache<T>::transform(
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &kernel,
+	unsigned newOutputTile
+) {
+	long tileSize = newOutputTile + 2;
+	long nOut = kernel.rows();
+	long nIn = kernel.cols() / 9;
+
+	Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> BT, G, AT;
+	winogradMatrices(newOutputTile, BT, G, AT);
+
+	std::shared_ptr<Transforms> newTransforms = std::make_shared<Transforms>(
+		tileSize * tileSize,
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>(nOut, nIn)
+	);
+
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, 3, 3> g;
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> u(tileSize, tileSize);
+
+		#pragma omp for collapse(2) schedule(static)
+		for(long o=0; o<nOut; o++) {
+			for(long i=0; i<nIn; i++) {
+				// Kernel patches are flattened in col-major order
+				for(long k=0; k<9; k++) {
+					g(k) = kernel(o, i * 9 + k);
+				}
+
+				u.noalias() = G * g * G.transpose();
+
+				for(long e=0; e<tileSize*tileSize; e++) {
+					(*newTransforms)[e](o, i) = u(e);
+				}
+			}
+		}
+	}
+
+	return newTransforms;
+}
+
+
+
+template <typename T>
+void ts::WinogradCache<T>::update(
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &kernel,
+	unsigned newOutputTile
+) {
+	transforms = transform(kernel, newOutputTile);
+	outputTile = newOutputTile;
+	kernelRows = kernel.rows();
+	kernelCols = kernel.cols();
+}
+
+
+
+template <typename T>
+void ts::WinogradCache<T>::clear() {
+	transforms = NULL;
+	outputTile = 0;
+	kernelRows = 0;
+	kernelCols = 0;
+}
+
+
+
+template <typename T>
+ts::WinogradNode<T>::WinogradNode(
+	std::vector<long> shape,
+	std::vector<int> newDependencies,
+	ts::ConvGeometry newGeometry,
+	unsigned newOutputTile,
+	std::shared_ptr<const Transforms> newKernelTransforms,
+	Transforms newInputTransforms
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies = newDependencies;
+
+	geometry = newGeometry;
+	outputTile = newOutputTile;
+
+	kernelTransforms = newKernelTransforms;
+	inputTransforms = std::move(newInputTransforms);
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::WinogradNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the  ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a Winograd convolution.
+
+	// Each step of the forward pass is linear, so they are transposed in
+	// reverse order. Both the kernel and input increments depend on the
+	// derivatives of the tiles products, so they are all computed on the first
+	// call.
+
+	if(j != 0) {
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment =
+		std::move(increments[j - 1]);
+
+		if(j == increments.size()) {
+			increments.clear();
+		}
+
+		return increment;
+	}
+
+	const ts::ConvGeometry &g = geometry;
+	const Transforms &U = *kernelTransforms;
+	const Transforms &V = inputTransforms;
+
+	long m = outputTile;
+	long tileSize = m + 2;
+	long nElements = tileSize * tileSize;
+	long nOut = U[0].rows();
+	long nIn = U[0].cols();
+	long nTileCols = (g.outCols + m - 1) / m;
+	long nTiles = V[0].cols();
+
+	Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> BT, G, AT;
+	winogradMatrices(outputTile, BT, G, AT);
+
+
+	// Output transform
+	Transforms dM(nElements, Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>(nOut, nTiles));
+
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> dy(m, m);
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> dm(tileSize, tileSize);
+
+		#pragma omp for collapse(2) schedule(static)
+		for(long o=0; o<nOut; o++) {
+			for(long p=0; p<nTiles; p++) {
+				long r0 = (p / nTileCols) * m;
+				long c0 = (p % nTileCols) * m;
+
+				for(long c=0; c<m; c++) {
+					for(long r=0; r<m; r++) {
+						dy(r, c) = (r0 + r < g.outRows && c0 + c < g.outCols) ?
+						childDerivative(o, (r0 + r) * g.outCols + c0 + c) : (T) 0;
+					}
+				}
+
+				dm.noalias() = AT.transpose() * dy * AT;
+
+				for(long e=0; e<nElements; e++) {
+					dM[e](o, p) = dm(e);
+				}
+			}
+		}
+	}
+
+
+	// Kernel increment
+	Transforms dU(nElements);
+
+	#pragma omp parallel for schedule(static)
+	for(long e=0; e<nElements; e++) {
+		dU[e].noalias() = dM[e] * V[e].transpose();
+	}
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment(nOut, nIn * 9);
+
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> du(tileSize, tileSize);
+		Eigen::Matrix<T, 3, 3> dg;
+
+		#pragma omp for collapse(2) schedule(static)
+		for(long o=0; o<nOut; o++) {
+			for(long i=0; i<nIn; i++) {
+				for(long e=0; e<nElements; e++) {
+					du(e) = dU[e](o, i);
+				}
+
+				dg.noalias() = G.transpose() * du * G;
+
+				for(long k=0; k<9; k++) {
+					increment(o, i * 9 + k) = dg(k);
+				}
+			}
+		}
+	}
+
+
+	// Input increments
+	Transforms dV(nElements);
+
+	#pragma omp parallel for schedule(static)
+	for(long e=0; e<nElements; e++) {
+		dV[e].noalias() = U[e].transpose() * dM[e];
+	}
+
+	increments = std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>(nIn);
+
+	// Tiles overlap, so channels are scattered in parallel
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> dv(tileSize, tileSize);
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> dd(tileSize, tileSize);
+
+		#pragma omp for schedule(static)
+		for(long i=0; i<nIn; i++) {
+			increments[i].setZero(g.rows, g.cols);
+
+			for(long p=0; p<nTiles; p++) {
+				long r0 = (p / nTileCols) * m - g.paddingRows;
+				long c0 = (p % nTileCols) * m - g.paddingCols;
+
+				for(long e=0; e<nElements; e++) {
+					dv(e) = dV[e](i, p);
+				}
+
+				dd.noalias() = BT.transpose() * dv * BT;
+
+				// Derivatives of padding elements are discarded
+				for(long c=0; c<tileSize; c++) {
+					for(long r=0; r<tileSize; r++) {
+						if(
+							r0 + r >= 0 && r0 + r < g.rows &&
+							c0 + c >= 0 && c0 + c < g.cols
+						) {
+							increments[i](r0 + r, c0 + c) += dd(r, c);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	return increment;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::winogradConv(
+	const ts::Tensor<T> &kernel,
+	const std::vector<ts::Tensor<T>> &x,
+	std::vector<unsigned> padding,
+	unsigned outputTile,
+	const ts::WinogradCache<T> * cache
+) {
+	// Each channel is split into overlapping (m+2) x (m+2) tiles, that give
+	// m x m output tiles. In the transformed domain, the convolution of all
+	// tiles becomes one (outChannels x inChannels) * (inChannels x nTiles)
+	// matrix product per tile element, with (m+2)^2 / (9 m^2) as many
+	// multiplications as the direct convolution.
+
+	if(
+		x.size() == 0 || padding.size() != 2 ||
+		(outputTile != 2 && outputTile != 4)
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	ts::ConvGeometry geometry = ts::convGeometry(
+		{x[0].value.rows(), x[0].value.cols()},
+		{3, 3}, {1, 1},
+		{padding[0], padding[1]},
+		{1, 1}
+	);
+
+	if(
+		geometry.outRows == 0 || geometry.outCols == 0 ||
+		kernel.value.cols() != 9 * (long) x.size() ||
+		kernel.wList != x[0].wList
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// All channels must have the same size
+	std::vector<int> dependencies = {kernel.index};
+	for(unsigned i=0; i<x.size(); i++) {
+		if(
+			x[i].value.rows() != geometry.rows ||
+			x[i].value.cols() != geometry.cols ||
+			x[i].wList != x[0].wList
+		) {
+			return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+		}
+		dependencies.push_back(x[i].index);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x[0].wList->elementWiseOnly = false;
+
+	typedef std::vector<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>> Transforms;
+
+	// The cache is only read, as other threads may be using it
+	std::shared_ptr<const Transforms> U;
+	if(
+		cache != NULL && cache->transforms != NULL &&
+		cache->outputTile == outputTile &&
+		cache->kernelRows == kernel.value.rows() &&
+		cache->kernelCols == kernel.value.cols()
+	) {
+		U = cache->transforms;
+	} else {
+		U = ts::WinogradCache<T>::transform(kernel.value, outputTile);
+	}
+
+	long m = outputTile;
+	long tileSize = m + 2;
+	long nElements = tileSize * tileSize;
+	long nOut = kernel.value.rows();
+	long nIn = x.size();
+	long nTileCols = (geometry.outCols + m - 1) / m;
+	long nTiles = ((geometry.outRows + m - 1) / m) * nTileCols;
+
+	Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> BT, G, AT;
+	winogradMatrices(outputTile, BT, G, AT);
+
+
+	// Input transform
+	Transforms V(nElements, Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>(nIn, nTiles));
+
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> d(tileSize, tileSize);
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> v(tileSize, tileSize);
+
+		#pragma omp for collapse(2) schedule(static)
+		for(long i=0; i<nIn; i++) {
+			for(long p=0; p<nTiles; p++) {
+				long r0 = (p / nTileCols) * m - geometry.paddingRows;
+				long c0 = (p % nTileCols) * m - geometry.paddingCols;
+
+				for(long c=0; c<tileSize; c++) {
+					for(long r=0; r<tileSize; r++) {
+						d(r, c) = (
+							r0 + r >= 0 && r0 + r < geometry.rows &&
+							c0 + c >= 0 && c0 + c < geometry.cols
+						) ? x[i].value(r0 + r, c0 + c) : (T) 0;
+					}
+				}
+
+				v.noalias() = BT * d * BT.transpose();
+
+				for(long e=0; e<nElements; e++) {
+					V[e](i, p) = v(e);
+				}
+			}
+		}
+	}
+
+
+	// Products in the transformed domain
+	Transforms M(nElements);
+
+	#pragma omp parallel for schedule(static)
+	for(long e=0; e<nElements; e++) {
+		M[e].noalias() = (*U)[e] * V[e];
+	}
+
+
+	// Output transform
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(nOut, geometry.outRows * geometry.outCols);
+
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> mm(tileSize, tileSize);
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> y(m, m);
+
+		#pragma omp for collapse(2) schedule(static)
+		for(long o=0; o<nOut; o++) {
+			for(long p=0; p<nTiles; p++) {
+				long r0 = (p / nTileCols) * m;
+				long c0 = (p % nTileCols) * m;
+
+				for(long e=0; e<nElements; e++) {
+					mm(e) = M[e](o, p);
+				}
+
+				y.noalias() = AT * mm * AT.transpose();
+
+				// Last tiles may be cropped
+				for(long r=0; r<m && r0 + r<geometry.outRows; r++) {
+					for(long c=0; c<m && c0 + c<geometry.outCols; c++) {
+						res(o, (r0 + r) * geometry.outCols + c0 + c) = y(r, c);
+					}
+				}
+			}
+		}
+	}
+
+
+	// Return
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::WinogradNode<T>(
+			{res.rows(), res.cols()},
+			dependencies,
+			geometry,
+			outputTile,
+			U,
+			std::move(V)
+		)
+	);
+
+	return ts::Tensor<T>(res, x[0].wList, nodePtr);
+}
+
+
+
+	// FFT convolution
+
+template <typename T>
+void ts::fft(
+	std::complex<T> * data, long n, long stride,
+	const std::complex<T> * twiddles
+) {
+	// Bit reversal permutation
+	for(long i=1, j=0; i<n; i++) {
+		long bit = n >> 1;
+		for(; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+
+		if(i < j) {
+			std::swap(data[i * stride], data[j * stride]);
+		}
+	}
+
+	// Butterflies (complex products are expanded to avoid the slow NaN
+	// checks of std::complex)
+	for(long length=2; length<=n; length<<=1) {
+		long half = length / 2;
+		long step = n / length;
+
+		for(long i=0; i<n; i+=length) {
+			for(long k=0; k<half; k++) {
+				std::complex<T> &a = data[(i + k) * stride];
+				std::complex<T> &b = data[(i + k + half) * stride];
+				const std::complex<T> &w = twiddles[k * step];
+
+				std::complex<T> v(
+					b.real() * w.real() - b.imag() * w.imag(),
+					b.real() * w.imag() + b.imag() * w.real()
+				);
+
+				b = a - v;
+				a += v;
+			}
+		}
+	}
+}
+
+
+
+template <typename T>
+static std::vector<std::complex<T>> fftTwiddles(long n, bool inverse) {
+	std::vector<std::complex<T>> twiddles(n / 2);
+	double sign = inverse ? 1 : -1;
+
+	for(long k=0; k<n/2; k++) {
+		twiddles[k] = std::complex<T>(
+			std::cos(sign * 2 * M_PI * k / n), std::sin(sign * 2 * M_PI * k / n)
+		);
+	}
+
+	return twiddles;
+}
+
+
+
+template <typename T>
+void ts::fft2(
+	Eigen::Array<std::complex<T>, Eigen::Dynamic, Eigen::Dynamic> &x,
+	bool inverse
+) {
+	long rows = x.rows();
+	long cols = x.cols();
+
+	std::vector<std::complex<T>> rowsTwiddles = fftTwiddles<T>(rows, inverse);
+	std::vector<std::complex<T>> colsTwiddles = fftTwiddles<T>(cols, inverse);
+
+	// Strided rows are very slow to transform, so the matrix is transposed
+	// to transform them as contiguous columns.
+	// Zero columns (usually most of a padded kernel) are skipped.
+	#pragma omp parallel for schedule(static)
+	for(long c=0; c<cols; c++) {
+		if(!inverse && (x.col(c) == std::complex<T>(0, 0)).all()) {
+			continue;
+		}
+		ts::fft(x.data() + c * rows, rows, 1, rowsTwiddles.data());
+	}
+
+	x.transposeInPlace();
+
+	#pragma omp parallel for schedule(static)
+	for(long r=0; r<rows; r++) {
+		ts::fft(x.data() + r * cols, cols, 1, colsTwiddles.data());
+	}
+
+	x.transposeInPlace();
+
+	if(inverse) {
+		x /= std::complex<T>(rows * cols, 0);
+	}
+}
+
+
+
+template <typename T>
+ts::FFTConvNode<T>::FFTConvNode(
+	std::vector<long> shape,
+	std::vector<int> newDependencies,
+	ts::ConvGeometry newGeometry,
+	std::vector<Spectrum> newInputSpectra,
+	std::vector<Spectrum> newKernelSpectra
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies = newDependencies;
+
+	geometry = newGeometry;
+
+	inputSpectra = std::move(newInputSpectra);
+	kernelSpectra = std::move(newKernelSpectra);
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::FFTConvNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the  ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a FFT convolution.
+
+	// The kernel derivative is the correlation of the padded input with the
+	// output derivative, and the padded input derivative is the convolution of
+	// the output derivative with the kernel. Both need the FFTs of the output
+	// derivatives, so all increments are computed on the first call.
+
+	if(j != 0) {
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment =
+		std::move(increments[j - 1]);
+
+		if(j == increments.size()) {
+			increments.clear();
+		}
+
+		return increment;
+	}
+
+	const ts::ConvGeometry &g = geometry;
+
+	long nIn = inputSpectra.size();
+	long nOut = kernelSpectra.size() / nIn;
+	long fftRows = inputSpectra[0].rows();
+	long fftCols = inputSpectra[0].cols();
+	long patchSize = g.kernelRows * g.kernelCols;
+
+
+	// Output derivatives FFTs
+	std::vector<Spectrum> outputSpectra(nOut);
+
+	#pragma omp parallel for schedule(static)
+	for(long o=0; o<nOut; o++) {
+		outputSpectra[o].setZero(fftRows, fftCols);
+		for(long r=0; r<g.outRows; r++) {
+			for(long c=0; c<g.outCols; c++) {
+				outputSpectra[o](r, c) = childDerivative(o, r * g.outCols + c);
+			}
+		}
+		ts::fft2(outputSpectra[o], false);
+	}
+
+
+	// Kernel increment
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment(nOut, nIn * patchSize);
+
+	#pragma omp parallel for collapse(2) schedule(static)
+	for(long o=0; o<nOut; o++) {
+		for(long i=0; i<nIn; i++) {
+			Spectrum correlation = inputSpectra[i] * outputSpectra[o].conjugate();
+			ts::fft2(correlation, true);
+
+			for(long kc=0; kc<g.kernelCols; kc++) {
+				for(long kr=0; kr<g.kernelRows; kr++) {
+					increment(o, i * patchSize + kc * g.kernelRows + kr) =
+					correlation(kr, kc).real();
+				}
+			}
+		}
+	}
+
+
+	// Input increments (derivatives of padding elements are discarded)
+	increments = std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>(nIn);
+
+	#pragma omp parallel for schedule(static)
+	for(long i=0; i<nIn; i++) {
+		Spectrum convolution;
+		convolution.setZero(fftRows, fftCols);
+		for(long o=0; o<nOut; o++) {
+			convolution += outputSpectra[o] * kernelSpectra[o * nIn + i];
+		}
+		ts::fft2(convolution, true);
+
+		increments[i] = convolution.block(
+			g.paddingRows, g.paddingCols, g.rows, g.cols
+		).real();
+	}
+
+	return increment;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::fftConv(
+	const ts::Tensor<T> &kernel,
+	const std::vector<ts::Tensor<T>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> padding
+) {
+	// Each output channel is the sum of the correlations of the input
+	// channels with their kernels. Correlations are computed as products of
+	// FFTs padded to powers of 2 large enough to avoid any wrap around, so
+	// the cost doesn't depend on the kernel size.
+
+	if(x.size() == 0 || kernelDim.size() != 2 || padding.size() != 2) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	ts::ConvGeometry geometry = ts::convGeometry(
+		{x[0].value.rows(), x[0].value.cols()},
+		{kernelDim[0], kernelDim[1]},
+		{1, 1},
+		{padding[0], padding[1]},
+		{1, 1}
+	);
+
+	long patchSize = kernelDim[0] * kernelDim[1];
+
+	if(
+		geometry.outRows == 0 || geometry.outCols == 0 ||
+		kernel.value.cols() != patchSize * (long) x.size() ||
+		kernel.wList != x[0].wList
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// All channels must have the same size
+	std::vector<int> dependencies = {kernel.index};
+	for(unsigned i=0; i<x.size(); i++) {
+		if(
+			x[i].value.rows() != geometry.rows ||
+			x[i].value.cols() != geometry.cols ||
+			x[i].wList != x[0].wList
+		) {
+			return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+		}
+		dependencies.push_back(x[i].index);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x[0].wList->elementWiseOnly = false;
+
+	typedef Eigen::Array<std::complex<T>, Eigen::Dynamic, Eigen::Dynamic> Spectrum;
+
+	long nIn = x.size();
+	long nOut = kernel.value.rows();
+
+	long fftRows = 1;
+	while(fftRows < geometry.rows + 2 * geometry.paddingRows) {
+		fftRows <<= 1;
+	}
+	long fftCols = 1;
+	while(fftCols < geometry.cols + 2 * geometry.paddingCols) {
+		fftCols <<= 1;
+	}
+
+
+	// Input and kernels FFTs
+	std::vector<Spectrum> inputSpectra(nIn);
+
+	#pragma omp parallel for schedule(static)
+	for(long i=0; i<nIn; i++) {
+		inputSpectra[i].setZero(fftRows, fftCols);
+		inputSpectra[i].block(
+			geometry.paddingRows, geometry.paddingCols, geometry.rows, geometry.cols
+		) = x[i].value.template cast<std::complex<T>>();
+		ts::fft2(inputSpectra[i], false);
+	}
+
+	std::vector<Spectrum> kernelSpectra(nOut * nIn);
+
+	#pragma omp parallel for collapse(2) schedule(static)
+	for(long o=0; o<nOut; o++) {
+		for(long i=0; i<nIn; i++) {
+			Spectrum &spectrum = kernelSpectra[o * nIn + i];
+			spectrum.setZero(fftRows, fftCols);
+
+			// Kernel patches are flattened in col-major order
+			for(long kc=0; kc<geometry.kernelCols; kc++) {
+				for(long kr=0; kr<geometry.kernelRows; kr++) {
+					spectrum(kr, kc) =
+					kernel.value(o, i * patchSize + kc * geometry.kernelRows + kr);
+				}
+			}
+			ts::fft2(spectrum, false);
+		}
+	}
+
+
+	// Correlations
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(nOut, geometry.outRows * geometry.outCols);
+
+	#pragma omp parallel for schedule(static)
+	for(long o=0; o<nOut; o++) {
+		Spectrum correlation;
+		correlation.setZero(fftRows, fftCols);
+		for(long i=0; i<nIn; i++) {
+			correlation += inputSpectra[i] * kernelSpectra[o * nIn + i].conjugate();
+		}
+		ts::fft2(correlation, true);
+
+		for(long r=0; r<geometry.outRows; r++) {
+			for(long c=0; c<geometry.outCols; c++) {
+				res(o, r * geometry.outCols + c) = correlation(r, c).real();
+			}
+		}
+	}
+
+
+	// Return
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::FFTConvNode<T>(
+			{res.rows(), res.cols()},
+			dependencies,
+			geometry,
+			std::move(inputSpectra),
+			std::move(kernelSpectra)
+		)
+	);
+
+	return ts::Tensor<T>(res, x[0].wList, nodePtr);
+}
+
+
+
+	// Depthwise convolution
+
+template <typename T>
+ts::DepthwiseConvNode<T>::DepthwiseConvNode(
+	std::vector<long> shape,
+	std::vector<int> newDependencies,
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> newValues,
+	ts::ConvGeometry newGeometry
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies = newDependencies;
+	this->values = std::move(newValues);
+
+	geometry = newGeometry;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::DepthwiseConvNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the  ts::Tensor::grad() method. Computes the increment of a derivative
+	// for a depthwise convolution.
+
+	// Channels are independent : row i of the kernel gets dY_i * im2col(x_i)^T
+	// and channel i gets the scattered patches of kernel_i^T * dY_i (both are
+	// computed in the same pass over the channel patches).
+
+	const ts::ConvGeometry &g = geometry;
+	long nChannels = this->values.size() - 1;
+
+	if(j == 0) {
+		long patchSize = g.kernelRows * g.kernelCols;
+		long nPositions = g.outRows * g.outCols;
+
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment;
+		increment.resize(nChannels, patchSize);
+
+		increments = std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>(
+			nChannels
+		);
+
+		#pragma omp parallel
+		{
+			Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> patches(patchSize, nPositions);
+
+			#pragma omp for schedule(static)
+			for(long i=0; i<nChannels; i++) {
+				ts::im2colPack(
+					this->values[i + 1].data(), g.rows,
+					g, 0, g.outRows,
+					patches.data(), patchSize
+				);
+
+				increment.row(i).matrix().noalias() =
+				childDerivative.matrix().row(i) * patches.transpose();
+
+				patches.noalias() = this->values[0].matrix().row(i).transpose() *
+				childDerivative.matrix().row(i);
+
+				increments[i].setZero(g.rows, g.cols);
+				ts::im2colScatter(
+					patches.data(), patchSize,
+					g, 0, g.outRows,
+					increments[i].data(), g.rows
+				);
+			}
+		}
+
+		return increment;
+	}
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> increment =
+	std::move(increments[j - 1]);
+
+	if((long) j == nChannels) {
+		increments.clear();
+	}
+
+	return increment;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::depthwiseConv(
+	const ts::Tensor<T> &kernel,
+	const std::vector<ts::Tensor<T>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+) {
+	// Each output row is the product of a kernel row with the im2col patches
+	// of its channel only, so channels are packed and multiplied one by one.
+
+	if(
+		x.size() == 0 || kernelDim.size() != 2 || stride.size() != 2 ||
+		padding.size() != 2 || dilation.size() != 2
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	ts::ConvGeometry geometry = ts::convGeometry(
+		{x[0].value.rows(), x[0].value.cols()},
+		{kernelDim[0], kernelDim[1]},
+		{stride[0], stride[1]},
+		{padding[0], padding[1]},
+		{dilation[0], dilation[1]}
+	);
+
+	long patchSize = kernelDim[0] * kernelDim[1];
+	long nPositions = geometry.outRows * geometry.outCols;
+
+	if(
+		geometry.outRows == 0 || geometry.outCols == 0 ||
+		kernel.value.rows() != (long) x.size() ||
+		kernel.value.cols() != patchSize ||
+		kernel.wList != x[0].wList
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// All channels must have the same size
+	std::vector<int> dependencies = {kernel.index};
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> values = {
+		kernel.value
+	};
+	for(unsigned i=0; i<x.size(); i++) {
+		if(
+			x[i].value.rows() != geometry.rows ||
+			x[i].value.cols() != geometry.cols ||
+			x[i].wList != x[0].wList
+		) {
+			return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+		}
+		dependencies.push_back(x[i].index);
+		values.push_back(x[i].value);
+	}
+
+	// The gradient will have to be computed for a scalar
+	x[0].wList->elementWiseOnly = false;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(x.size(), nPositions);
+
+	#pragma omp parallel
+	{
+		Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> patches(patchSize, nPositions);
+
+		#pragma omp for schedule(static)
+		for(long i=0; i<(long) x.size(); i++) {
+			ts::im2colPack(
+				x[i].value.data(), geometry.rows,
+				geometry, 0, geometry.outRows,
+				patches.data(), patchSize
+			);
+
+			res.row(i).matrix().noalias() = kernel.value.matrix().row(i) * patches;
+		}
+	}
+
+
+	// Return
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::DepthwiseConvNode<T>(
+			{res.rows(), res.cols()},
+			dependencies,
+			std::move(values),
+			geometry
+		)
+	);
+
+	return ts::Tensor<T>(res, x[0].wList, nodePtr);
+}
+
+
+
+	// Col2im
+
+template <typename T>
+ts::Col2ImNode<T>::Col2ImNode(
+	std::vector<long> shape,
+	int xDep,
+	unsigned newPosition,
+	long newNChannels
+) {
+	// New tensor shape (vector)
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies =  {xDep};
+
+	// Original matrix size
+	position = newPosition;
+	nChannels = newNChannels;
+}
 
 
 
@@ -803,3 +2647,369 @@ std::vector<ts::Tensor<T>> ts::col2im(
 
 	return res;
 }
+
+
+
+template <typename T>
+ts::PackedCol2ImNode<T>::PackedCol2ImNode(
+	std::vector<long> shape,
+	int xDep,
+	std::vector<long> newOutputDim
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies =  {xDep};
+
+	outputRows = newOutputDim[0];
+	outputCols = newOutputDim[1];
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::PackedCol2ImNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Each channel block of childDerivative goes back to a row, in row-major
+	// order
+
+	long nChannels = this->rows / outputRows;
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(nChannels, outputRows * outputCols);
+
+	#pragma omp parallel for
+	for(long c=0; c<nChannels; c++) {
+		for(long r=0; r<outputRows; r++) {
+			res.block(c, r * outputCols, 1, outputCols) =
+			childDerivative.row(c * outputRows + r);
+		}
+	}
+
+	return res;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::packedCol2im(
+	const ts::Tensor<T> &x,
+	std::vector<unsigned> outputDim
+) {
+	// Turns an im2col matrix into a packed map, where channel i (row i of x,
+	// in row-major order) is the i-th block of outputDim[0] rows
+
+	if(
+		outputDim.size() != 2 ||
+		(long) (outputDim[0] * outputDim[1]) != x.value.cols()
+	) {
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	long nChannels = x.value.rows();
+	long rows = outputDim[0];
+	long cols = outputDim[1];
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+	res.resize(nChannels * rows, cols);
+
+	#pragma omp parallel for
+	for(long c=0; c<nChannels; c++) {
+		for(long r=0; r<rows; r++) {
+			res.row(c * rows + r) = x.value.block(c, r * cols, 1, cols);
+		}
+	}
+
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::PackedCol2ImNode<T>(
+			{res.rows(), res.cols()},
+			x.index,
+			{rows, cols}
+		)
+	);
+
+	return ts::Tensor<T>(res, x.wList, nodePtr);
+}
+
+
+
+	// ts::ConvBlockNode
+
+template <typename T>
+ts::ConvBlockNode<T>::ConvBlockNode(
+	std::vector<long> shape,
+	int convDep, int biasDep,
+	std::vector<long> newInputShape,
+	std::vector<long> newArgmax,
+	std::vector<uint32_t> newMask, T newSlope,
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newOutput,
+	bool newChannelBias
+) {
+	this->rows = shape[0];
+	this->cols = shape[1];
+
+	this->dependencies = {convDep, biasDep};
+
+	inputRows = newInputShape[0];
+	inputCols = newInputShape[1];
+	channelBias = newChannelBias;
+
+	argmax = std::move(newArgmax);
+	mask = std::move(newMask);
+	slope = newSlope;
+	output = std::move(newOutput);
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> ts::ConvBlockNode<T>::incrementGradient(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &childDerivative,
+		unsigned &j
+) {
+
+	// Used in the  ts::Tensor::grad() method. Routes the derivative of each
+	// pooled element to the max element of its pool (the derivative is the
+	// same for the convolution and a full bias, and summed over each channel
+	// for a per-channel bias).
+
+	if(j == 1 && channelBias) {
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> biasIncrement =
+		increment.rowwise().sum();
+		increment.resize(0, 0);
+		return biasIncrement;
+	}
+
+	if(j == 1) {
+		return std::move(increment);
+	}
+
+	// Activation derivative of each output element
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> derivatives(this->rows, this->cols);
+	if(mask.empty()) {
+		ts::sigmoidGradKernel(
+			output.data(), childDerivative.data(), output.size(), derivatives.data()
+		);
+	}
+	else {
+		ts::maskKernel(
+			childDerivative.data(), childDerivative.size(), mask.data(), slope,
+			derivatives.data()
+		);
+	}
+
+	if(argmax.empty()) {
+		// Row c * outRows + x of the packed map is position (x, y) of channel c
+		long outRows = this->rows / inputRows;
+		increment.resize(inputRows, inputCols);
+
+		#pragma omp parallel for
+		for(long y=0; y<this->cols; y++) {
+			for(long row=0; row<this->rows; row++) {
+				long c = row / outRows;
+				long x = row % outRows;
+				increment(c, x * this->cols + y) = derivatives(row, y);
+			}
+		}
+	}
+	else {
+		// Pools don't overlap, so all max elements are different
+		increment.setZero(inputRows, inputCols);
+
+		#pragma omp parallel for
+		for(long i=0; i<derivatives.size(); i++) {
+			increment(argmax[i]) = derivatives(i);
+		}
+	}
+
+	// The increment is kept for the second parent
+	return increment;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::convBlock(
+	const ts::Tensor<T> &conv,
+	const ts::Tensor<T> &bias,
+	std::vector<unsigned> outputDim,
+	std::vector<unsigned> pool,
+	ts::Tensor<T> (*activation)(const ts::Tensor<T>&)
+) {
+	// Bias, activation, col2im and max pooling of a convolution layer. Each
+	// band of poolRows output rows gets its bias and activation in a small
+	// buffer, and is pooled while still in cache, so that only the position
+	// of each max element and its activation derivative are kept for the
+	// backward pass.
+
+	if(
+		outputDim.size() != 2 || pool.size() < 2 ||
+		(long) (outputDim[0] * outputDim[1]) != conv.value.cols() ||
+		conv.value.rows() != bias.value.rows() ||
+		(conv.value.cols() != bias.value.cols() && bias.value.cols() != 1)
+	) {
+		std::cout << "ERROR: Invalid dimensions for convolution block" << std::endl;
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// Per-channel bias (broadcast over positions), or full bias
+	bool channelBias = bias.value.cols() == 1 && conv.value.cols() != 1;
+
+	// Complete pooling description
+	bool pooled = pool[0] != 0 && pool[1] != 0;
+	std::vector<unsigned> stride = {pool[0], pool[1]};
+	if(pool.size() > 2 && pool[2] != 0) {
+		stride = {pool[2], pool[2]};
+	}
+	unsigned padding = pool.size() > 3 ? pool[3] : 0;
+	ts::PoolingType type = pool.size() > 4 ?
+	(ts::PoolingType) pool[4] : ts::PoolingType::MAX;
+
+	long poolRows = pooled ? pool[0] : 1;
+	long poolCols = pooled ? pool[1] : 1;
+
+	if(
+		pooled && (
+			ts::poolingOutputSize(outputDim[0], pool[0], stride[0], padding) == 0 ||
+			ts::poolingOutputSize(outputDim[1], pool[1], stride[1], padding) == 0
+		)
+	) {
+		std::cout << "ERROR: Invalid pooling for convolution block" << std::endl;
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
+
+	// Other activations and pooling layers are computed separately
+	int fused =
+		activation == &(ts::relu<T>) ? 0 :
+		activation == &(ts::leakyRelu<T>) ? 1 :
+		activation == &(ts::sigmoid<T>) ? 2 : -1;
+
+	if(
+		pooled && (
+			type != ts::PoolingType::MAX || padding != 0 ||
+			stride[0] != pool[0] || stride[1] != pool[1]
+		)
+	) {
+		fused = -1;
+	}
+
+	if(fused == -1) {
+		ts::Tensor<T> res = ts::packedCol2im(
+			(*activation)(channelBias ? ts::broadcastAdd(conv, bias) : conv + bias),
+			outputDim
+		);
+		if(pooled) {
+			res = type == ts::PoolingType::AVERAGE ?
+			ts::averagePooling(
+				res, {pool[0], pool[1]}, stride, {padding, padding},
+				(unsigned) conv.value.rows()
+			) :
+			ts::maxPooling(
+				res, {pool[0], pool[1]}, stride, {padding, padding},
+				(unsigned) conv.value.rows()
+			);
+		}
+		return res;
+	}
+
+	// The gradient will have to be computed for a scalar
+	conv.wList->elementWiseOnly = false;
+
+	long nChannels = conv.value.rows();
+	long outRows = outputDim[0] / poolRows;
+	long outCols = outputDim[1] / poolCols;
+
+	T slope = fused == 1 ? (T) TS_LEAKY_RELU_SLOPE : 0;
+
+	// Channel c of the packed map is the c-th block of outRows rows
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> values(nChannels * outRows, outCols);
+	std::vector<long> argmax(pooled ? values.size() : 0);
+	std::vector<uint32_t> mask(fused == 2 ? 0 : ts::maskSize(values.size()));
+
+	// Conv columns are output positions in row-major order, so output row x
+	// pools a contiguous band of poolRows * outputDim[1] columns
+	long bandCols = poolRows * outputDim[1];
+
+	#pragma omp parallel
+	{
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> band(nChannels, bandCols);
+		std::vector<uint32_t> bandMask(ts::maskSize(band.size()));
+
+		#pragma omp for
+		for(long x=0; x<outRows; x++) {
+			long bandBegin = x * bandCols;
+
+			// Bias and activation with the same kernels as the separate
+			// operations
+			band = conv.value.middleCols(bandBegin, bandCols);
+			if(channelBias) {
+				band.colwise() += bias.value.col(0);
+			}
+			else {
+				band += bias.value.middleCols(bandBegin, bandCols);
+			}
+
+			if(fused == 0) {
+				ts::reluKernel(band.data(), band.size(), band.data(), bandMask.data());
+			}
+			else if(fused == 1) {
+				ts::leakyReluKernel(
+					band.data(), band.size(), slope, band.data(), bandMask.data()
+				);
+			}
+			else {
+				ts::sigmoidKernel(band.data(), band.size(), band.data());
+			}
+
+			for(long y=0; y<outCols; y++) {
+				for(long c=0; c<nChannels; c++) {
+					long maxIndex = 0;
+					T maxVal = 0;
+
+					for(long k=0; k<poolCols; k++) {
+						for(long l=0; l<poolRows; l++) {
+							long index = c + (l * outputDim[1] + y * poolCols + k) * nChannels;
+							if((k == 0 && l == 0) || band(index) > maxVal) {
+								maxIndex = index;
+								maxVal = band(index);
+							}
+						}
+					}
+
+					long i = c * outRows + x + y * values.rows();
+					values(i) = maxVal;
+					if(pooled) {
+						argmax[i] = bandBegin * nChannels + maxIndex;
+					}
+
+					// Output elements of other bands share mask words
+					if(
+						fused != 2 &&
+						(bandMask[maxIndex / TS_MASK_WORD_BITS] >> (maxIndex % TS_MASK_WORD_BITS)) & 1
+					) {
+						#pragma omp atomic
+						mask[i / TS_MASK_WORD_BITS] |= 1u << (i % TS_MASK_WORD_BITS);
+					}
+				}
+			}
+		}
+	}
+
+	std::shared_ptr<ts::Node<T>> nodePtr (
+		new ts::ConvBlockNode<T>(
+			{values.rows(), values.cols()},
+			conv.index, bias.index,
+			{conv.value.rows(), conv.value.cols()},
+			std::move(argmax),
+			std::move(mask), slope,
+			fused == 2 ? values : Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>(),
+			channelBias
+		)
+	);
+
+	return ts::Tensor<T>(values, conv.wList, nodePtr);
+}
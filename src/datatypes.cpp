@@ -12,9 +12,11 @@
 #include "./serializer.cpp"
 
 #include "./model.cpp"
+#include "./checkpoint.cpp"
 #include "./optimizer.cpp"
 
 #include "./convolution.cpp"
+#include "./kernels.cpp"
 
 #include <string>
 #include <fstream>
@@ -27,6 +29,12 @@ template class ts::InputNode<float>;
 template class ts::ElementWiseNode<float>;
 template class ts::MatProdNode<float>;
 template class ts::ScalarNode<float>;
+template class ts::BroadcastNode<float>;
+template class ts::BatchNormNode<float>;
+template class ts::SoftmaxNode<float>;
+template class ts::ReluNode<float>;
+template class ts::SigmoidNode<float>;
+template class ts::TanhNode<float>;
 
 template class ts::WengertList<float>;
 template class ts::Tensor<float>;
@@ -43,15 +51,61 @@ template ts::Tensor<float> ts::operator*(const ts::Tensor<float> &x, const ts::T
 template ts::Tensor<float> ts::operator/(const ts::Tensor<float> &x, const ts::Tensor<float> &y);
 
 template ts::Tensor<float> ts::matProd(const ts::Tensor<float> &x, const ts::Tensor<float> &y);
+template ts::Tensor<float> ts::broadcastAdd(const ts::Tensor<float> &x, const ts::Tensor<float> &y);
+template ts::Tensor<float> ts::batchNorm(
+	const ts::Tensor<float> &x, const ts::Tensor<float> &scale, const ts::Tensor<float> &shift,
+	const Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> &mean,
+	const Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> &variance,
+	float epsilon
+);
+template ts::Tensor<float> ts::batchNorm(
+	const ts::Tensor<float> &x, const ts::Tensor<float> &scale, const ts::Tensor<float> &shift,
+	float epsilon
+);
 template ts::Tensor<float> ts::sigmoid(const ts::Tensor<float> &x);
 template ts::Tensor<float> ts::relu(const ts::Tensor<float> &x);
 template ts::Tensor<float> ts::leakyRelu(const ts::Tensor<float> &x);
+template ts::Tensor<float> ts::tanh(const ts::Tensor<float> &x);
+template ts::Tensor<float> ts::softmax(const ts::Tensor<float> &x);
 template ts::Tensor<float> ts::rescale(const ts::Tensor<float> &x);
 template ts::Tensor<float> ts::squaredNorm(const ts::Tensor<float> &x);
+template ts::Tensor<float> ts::softmaxCrossEntropy(
+	const ts::Tensor<float> &x, const std::vector<unsigned> &labels
+);
+template ts::Tensor<float> ts::identity(const ts::Tensor<float> &x);
+
+template void ts::reluKernel<float>(const float * x, long n, float * res, uint32_t * mask);
+template void ts::leakyReluKernel<float>(
+	const float * x, long n, float slope, float * res, uint32_t * mask
+);
+template void ts::maskKernel<float>(
+	const float * d, long n, const uint32_t * mask, float slope, float * res
+);
+template void ts::sigmoidKernel<float>(const float * x, long n, float * res);
+template void ts::tanhKernel<float>(const float * x, long n, float * res);
+template void ts::sigmoidGradKernel<float>(const float * s, const float * d, long n, float * res);
+template void ts::tanhGradKernel<float>(const float * s, const float * d, long n, float * res);
+template void ts::softmaxKernel<float>(const float * x, long rows, long cols, float * res);
+template float ts::softmaxCrossEntropyKernel<float>(
+	const float * x, long rows, long cols, const unsigned * labels, float * dx
+);
+template void ts::addKernel<float>(const float * x, const float * y, long n, float * res);
+template void ts::subtractKernel<float>(const float * x, const float * y, long n, float * res);
+template void ts::multiplyKernel<float>(const float * x, const float * y, long n, float * res);
+template void ts::divideKernel<float>(
+	const float * x, const float * y, long n, float * res, float * dx, float * dy
+);
+template void ts::stepKernel<float>(const float * increment, long n, float rate, float * value);
+template void ts::adamKernel<float>(
+	float * grad, long n, float beta1, float beta2,
+	float correction1, float correction2, float epsilon,
+	float * m, float * v
+);
 
 
 template class ts::Model<float>;
 template class ts::Polynom<float>;
+template class ts::BatchNormLayer<float>;
 template class ts::MultiLayerPerceptron<float>;
 template class ts::ConvolutionalNetwork<float>;
 
@@ -62,15 +116,24 @@ template class ts::Optimizer<float>;
 template class ts::GradientDescentOptimizer<float>;
 template class ts::AdamOptimizer<float>;
 
+template class ts::CheckpointWriter<float>;
+
 template std::string ts::serializeTensor(ts::Tensor<float> &tensor);
 template ts::Tensor<float> ts::parseTensor(
-	std::ifstream &in, ts::WengertList<float> * wList
+	std::ifstream &in, ts::WengertList<float> * wList, bool model
 );
 template std::string ts::serializeTensorsVector(
 	std::vector<ts::Tensor<float>> &tensorsVector
 );
 template std::vector<ts::Tensor<float>> ts::parseTensorsVector(
-	std::ifstream &in, ts::WengertList<float> * wList
+	std::ifstream &in, ts::WengertList<float> * wList, bool model
+);
+template class ts::ModelSnapshot<float>;
+template bool ts::writeBinarySnapshot(
+	std::string filePath, ts::ModelSnapshot<float> &snapshot
+);
+template bool ts::readBinarySnapshot(
+	std::string filePath, ts::ModelSnapshot<float> &snapshot
 );
 
 template Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> ts::convArray(
@@ -83,7 +146,19 @@ template ts::Tensor<float> ts::convolution(
 );
 template class ts::PoolingNode<float>;
 template ts::Tensor<float> ts::maxPooling(
-	const ts::Tensor<float> &x, std::vector<unsigned> pool
+	const ts::Tensor<float> &x, std::vector<unsigned> pool,
+	std::vector<unsigned> stride, std::vector<unsigned> padding,
+	unsigned nChannels
+);
+template class ts::AveragePoolingNode<float>;
+template ts::Tensor<float> ts::averagePooling(
+	const ts::Tensor<float> &x, std::vector<unsigned> pool,
+	std::vector<unsigned> stride, std::vector<unsigned> padding,
+	unsigned nChannels
+);
+template class ts::GlobalAveragePoolingNode<float>;
+template ts::Tensor<float> ts::globalAveragePooling(
+	const ts::Tensor<float> &x, unsigned nChannels
 );
 template class ts::SplitNode<float>;
 template std::vector<ts::Tensor<float>> ts::split(
@@ -93,18 +168,108 @@ template class ts::VertCatNode<float>;
 template ts::Tensor<float> ts::vertCat<float>(
 	const std::vector<ts::Tensor<float>> &x
 );
+template class ts::HorCatNode<float>;
+template ts::Tensor<float> ts::horCat<float>(
+	const std::vector<ts::Tensor<float>> &x
+);
 template class ts::FlatteningNode<float>;
 template ts::Tensor<float> ts::flattening<float>(const ts::Tensor<float> &x);
+template void ts::maxPoolKernel(
+	const float * src, long srcStride,
+	const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+	float * dst, long * argmax, long dstStride
+);
+template void ts::averagePoolKernel(
+	const float * src, long srcStride,
+	const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+	float * dst, long dstStride
+);
+template void ts::im2colPack(
+	const float * src, long srcStride,
+	const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+	float * dst, long dstStride
+);
+template void ts::im2colScatter(
+	const float * src, long srcStride,
+	const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+	float * dst, long dstStride
+);
 template class ts::Im2ColNode<float>;
 template ts::Tensor<float> ts::im2col<float>(
 	const std::vector<ts::Tensor<float>> &x,
-	std::vector<unsigned> kernelDim
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+);
+template ts::Tensor<float> ts::im2col<float>(
+	const ts::Tensor<float> &x,
+	unsigned nChannels,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+);
+template class ts::ImplicitConvNode<float>;
+template ts::Tensor<float> ts::implicitConv<float>(
+	const ts::Tensor<float> &kernel,
+	const std::vector<ts::Tensor<float>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+);
+template class ts::WinogradCache<float>;
+template class ts::WinogradNode<float>;
+template ts::Tensor<float> ts::winogradConv<float>(
+	const ts::Tensor<float> &kernel,
+	const std::vector<ts::Tensor<float>> &x,
+	std::vector<unsigned> padding,
+	unsigned outputTile,
+	const ts::WinogradCache<float> * cache
+);
+template void ts::fft(
+	std::complex<float> * data, long n, long stride,
+	const std::complex<float> * twiddles
+);
+template void ts::fft2(
+	Eigen::Array<std::complex<float>, Eigen::Dynamic, Eigen::Dynamic> &x,
+	bool inverse
+);
+template class ts::FFTConvNode<float>;
+template ts::Tensor<float> ts::fftConv<float>(
+	const ts::Tensor<float> &kernel,
+	const std::vector<ts::Tensor<float>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> padding
+);
+template class ts::DepthwiseConvNode<float>;
+template ts::Tensor<float> ts::depthwiseConv<float>(
+	const ts::Tensor<float> &kernel,
+	const std::vector<ts::Tensor<float>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
 );
 template class ts::Col2ImNode<float>;
 template std::vector<ts::Tensor<float>> ts::col2im<float>(
 	const ts::Tensor<float> &x,
 	std::vector<unsigned> outputDim
 );
+template class ts::PackedCol2ImNode<float>;
+template ts::Tensor<float> ts::packedCol2im<float>(
+	const ts::Tensor<float> &x,
+	std::vector<unsigned> outputDim
+);
+template class ts::ConvBlockNode<float>;
+template ts::Tensor<float> ts::convBlock<float>(
+	const ts::Tensor<float> &conv,
+	const ts::Tensor<float> &bias,
+	std::vector<unsigned> outputDim,
+	std::vector<unsigned> pool,
+	ts::Tensor<float> (*activation)(const ts::Tensor<float>&)
+);
 
 
 
@@ -115,6 +280,12 @@ template class ts::InputNode<double>;
 template class ts::ElementWiseNode<double>;
 template class ts::MatProdNode<double>;
 template class ts::ScalarNode<double>;
+template class ts::BroadcastNode<double>;
+template class ts::BatchNormNode<double>;
+template class ts::SoftmaxNode<double>;
+template class ts::ReluNode<double>;
+template class ts::SigmoidNode<double>;
+template class ts::TanhNode<double>;
 
 template class ts::WengertList<double>;
 template class ts::Tensor<double>;
@@ -131,14 +302,60 @@ template ts::Tensor<double> ts::operator*(const ts::Tensor<double> &x, const ts:
 template ts::Tensor<double> ts::operator/(const ts::Tensor<double> &x, const ts::Tensor<double> &y);
 
 template ts::Tensor<double> ts::matProd(const ts::Tensor<double> &x, const ts::Tensor<double> &y);
+template ts::Tensor<double> ts::broadcastAdd(const ts::Tensor<double> &x, const ts::Tensor<double> &y);
+template ts::Tensor<double> ts::batchNorm(
+	const ts::Tensor<double> &x, const ts::Tensor<double> &scale, const ts::Tensor<double> &shift,
+	const Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> &mean,
+	const Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> &variance,
+	double epsilon
+);
+template ts::Tensor<double> ts::batchNorm(
+	const ts::Tensor<double> &x, const ts::Tensor<double> &scale, const ts::Tensor<double> &shift,
+	double epsilon
+);
 template ts::Tensor<double> ts::sigmoid(const ts::Tensor<double> &x);
 template ts::Tensor<double> ts::relu(const ts::Tensor<double> &x);
 template ts::Tensor<double> ts::leakyRelu(const ts::Tensor<double> &x);
+template ts::Tensor<double> ts::tanh(const ts::Tensor<double> &x);
+template ts::Tensor<double> ts::softmax(const ts::Tensor<double> &x);
 template ts::Tensor<double> ts::rescale(const ts::Tensor<double> &x);
 template ts::Tensor<double> ts::squaredNorm(const ts::Tensor<double> &x);
+template ts::Tensor<double> ts::softmaxCrossEntropy(
+	const ts::Tensor<double> &x, const std::vector<unsigned> &labels
+);
+template ts::Tensor<double> ts::identity(const ts::Tensor<double> &x);
+
+template void ts::reluKernel<double>(const double * x, long n, double * res, uint32_t * mask);
+template void ts::leakyReluKernel<double>(
+	const double * x, long n, double slope, double * res, uint32_t * mask
+);
+template void ts::maskKernel<double>(
+	const double * d, long n, const uint32_t * mask, double slope, double * res
+);
+template void ts::sigmoidKernel<double>(const double * x, long n, double * res);
+template void ts::tanhKernel<double>(const double * x, long n, double * res);
+template void ts::sigmoidGradKernel<double>(const double * s, const double * d, long n, double * res);
+template void ts::tanhGradKernel<double>(const double * s, const double * d, long n, double * res);
+template void ts::softmaxKernel<double>(const double * x, long rows, long cols, double * res);
+template double ts::softmaxCrossEntropyKernel<double>(
+	const double * x, long rows, long cols, const unsigned * labels, double * dx
+);
+template void ts::addKernel<double>(const double * x, const double * y, long n, double * res);
+template void ts::subtractKernel<double>(const double * x, const double * y, long n, double * res);
+template void ts::multiplyKernel<double>(const double * x, const double * y, long n, double * res);
+template void ts::divideKernel<double>(
+	const double * x, const double * y, long n, double * res, double * dx, double * dy
+);
+template void ts::stepKernel<double>(const double * increment, long n, double rate, double * value);
+template void ts::adamKernel<double>(
+	double * grad, long n, double beta1, double beta2,
+	double correction1, double correction2, double epsilon,
+	double * m, double * v
+);
 
 template class ts::Model<double>;
 template class ts::Polynom<double>;
+template class ts::BatchNormLayer<double>;
 template class ts::MultiLayerPerceptron<double>;
 template class ts::ConvolutionalNetwork<double>;
 
@@ -149,15 +366,24 @@ template class ts::Optimizer<double>;
 template class ts::GradientDescentOptimizer<double>;
 template class ts::AdamOptimizer<double>;
 
+template class ts::CheckpointWriter<double>;
+
 template std::string ts::serializeTensor(ts::Tensor<double> &tensor);
 template ts::Tensor<double> ts::parseTensor(
-	std::ifstream &in, ts::WengertList<double> * wList
+	std::ifstream &in, ts::WengertList<double> * wList, bool model
 );
 template std::string ts::serializeTensorsVector(
 	std::vector<ts::Tensor<double>> &tensorsVector
 );
 template std::vector<ts::Tensor<double>> ts::parseTensorsVector(
-	std::ifstream &in, ts::WengertList<double> * wList
+	std::ifstream &in, ts::WengertList<double> * wList, bool model
+);
+template class ts::ModelSnapshot<double>;
+template bool ts::writeBinarySnapshot(
+	std::string filePath, ts::ModelSnapshot<double> &snapshot
+);
+template bool ts::readBinarySnapshot(
+	std::string filePath, ts::ModelSnapshot<double> &snapshot
 );
 
 template Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> ts::convArray(
@@ -170,7 +396,19 @@ template ts::Tensor<double> ts::convolution(
 );
 template class ts::PoolingNode<double>;
 template ts::Tensor<double> ts::maxPooling(
-	const ts::Tensor<double> &x, std::vector<unsigned> pool
+	const ts::Tensor<double> &x, std::vector<unsigned> pool,
+	std::vector<unsigned> stride, std::vector<unsigned> padding,
+	unsigned nChannels
+);
+template class ts::AveragePoolingNode<double>;
+template ts::Tensor<double> ts::averagePooling(
+	const ts::Tensor<double> &x, std::vector<unsigned> pool,
+	std::vector<unsigned> stride, std::vector<unsigned> padding,
+	unsigned nChannels
+);
+template class ts::GlobalAveragePoolingNode<double>;
+template ts::Tensor<double> ts::globalAveragePooling(
+	const ts::Tensor<double> &x, unsigned nChannels
 );
 template class ts::SplitNode<double>;
 template std::vector<ts::Tensor<double>> ts::split(
@@ -180,15 +418,105 @@ template class ts::VertCatNode<double>;
 template ts::Tensor<double> ts::vertCat<double>(
 	const std::vector<ts::Tensor<double>> &x
 );
+template class ts::HorCatNode<double>;
+template ts::Tensor<double> ts::horCat<double>(
+	const std::vector<ts::Tensor<double>> &x
+);
 template class ts::FlatteningNode<double>;
 template ts::Tensor<double> ts::flattening<double>(const ts::Tensor<double> &x);
+template void ts::maxPoolKernel(
+	const double * src, long srcStride,
+	const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+	double * dst, long * argmax, long dstStride
+);
+template void ts::averagePoolKernel(
+	const double * src, long srcStride,
+	const ts::ConvGeometry &geometry, long colBegin, long colEnd,
+	double * dst, long dstStride
+);
+template void ts::im2colPack(
+	const double * src, long srcStride,
+	const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+	double * dst, long dstStride
+);
+template void ts::im2colScatter(
+	const double * src, long srcStride,
+	const ts::ConvGeometry &geometry, long rowBegin, long rowEnd,
+	double * dst, long dstStride
+);
 template class ts::Im2ColNode<double>;
 template ts::Tensor<double> ts::im2col<double>(
 	const std::vector<ts::Tensor<double>> &x,
-	std::vector<unsigned> kernelDim
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+);
+template ts::Tensor<double> ts::im2col<double>(
+	const ts::Tensor<double> &x,
+	unsigned nChannels,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+);
+template class ts::ImplicitConvNode<double>;
+template ts::Tensor<double> ts::implicitConv<double>(
+	const ts::Tensor<double> &kernel,
+	const std::vector<ts::Tensor<double>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
+);
+template class ts::WinogradCache<double>;
+template class ts::WinogradNode<double>;
+template ts::Tensor<double> ts::winogradConv<double>(
+	const ts::Tensor<double> &kernel,
+	const std::vector<ts::Tensor<double>> &x,
+	std::vector<unsigned> padding,
+	unsigned outputTile,
+	const ts::WinogradCache<double> * cache
+);
+template void ts::fft(
+	std::complex<double> * data, long n, long stride,
+	const std::complex<double> * twiddles
+);
+template void ts::fft2(
+	Eigen::Array<std::complex<double>, Eigen::Dynamic, Eigen::Dynamic> &x,
+	bool inverse
+);
+template class ts::FFTConvNode<double>;
+template ts::Tensor<double> ts::fftConv<double>(
+	const ts::Tensor<double> &kernel,
+	const std::vector<ts::Tensor<double>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> padding
+);
+template class ts::DepthwiseConvNode<double>;
+template ts::Tensor<double> ts::depthwiseConv<double>(
+	const ts::Tensor<double> &kernel,
+	const std::vector<ts::Tensor<double>> &x,
+	std::vector<unsigned> kernelDim,
+	std::vector<unsigned> stride,
+	std::vector<unsigned> padding,
+	std::vector<unsigned> dilation
 );
 template class ts::Col2ImNode<double>;
 template std::vector<ts::Tensor<double>> ts::col2im<double>(
 	const ts::Tensor<double> &x,
 	std::vector<unsigned> outputDim
 );
+template class ts::PackedCol2ImNode<double>;
+template ts::Tensor<double> ts::packedCol2im<double>(
+	const ts::Tensor<double> &x,
+	std::vector<unsigned> outputDim
+);
+template class ts::ConvBlockNode<double>;
+template ts::Tensor<double> ts::convBlock<double>(
+	const ts::Tensor<double> &conv,
+	const ts::Tensor<double> &bias,
+	std::vector<unsigned> outputDim,
+	std::vector<unsigned> pool,
+	ts::Tensor<double> (*activation)(const ts::Tensor<double>&)
+);
@@ -0,0 +1,269 @@
+/*
+* Element-wise kernels of the activation functions, arithmetic operators and
+* optimizers. Each kernel computes its values (and derivatives) in a single
+* pass on raw arrays, so that the compiler can vectorize it (with simd loops
+* or Eigen packet expressions).
+* Loops are cloned with TS_TARGET_CLONES. Eigen selects its packets at compile
+* time, so cloning the Eigen kernels wouldn't widen them.
+*/
+
+#include "../include/kernels.hpp"
+#include "../include/utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+
+// Bit of each element of a mask word
+#define TS_MASK_BITS(bits) \
+	uint32_t bits[TS_MASK_WORD_BITS]; \
+	for(long k=0; k<TS_MASK_WORD_BITS; k++) { \
+		bits[k] = 1u << k; \
+	}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::reluKernel(const T * x, long n, T * res, uint32_t * mask) {
+	// Branchless selects, vectorized as masks. Mask bits are set from a
+	// table, since SSE has no variable shifts.
+
+	TS_MASK_BITS(bits)
+
+	for(long begin=0; begin<n; begin+=TS_MASK_WORD_BITS) {
+		long size = std::min((long) TS_MASK_WORD_BITS, n - begin);
+		const T * xWord = x + begin;
+		T * resWord = res + begin;
+
+		uint32_t word = 0;
+		#pragma omp simd reduction(|:word)
+		for(long k=0; k<size; k++) {
+			bool positive = xWord[k] > 0;
+			resWord[k] = positive ? xWord[k] : (T) 0;
+			word |= positive ? bits[k] : 0u;
+		}
+		mask[begin / TS_MASK_WORD_BITS] = word;
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::leakyReluKernel(const T * x, long n, T slope, T * res, uint32_t * mask) {
+	// Selecting slope * x isn't if-converted by GCC (the product might trap),
+	// so both parts are always computed
+
+	TS_MASK_BITS(bits)
+
+	for(long begin=0; begin<n; begin+=TS_MASK_WORD_BITS) {
+		long size = std::min((long) TS_MASK_WORD_BITS, n - begin);
+		const T * xWord = x + begin;
+		T * resWord = res + begin;
+
+		uint32_t word = 0;
+		#pragma omp simd reduction(|:word)
+		for(long k=0; k<size; k++) {
+			T value = xWord[k];
+			bool positive = value > 0;
+			resWord[k] = std::max(value, (T) 0) + slope * std::min(value, (T) 0);
+			word |= positive ? bits[k] : 0u;
+		}
+		mask[begin / TS_MASK_WORD_BITS] = word;
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::maskKernel(const T * d, long n, const uint32_t * mask, T slope, T * res) {
+	// Bits are turned into 0 / 1 factors with integer ops only, then
+	// bit + (1 - bit) * slope is exactly 1 or slope
+
+	TS_MASK_BITS(bits)
+
+	for(long begin=0; begin<n; begin+=TS_MASK_WORD_BITS) {
+		long size = std::min((long) TS_MASK_WORD_BITS, n - begin);
+		const T * dWord = d + begin;
+		T * resWord = res + begin;
+		uint32_t word = mask[begin / TS_MASK_WORD_BITS];
+
+		#pragma omp simd
+		for(long k=0; k<size; k++) {
+			T bit = (T) (int) std::min(word & bits[k], 1u);
+			resWord[k] = dWord[k] * (bit + (1 - bit) * slope);
+		}
+	}
+}
+
+
+
+template <typename T>
+void ts::sigmoidKernel(const T * x, long n, T * res) {
+	// Eigen vectorizes exp with packet ops. Using e^-x, large inputs saturate
+	// to 0 / 1 instead of giving inf / inf.
+
+	Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> xVec(x, n);
+	Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> resVec(res, n);
+
+	resVec = ((-xVec).exp() + 1).inverse();
+}
+
+
+
+template <typename T>
+void ts::tanhKernel(const T * x, long n, T * res) {
+	Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> xVec(x, n);
+	Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> resVec(res, n);
+
+	resVec = xVec.tanh();
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::sigmoidGradKernel(const T * s, const T * d, long n, T * res) {
+	for(long i=0; i<n; i++) {
+		res[i] = s[i] * (1 - s[i]) * d[i];
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::tanhGradKernel(const T * s, const T * d, long n, T * res) {
+	for(long i=0; i<n; i++) {
+		res[i] = (1 - s[i] * s[i]) * d[i];
+	}
+}
+
+
+
+template <typename T>
+void ts::softmaxKernel(const T * x, long rows, long cols, T * res) {
+	// The max of each column is subtracted before exp to avoid overflows
+
+	if(rows == 0) {
+		return;
+	}
+
+	for(long j=0; j<cols; j++) {
+		Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> xCol(x + j * rows, rows);
+		Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> resCol(res + j * rows, rows);
+
+		resCol = (xCol - xCol.maxCoeff()).exp();
+		resCol /= resCol.sum();
+	}
+}
+
+
+
+template <typename T>
+T ts::softmaxCrossEntropyKernel(
+	const T * x, long rows, long cols, const unsigned * labels, T * dx
+) {
+	// -log(softmax(x)_label) = log(sum_k(e^(x_k - max))) - (x_label - max),
+	// which never takes the log of an underflowed probability
+
+	T loss = 0;
+
+	if(rows == 0) {
+		return loss;
+	}
+
+	for(long j=0; j<cols; j++) {
+		Eigen::Map<const Eigen::Array<T, Eigen::Dynamic, 1>> xCol(x + j * rows, rows);
+		Eigen::Map<Eigen::Array<T, Eigen::Dynamic, 1>> dxCol(dx + j * rows, rows);
+
+		T max = xCol.maxCoeff();
+		dxCol = (xCol - max).exp();
+		T sum = dxCol.sum();
+
+		loss += std::log(sum) - (xCol(labels[j]) - max);
+
+		dxCol /= sum;
+		dxCol(labels[j]) -= 1;
+	}
+
+	return loss;
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::addKernel(const T * x, const T * y, long n, T * res) {
+	for(long i=0; i<n; i++) {
+		res[i] = x[i] + y[i];
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::subtractKernel(const T * x, const T * y, long n, T * res) {
+	for(long i=0; i<n; i++) {
+		res[i] = x[i] - y[i];
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::multiplyKernel(const T * x, const T * y, long n, T * res) {
+	for(long i=0; i<n; i++) {
+		res[i] = x[i] * y[i];
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::divideKernel(const T * x, const T * y, long n, T * res, T * dx, T * dy) {
+	#pragma omp simd
+	for(long i=0; i<n; i++) {
+		res[i] = x[i] / y[i];
+		dx[i] = 1 / y[i];
+		dy[i] = -x[i] / (y[i] * y[i]);
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::stepKernel(const T * increment, long n, T rate, T * value) {
+	for(long i=0; i<n; i++) {
+		value[i] -= rate * increment[i];
+	}
+}
+
+
+
+template <typename T>
+TS_TARGET_CLONES
+void ts::adamKernel(
+	T * grad, long n, T beta1, T beta2,
+	T correction1, T correction2, T epsilon,
+	T * m, T * v
+) {
+	// sqrt is only vectorized without errno (see OPT_FLAGS)
+
+	#pragma omp simd
+	for(long i=0; i<n; i++) {
+		m[i] = beta1 * m[i] + (1 - beta1) * grad[i];
+		v[i] = beta2 * v[i] + (1 - beta2) * grad[i] * grad[i];
+
+		T mHat = m[i] / correction1;
+		T vHat = v[i] / correction2;
+		grad[i] = mHat / (std::sqrt(vHat) + epsilon);
+	}
+}
@@ -17,6 +17,188 @@ void ts::Model<T>::toggleOptimize(ts::Tensor<T> * tensor, bool enable) {
 
 
 
+template <typename T>
+void ts::Model<T>::parametersUpdated() {
+}
+
+
+
+template <typename T>
+void ts::Model<T>::saveBinary(std::string filePath) {
+	ts::ModelSnapshot<T> modelSnapshot = snapshot();
+	ts::writeBinarySnapshot(filePath, modelSnapshot);
+}
+
+
+
+template <typename T>
+void ts::Model<T>::loadBinary(std::string filePath) {
+	ts::ModelSnapshot<T> modelSnapshot;
+
+	if(ts::readBinarySnapshot(filePath, modelSnapshot)) {
+		restore(modelSnapshot);
+	}
+}
+
+
+
+template <typename T>
+void ts::Model<T>::loadFile(std::string filePath) {
+	// Binary files start with the magic string, text files with a number
+
+	const unsigned magicSize = sizeof(TS_BINARY_MAGIC) - 1;
+	char magic[magicSize] = {0};
+
+	std::ifstream in(filePath, std::ios::binary);
+	in.read(magic, magicSize);
+	bool isBinary =
+		in.gcount() == magicSize &&
+		std::memcmp(magic, TS_BINARY_MAGIC, magicSize) == 0;
+	in.close();
+
+	if(isBinary) {
+		loadBinary(filePath);
+	} else {
+		load(filePath);
+	}
+}
+
+
+
+	// ts::BatchNormLayer
+
+template <typename T>
+ts::BatchNormLayer<T>::BatchNormLayer(unsigned size, ts::WengertList<T> * wList) {
+	// Identity normalization until statistics are gathered
+	scale = ts::Tensor<T>(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>().setOnes(size, 1),
+		wList, true
+	);
+	shift = ts::Tensor<T>(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>().setZero(size, 1),
+		wList, true
+	);
+
+	mean.setZero(size, 1);
+	variance.setOnes(size, 1);
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::BatchNormLayer<T>::compute(ts::Tensor<T> x, bool training) {
+	if(!training) {
+		return ts::batchNorm(x, scale, shift, mean, variance, epsilon);
+	}
+
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &value = x.getValue();
+
+	// A single column has no statistics of its own : it is normalized with
+	// the running ones, and its deviation is taken from the mean before this
+	// update
+	if(value.cols() == 1) {
+		variance = (1 - momentum) * variance + momentum * (value - mean).square();
+		mean = (1 - momentum) * mean + momentum * value;
+		return ts::batchNorm(x, scale, shift, mean, variance, epsilon);
+	}
+
+	// Otherwise, each row is normalized with its own statistics (eg over the
+	// positions of a convolution channel), which are also accumulated
+	Eigen::Array<T, Eigen::Dynamic, 1> sampleMean = value.rowwise().mean();
+	variance = (1 - momentum) * variance +
+	momentum * (value.colwise() - sampleMean).square().rowwise().mean();
+	mean = (1 - momentum) * mean + momentum * sampleMean;
+
+	return ts::batchNorm(x, scale, shift, epsilon);
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, 1> ts::BatchNormLayer<T>::factor() {
+	return scale.getValue().col(0) * (variance.col(0) + epsilon).rsqrt();
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, 1> ts::BatchNormLayer<T>::offset() {
+	return shift.getValue().col(0) - mean.col(0) * factor();
+}
+
+
+
+template <typename T>
+std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>
+ts::BatchNormLayer<T>::flatten(std::vector<ts::BatchNormLayer<T>> &layers) {
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> arrays = {};
+
+	for(unsigned i=0; i<layers.size(); i++) {
+		arrays.push_back(layers[i].scale.getValue());
+		arrays.push_back(layers[i].shift.getValue());
+		arrays.push_back(layers[i].mean);
+		arrays.push_back(layers[i].variance);
+	}
+
+	return arrays;
+}
+
+
+
+template <typename T>
+std::vector<ts::BatchNormLayer<T>> ts::BatchNormLayer<T>::unflatten(
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> &arrays,
+	ts::WengertList<T> * wList
+) {
+	std::vector<ts::BatchNormLayer<T>> layers = {};
+
+	for(unsigned i=0; i+3<arrays.size(); i+=4) {
+		ts::BatchNormLayer<T> layer;
+		layer.scale = ts::Tensor<T>(std::move(arrays[i]), wList, true);
+		layer.shift = ts::Tensor<T>(std::move(arrays[i+1]), wList, true);
+		layer.mean = std::move(arrays[i+2]);
+		layer.variance = std::move(arrays[i+3]);
+		layers.push_back(layer);
+	}
+
+	return layers;
+}
+
+
+
+template <typename T>
+std::string ts::BatchNormLayer<T>::serialize(
+	std::vector<ts::BatchNormLayer<T>> &layers
+) {
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> arrays =
+	flatten(layers);
+
+	std::vector<ts::Tensor<T>> tensors = {};
+	for(unsigned i=0; i<arrays.size(); i++) {
+		tensors.push_back(ts::Tensor<T>(std::move(arrays[i]), NULL));
+	}
+
+	return ts::serializeTensorsVector(tensors);
+}
+
+
+
+template <typename T>
+std::vector<ts::BatchNormLayer<T>> ts::BatchNormLayer<T>::parse(
+	std::ifstream &in, ts::WengertList<T> * wList
+) {
+	std::vector<ts::Tensor<T>> tensors = ts::parseTensorsVector<T>(in, NULL);
+
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> arrays = {};
+	for(unsigned i=0; i<tensors.size(); i++) {
+		arrays.push_back(tensors[i].getValue());
+	}
+
+	return unflatten(arrays, wList);
+}
+
+
+
 	// ts::Polynom
 
 template <typename T>
@@ -39,6 +221,22 @@ ts::Polynom<T>::Polynom(unsigned order, std::vector<long> size) {
 
 
 
+template <typename T>
+ts::Polynom<T>::Polynom(std::string filePath) {
+	this->loadFile(filePath);
+}
+
+
+
+template <typename T>
+ts::Polynom<T> ts::Polynom<T>::fromFile(std::string filePath) {
+	// Returning a prvalue guarantees the model is constructed in place (the
+	// tensors point to its wList, so it must not be copied)
+	return ts::Polynom<T>(filePath);
+}
+
+
+
 template <typename T>
 void ts::Polynom<T>::toggleGlobalOptimize(bool enable) {
 	for(unsigned i=0; i<coefficients.size(); i++) {
@@ -111,13 +309,13 @@ void ts::Polynom<T>::save(std::string filePath) {
 
 template <typename T>
 void ts::Polynom<T>::load(std::string filePath) {
-	// Delete current tensors and reset wList
+	// Delete current tensors and clear wList
 	coefficients = {};
-	this->wList.reset();
+	this->wList.clear();
 
 	// Load new tensors
 	std::ifstream in(filePath);
-	coefficients = ts::parseTensorsVector(in, &(this->wList));
+	coefficients = ts::parseTensorsVector(in, &(this->wList), true);
 	in.close();
 
 	// Set number of wors and cols
@@ -132,6 +330,49 @@ void ts::Polynom<T>::load(std::string filePath) {
 
 
 
+template <typename T>
+ts::ModelSnapshot<T> ts::Polynom<T>::snapshot() {
+	ts::ModelSnapshot<T> modelSnapshot;
+
+	modelSnapshot.groups = {{}};
+	for(unsigned i=0; i<coefficients.size(); i++) {
+		modelSnapshot.groups[0].push_back(coefficients[i].getValue());
+	}
+
+	return modelSnapshot;
+}
+
+
+
+template <typename T>
+void ts::Polynom<T>::restore(ts::ModelSnapshot<T> &snapshot) {
+	if(snapshot.groups.size() != 1) {
+		std::cout << "ERROR: Snapshot is not a polynom" << std::endl;
+		return;
+	}
+
+	// Delete current tensors and clear wList
+	coefficients = {};
+	this->wList.clear();
+
+	for(unsigned i=0; i<snapshot.groups[0].size(); i++) {
+		coefficients.push_back(
+			ts::Tensor<T>(std::move(snapshot.groups[0][i]), &(this->wList), true)
+		);
+	}
+
+	// Set number of rows and cols
+	if(coefficients.size() > 0) {
+		nRows = coefficients[0].getValue().rows();
+		nCols = coefficients[0].getValue().cols();
+	} else {
+		nRows = 0;
+		nCols = 0;
+	}
+}
+
+
+
 template <typename T>
 long ts::Polynom<T>::rows() {
 	return nRows;
@@ -150,7 +391,7 @@ long ts::Polynom<T>::cols() {
 
 template <typename T>
 ts::MultiLayerPerceptron<T>::MultiLayerPerceptron(
-	unsigned inputSize, std::vector<unsigned> layers
+	unsigned inputSize, std::vector<unsigned> layers, bool batchNormalization
 ) {
 	// Each element of the layers vector is a new layer, its value represents
 	// the layer size. Values are randomly initialized between 0 and 1.
@@ -186,18 +427,63 @@ ts::MultiLayerPerceptron<T>::MultiLayerPerceptron(
 			.setRandom(layers[i], 1) * variance,
 			&(this->wList), true)
 		);
+
+		// Normalize hidden layers
+		if(batchNormalization && i < layers.size() - 1) {
+			norms.push_back(ts::BatchNormLayer<T>(layers[i], &(this->wList)));
+		}
 	}
 
 }
 
 
 
+template <typename T>
+ts::MultiLayerPerceptron<T>::MultiLayerPerceptron(std::string filePath) {
+	this->loadFile(filePath);
+}
+
+
+
+template <typename T>
+ts::MultiLayerPerceptron<T> ts::MultiLayerPerceptron<T>::fromFile(
+	std::string filePath
+) {
+	return ts::MultiLayerPerceptron<T>(filePath);
+}
+
+
+
 template <typename T>
 void ts::MultiLayerPerceptron<T>::toggleGlobalOptimize(bool enable) {
 	for(unsigned i=0; i<weights.size(); i++) {
 		this->toggleOptimize(&(weights[i]), enable);
 		this->toggleOptimize(&(biases[i]), enable);
 	}
+
+	for(unsigned i=0; i<norms.size(); i++) {
+		this->toggleOptimize(&(norms[i].scale), enable);
+		this->toggleOptimize(&(norms[i].shift), enable);
+	}
+}
+
+
+
+template <typename T>
+void ts::MultiLayerPerceptron<T>::foldBatchNorm() {
+	// BN(W.x) + b = (factor * W).x + (offset + b)
+
+	ts::ModelSnapshot<T> modelSnapshot = snapshot();
+
+	for(unsigned i=0; i<norms.size() && i<weights.size(); i++) {
+		Eigen::Array<T, Eigen::Dynamic, 1> factor = norms[i].factor();
+
+		modelSnapshot.groups[0][i].colwise() *= factor;
+		modelSnapshot.groups[1][i].colwise() += norms[i].offset();
+	}
+
+	modelSnapshot.groups[2] = {};
+	restore(modelSnapshot);
 }
 
 
@@ -218,13 +504,18 @@ ts::Tensor<T> ts::MultiLayerPerceptron<T>::compute(ts::Tensor<T> input) {
 
 	// Begin computation loop
 	for(unsigned i=0; i<weights.size(); i++) {
+		ts::Tensor<T> z = matProd(weights[i], input);
+		if(i < norms.size()) {
+			z = norms[i].compute(z, this->training);
+		}
+
 		// Hidden layer
 		if(i < weights.size() - 1) {
-			input = (*activationFunction)(matProd(weights[i], input) + biases[i]);
+			input = (*activationFunction)(z + biases[i]);
 		}
 		// Final layer (we might want another activation function)
 		else {
-			input = (*finalActivation)(matProd(weights[i], input) + biases[i]);
+			input = (*finalActivation)(z + biases[i]);
 		}
 	}
 
@@ -240,6 +531,8 @@ void ts::MultiLayerPerceptron<T>::save(std::string filePath) {
 	out << ts::serializeTensorsVector(weights);
 	out << ts::serializeTensorsVector(biases);
 
+	out << ts::BatchNormLayer<T>::serialize(norms);
+
 	out.close();
 }
 
@@ -247,22 +540,76 @@ void ts::MultiLayerPerceptron<T>::save(std::string filePath) {
 
 template <typename T>
 void ts::MultiLayerPerceptron<T>::load(std::string filePath) {
-	// Delete current tensors and reset wList
+	// Delete current tensors and clear wList
 	weights = {};
 	biases = {};
-	this->wList.reset();
+	norms = {};
+	this->wList.clear();
 
 	// Load new tensors
 	std::ifstream in(filePath);
 
-	weights = ts::parseTensorsVector(in, &(this->wList));
-	biases = ts::parseTensorsVector(in, &(this->wList));
+	weights = ts::parseTensorsVector(in, &(this->wList), true);
+	biases = ts::parseTensorsVector(in, &(this->wList), true);
+
+	// Older models don't have batch normalization
+	norms = ts::BatchNormLayer<T>::parse(in, &(this->wList));
 
 	in.close();
 }
 
 
 
+template <typename T>
+ts::ModelSnapshot<T> ts::MultiLayerPerceptron<T>::snapshot() {
+	ts::ModelSnapshot<T> modelSnapshot;
+
+	modelSnapshot.groups = {{}, {}};
+	for(unsigned i=0; i<weights.size(); i++) {
+		modelSnapshot.groups[0].push_back(weights[i].getValue());
+	}
+	for(unsigned i=0; i<biases.size(); i++) {
+		modelSnapshot.groups[1].push_back(biases[i].getValue());
+	}
+	modelSnapshot.groups.push_back(ts::BatchNormLayer<T>::flatten(norms));
+
+	return modelSnapshot;
+}
+
+
+
+template <typename T>
+void ts::MultiLayerPerceptron<T>::restore(ts::ModelSnapshot<T> &snapshot) {
+	// Older snapshots don't have the batch normalization group
+	if(snapshot.groups.size() < 2 || snapshot.groups.size() > 3) {
+		std::cout << "ERROR: Snapshot is not a MLP" << std::endl;
+		return;
+	}
+
+	// Delete current tensors and clear wList
+	weights = {};
+	biases = {};
+	norms = {};
+	this->wList.clear();
+
+	for(unsigned i=0; i<snapshot.groups[0].size(); i++) {
+		weights.push_back(
+			ts::Tensor<T>(std::move(snapshot.groups[0][i]), &(this->wList), true)
+		);
+	}
+	for(unsigned i=0; i<snapshot.groups[1].size(); i++) {
+		biases.push_back(
+			ts::Tensor<T>(std::move(snapshot.groups[1][i]), &(this->wList), true)
+		);
+	}
+
+	if(snapshot.groups.size() > 2) {
+		norms = ts::BatchNormLayer<T>::unflatten(snapshot.groups[2], &(this->wList));
+	}
+}
+
+
+
 	// ts::ConvolutionalNetwork
 
 template <typename T>
@@ -271,12 +618,27 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 	ChannelSplit splitDirection, unsigned inputChannels,
 	std::vector<std::vector<unsigned>> convLayers,
 	std::vector<std::vector<unsigned>> poolingLayers,
-	std::vector<unsigned> denseLayers
+	std::vector<unsigned> denseLayers,
+	bool channelBiases,
+	bool globalAveragePooling,
+	bool batchNormalization
 ) {
 	// inputSize : std::vector of size 3 for dimensions of 2D image / matrix
 	//	+ number of channels (number of conv kernels for each layer)
-	// convLayers : sizes of convolution kernels (std::vector of dimension 2)
+	// convLayers : sizes of convolution kernels and number of output channels
+	//	(std::vector of dimension 3), optionally followed by stride, padding,
+	//	dilation and ts::ConvLayerType (1, 0, 1 and STANDARD by default)
+	// poolingLayers : sizes of pools (std::vector of dimension 2), optionally
+	//	followed by stride, padding and ts::PoolingType (pool size, 0 and MAX by
+	//	default)
 	// fullLayers: sizes of fully connected layers
+	// channelBiases : use one convolution bias per channel instead of one per
+	//	channel and output position
+	// globalAveragePooling : average the last feature maps over each channel
+	//	instead of flattening them (the first dense layer then only has one
+	//	input per channel)
+	// batchNormalization : normalize the convolution outputs and hidden dense
+	//	layers before their biases (see ts::BatchNormLayer)
 
 
 		// Validate dimensions of network
@@ -339,9 +701,9 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 	// Make sure convolutions / poolings are possible
 	for(unsigned i=0; i<convLayers.size(); i++) {
 		// Is size of kernel correctly described
-		if(convLayers[i].size() != 3) {
+		if(!normalizeConvLayer(convLayers[i])) {
 			std::cout << "ERROR: Convolution layer " << i <<
-			" is not of dimension 3" << std::endl;
+			" is not of dimension 3 to 7" << std::endl;
 			return;
 		}
 		// Are the different numbers of channels > 0 ?
@@ -357,16 +719,22 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 		}
 
 		// Is size of pooling correctly described
-		if(poolingLayers[i].size() != 2) {
+		if(!normalizePoolingLayer(poolingLayers[i])) {
 			std::cout << "ERROR: Pooling layer " << i <<
-			" is not of dimension 2" << std::endl;
+			" is not of dimension 2 to 5" << std::endl;
 			return;
 		}
 
 
 		// Compute size of matrix after convolution
-		intermediarySize[0] = intermediarySize[0] - convLayers[i][0] + 1;
-		intermediarySize[1] = intermediarySize[1] - convLayers[i][1] + 1;
+		intermediarySize[0] = ts::convOutputSize(
+			intermediarySize[0], convLayers[i][0],
+			convLayers[i][3], convLayers[i][4], convLayers[i][5]
+		);
+		intermediarySize[1] = ts::convOutputSize(
+			intermediarySize[1], convLayers[i][1],
+			convLayers[i][3], convLayers[i][4], convLayers[i][5]
+		);
 
 
 		if(intermediarySize[0] <= 0 || intermediarySize[1] <= 0) {
@@ -376,20 +744,19 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 		}
 
 		// Compute size of matrix after pooling
-		if(poolingLayers[i][0] != 0 && poolingLayers[i][1] != 0) {
-			if(
-				intermediarySize[0] % poolingLayers[i][0] != 0 ||
-				intermediarySize[1] % poolingLayers[i][1] != 0
-			) {
-				std::cout << "ERROR: Pooling layer " << i <<
-				" is impossible" << std::endl;
-				return;
-			}
+		std::vector<unsigned> pooledSize = poolingOutputDim(
+			poolingLayers[i],
+			{(unsigned) intermediarySize[0], (unsigned) intermediarySize[1]}
+		);
 
-			intermediarySize[0] = intermediarySize[0] / poolingLayers[i][0];
-			intermediarySize[1] = intermediarySize[1] / poolingLayers[i][1];
+		if(pooledSize[0] == 0 || pooledSize[1] == 0) {
+			std::cout << "ERROR: Pooling layer " << i <<
+			" is impossible" << std::endl;
+			return;
 		}
 
+		intermediarySize = {(int) pooledSize[0], (int) pooledSize[1]};
+
 	}
 
 
@@ -414,29 +781,59 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 
 	channelSplit = splitDirection;
 	nInputChannels = inputChannels;
+	this->inputSize = inputSize;
 
 	// This is the input of the network, of dimension 1
 	convLayers.insert(convLayers.begin(), {0, 0, inputChannels});
 
 	convKernels = {};
 	convBiases = {};
+	pointwiseKernels = {};
 
 	for(unsigned i=1; i<convLayers.size(); i++) {
 
 		// Initializing values according to He Initialization
-		T variance = sqrt(2.0 / (convLayers[i][0] * convLayers[i][1] * convLayers[i-1][2]));
+		if(convLayers[i][6] == (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE) {
+			T variance = sqrt(2.0 / (convLayers[i][0] * convLayers[i][1]));
+
+			convKernels.push_back(ts::Tensor<T>(
+				Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
+				.setRandom(
+					convLayers[i-1][2], convLayers[i][0] * convLayers[i][1]
+				) * variance,
+				&(this->wList), true)
+			);
+
+			variance = sqrt(2.0 / convLayers[i-1][2]);
+
+			addPointwiseKernel(
+				Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
+				.setRandom(convLayers[i][2], convLayers[i-1][2]) * variance
+			);
+		}
+		else {
+			T variance = sqrt(2.0 / (convLayers[i][0] * convLayers[i][1] * convLayers[i-1][2]));
+
+			convKernels.push_back(ts::Tensor<T>(
+				Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
+				.setRandom(
+					convLayers[i][2],
+					convLayers[i][0] * convLayers[i][1] * convLayers[i-1][2]
+				) * variance,
+				&(this->wList), true)
+			);
+
+			addPointwiseKernel(Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>());
+		}
 
-		convKernels.push_back(ts::Tensor<T>(
-			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
-			.setRandom(
-				convLayers[i][2],
-				convLayers[i][0] * convLayers[i][1] * convLayers[i-1][2]
-			) * variance,
-			&(this->wList), true)
+		intermediarySize[0] = ts::convOutputSize(
+			intermediarySize[0], convLayers[i][0],
+			convLayers[i][3], convLayers[i][4], convLayers[i][5]
+		);
+		intermediarySize[1] = ts::convOutputSize(
+			intermediarySize[1], convLayers[i][1],
+			convLayers[i][3], convLayers[i][4], convLayers[i][5]
 		);
-
-		intermediarySize[0] = intermediarySize[0] - convLayers[i][0] + 1;
-		intermediarySize[1] = intermediarySize[1] - convLayers[i][1] + 1;
 
 		outputDims.push_back(
 			{(unsigned) intermediarySize[0], (unsigned) intermediarySize[1]}
@@ -446,22 +843,29 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
 			.setZero(
 				convLayers[i][2],
-				intermediarySize[0] * intermediarySize[1]
+				channelBiases ? 1 : intermediarySize[0] * intermediarySize[1]
 			),
 			&(this->wList), true)
 		);
 
-		if(poolingLayers[i-1][0] != 0 && poolingLayers[i-1][1] != 0) {
-			intermediarySize[0] = intermediarySize[0] / poolingLayers[i-1][0];
-			intermediarySize[1] = intermediarySize[1] / poolingLayers[i-1][1];
+		if(batchNormalization) {
+			convNorms.push_back(ts::BatchNormLayer<T>(convLayers[i][2], &(this->wList)));
 		}
+
+		std::vector<unsigned> pooledSize = poolingOutputDim(
+			poolingLayers[i-1], outputDims.back()
+		);
+		intermediarySize = {(int) pooledSize[0], (int) pooledSize[1]};
 	}
 
 	// Fully connected layers
+	globalPooling = globalAveragePooling;
 	denseLayers.insert(
-		// First dense layer input will be the flattened convolution output
+		// First dense layer input will be the flattened (or globally pooled)
+		// convolution output
 		denseLayers.begin(),
-		intermediarySize[0] * intermediarySize[1] * convLayers[convLayers.size() - 1][2]
+		(globalPooling ? 1 : intermediarySize[0] * intermediarySize[1]) *
+		convLayers[convLayers.size() - 1][2]
 	);
 
 	for(unsigned i=1; i<denseLayers.size(); i++) {
@@ -481,6 +885,11 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 			.setRandom(denseLayers[i], 1) * variance,
 			&(this->wList), true)
 		);
+
+		// Normalize hidden layers
+		if(batchNormalization && i < denseLayers.size() - 1) {
+			denseNorms.push_back(ts::BatchNormLayer<T>(denseLayers[i], &(this->wList)));
+		}
 	}
 
 	// Set up data fields
@@ -492,89 +901,952 @@ ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(
 
 
 template <typename T>
-void ts::ConvolutionalNetwork<T>::toggleGlobalOptimize(bool enable) {
-	if(convKernels.size() != convBiases.size()) {
-		return;
-	}
+bool ts::ConvolutionalNetwork<T>::normalizeConvLayer(
+	std::vector<unsigned> &convLayer
+) {
+	// Older models only contain {rows, cols, channels}
+	std::vector<unsigned> defaults = {0, 0, 0, 1, 0, 1, 0};
 
-	if(weights.size() != fullBiases.size()) {
-		return;
+	if(convLayer.size() < 3 || convLayer.size() > defaults.size()) {
+		return false;
 	}
 
-	for(unsigned i=0; i<convKernels.size(); i++) {
-		this->toggleOptimize(&(convKernels[i]), enable);
-		this->toggleOptimize(&(convBiases[i]), enable);
+	for(unsigned i=convLayer.size(); i<defaults.size(); i++) {
+		convLayer.push_back(defaults[i]);
 	}
 
-	for(unsigned i=0; i<weights.size(); i++) {
-		this->toggleOptimize(&(weights[i]), enable);
-		this->toggleOptimize(&(fullBiases[i]), enable);
-	}
+	return convLayer[6] <= (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE;
 }
 
 
 
 template <typename T>
-ts::Tensor<T> ts::ConvolutionalNetwork<T>::compute(ts::Tensor<T> input) {
+bool ts::ConvolutionalNetwork<T>::normalizePoolingLayer(
+	std::vector<unsigned> &poolingLayer
+) {
+	// Older models only contain {rows, cols}
+	std::vector<unsigned> defaults = {0, 0, 0, 0, 0};
 
-	// NOTE It might be a good idea to add an entire function to make sure that
-	// all parameters are compatible (in terms of size), and that output is
-	// computable
+	if(poolingLayer.size() < 2 || poolingLayer.size() > defaults.size()) {
+		return false;
+	}
 
+	for(unsigned i=poolingLayer.size(); i<defaults.size(); i++) {
+		poolingLayer.push_back(defaults[i]);
+	}
 
-	// Convert input to 2D vector (for number of channels) for use with the
-	// im2col method. This should be a faster way to compute convolutions.
+	return poolingLayer[4] <= (unsigned) ts::PoolingType::AVERAGE;
+}
 
-	std::vector<ts::Tensor<T>> inputVec = {};
 
-	if(channelSplit != ChannelSplit::NOSPLIT) {
-		inputVec = ts::split(input, channelSplit, nInputChannels);
-	}
-	else {
-		inputVec.push_back(input);
+
+template <typename T>
+std::vector<unsigned> ts::ConvolutionalNetwork<T>::poolingOutputDim(
+	const std::vector<unsigned> &poolingLayer, std::vector<unsigned> inputDim
+) {
+	// (the description may not be normalized if pooling was set manually)
+	if(poolingLayer[0] == 0 || poolingLayer[1] == 0) {
+		return inputDim;
 	}
 
+	unsigned stride = poolingLayer.size() > 2 ? poolingLayer[2] : 0;
+	unsigned padding = poolingLayer.size() > 3 ? poolingLayer[3] : 0;
 
-	// 1) Convolution / pooling computation loop
-	for(unsigned i=0; i<convKernels.size(); i++) {
-		// Compute the im2col multichannel convolution
-		input = ts::im2col(inputVec, kernelDims[i]);
-		input = (*convActivation)(matProd(convKernels[i], input) + convBiases[i]);
-		inputVec = ts::col2im(input,  outputDims[i]);
-
-		// A pooling layer of size 0 means we want to skip it
-		if(pooling[i][0] != 0 || pooling[i][1] != 0) {
-			for(unsigned j=0; j<inputVec.size(); j++) {
-				inputVec[j] = ts::maxPooling(inputVec[j], pooling[i]);
-			}
-		}
+	std::vector<unsigned> outputDim = {};
+	for(unsigned d=0; d<2; d++) {
+		outputDim.push_back(ts::poolingOutputSize(
+			inputDim[d], poolingLayer[d],
+			stride != 0 ? stride : poolingLayer[d], padding
+		));
 	}
 
-
-	// 2) Gather all channels back to input tensor,
-	// and flatten convolution outputs
-	input = vertCat(inputVec);
-	input = flattening(input);
+	return outputDim;
+}
 
 
-	// 3) Dense layers computation loop
-	for(unsigned i=0; i<weights.size(); i++) {
-		if(i < weights.size() - 1) {
-			input = (*denseActivation)(matProd(weights[i], input) + fullBiases[i]);
-		}
-		// Final layer (we might want another activation function)
-		else {
-			input = (*finalActivation)(matProd(weights[i], input) + fullBiases[i]);
-		}
-	}
 
-	return input;
+template <typename T>
+ts::ConvolutionalNetwork<T>::ConvolutionalNetwork(std::string filePath) {
+	this->loadFile(filePath);
 }
 
 
 
 template <typename T>
-void ts::ConvolutionalNetwork<T>::save(std::string filePath) {
+ts::ConvolutionalNetwork<T> ts::ConvolutionalNetwork<T>::fromFile(
+	std::string filePath
+) {
+	return ts::ConvolutionalNetwork<T>(filePath);
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::addPointwiseKernel(
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> kernel
+) {
+	// Empty kernels (standard layers) are not parameters of the model
+	ts::WengertList<T> * wList = kernel.size() != 0 ? &(this->wList) : NULL;
+	pointwiseKernels.push_back(ts::Tensor<T>(std::move(kernel), wList, true));
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::toggleGlobalOptimize(bool enable) {
+	if(convKernels.size() != convBiases.size()) {
+		return;
+	}
+
+	if(weights.size() != fullBiases.size()) {
+		return;
+	}
+
+	for(unsigned i=0; i<convKernels.size(); i++) {
+		this->toggleOptimize(&(convKernels[i]), enable);
+		this->toggleOptimize(&(convBiases[i]), enable);
+	}
+
+	for(unsigned i=0; i<pointwiseKernels.size(); i++) {
+		if(pointwiseKernels[i].getValue().size() != 0) {
+			this->toggleOptimize(&(pointwiseKernels[i]), enable);
+		}
+	}
+
+	for(unsigned i=0; i<weights.size(); i++) {
+		this->toggleOptimize(&(weights[i]), enable);
+		this->toggleOptimize(&(fullBiases[i]), enable);
+	}
+
+	for(unsigned i=0; i<convNorms.size(); i++) {
+		this->toggleOptimize(&(convNorms[i].scale), enable);
+		this->toggleOptimize(&(convNorms[i].shift), enable);
+	}
+
+	for(unsigned i=0; i<denseNorms.size(); i++) {
+		this->toggleOptimize(&(denseNorms[i].scale), enable);
+		this->toggleOptimize(&(denseNorms[i].shift), enable);
+	}
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::foldBatchNorm() {
+	// Each output channel of a convolution is a row of its kernel (or of its
+	// pointwise kernel for depthwise separable layers) :
+	// BN(K.x) + b = (factor * K).x + (offset + b)
+
+	ts::ModelSnapshot<T> modelSnapshot = snapshot();
+
+	for(unsigned i=0; i<convNorms.size() && i<convKernels.size(); i++) {
+		Eigen::Array<T, Eigen::Dynamic, 1> factor = convNorms[i].factor();
+
+		bool separable =
+		kernelDims[i][6] == (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE;
+
+		modelSnapshot.groups[separable ? 4 : 0][i].colwise() *= factor;
+		modelSnapshot.groups[1][i].colwise() += convNorms[i].offset();
+	}
+
+	for(unsigned i=0; i<denseNorms.size() && i<weights.size(); i++) {
+		Eigen::Array<T, Eigen::Dynamic, 1> factor = denseNorms[i].factor();
+
+		modelSnapshot.groups[2][i].colwise() *= factor;
+		modelSnapshot.groups[3][i].colwise() += denseNorms[i].offset();
+	}
+
+	modelSnapshot.groups[5] = {};
+	modelSnapshot.groups[6] = {};
+	restore(modelSnapshot);
+}
+
+
+
+template <typename T>
+bool ts::ConvolutionalNetwork<T>::isEligible(
+	std::vector<unsigned> &kernelDim, ts::ConvAlgorithm algorithm
+) {
+	// kernelDim is {rows, cols, channels, stride, padding, dilation}
+
+	if(algorithm == ts::ConvAlgorithm::WINOGRAD) {
+		return kernelDim[0] == 3 && kernelDim[1] == 3 &&
+		kernelDim[3] == 1 && kernelDim[5] == 1;
+	}
+
+	if(algorithm == ts::ConvAlgorithm::FFT) {
+		return kernelDim[3] == 1 && kernelDim[5] == 1;
+	}
+
+	return true;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::ConvolutionalNetwork<T>::convolve(
+	const ts::Tensor<T> &kernel,
+	const std::vector<ts::Tensor<T>> &x,
+	std::vector<unsigned> &kernelDim,
+	ts::ConvAlgorithm algorithm,
+	const ts::WinogradCache<T> * cache
+) {
+	if(!isEligible(kernelDim, algorithm)) {
+		algorithm = ts::ConvAlgorithm::IM2COL;
+	}
+
+	if(algorithm == ts::ConvAlgorithm::WINOGRAD) {
+		return ts::winogradConv(
+			kernel, x, {kernelDim[4], kernelDim[4]}, TS_WINOGRAD_OUTPUT_TILE, cache
+		);
+	}
+
+	if(algorithm == ts::ConvAlgorithm::FFT) {
+		return ts::fftConv(
+			kernel, x,
+			{kernelDim[0], kernelDim[1]},
+			{kernelDim[4], kernelDim[4]}
+		);
+	}
+
+	if(algorithm == ts::ConvAlgorithm::IMPLICIT_GEMM) {
+		return ts::implicitConv(
+			kernel, x,
+			{kernelDim[0], kernelDim[1]},
+			{kernelDim[3], kernelDim[3]},
+			{kernelDim[4], kernelDim[4]},
+			{kernelDim[5], kernelDim[5]}
+		);
+	}
+
+	return matProd(kernel, ts::im2col(
+		x,
+		{kernelDim[0], kernelDim[1]},
+		{kernelDim[3], kernelDim[3]},
+		{kernelDim[4], kernelDim[4]},
+		{kernelDim[5], kernelDim[5]}
+	));
+}
+
+
+
+template <typename T>
+std::vector<std::vector<unsigned>> ts::ConvolutionalNetwork<T>::layerInputDims(
+	std::vector<unsigned> inputDim
+) {
+	std::vector<std::vector<unsigned>> dims = {};
+
+	long splitRows = channelSplit == ChannelSplit::SPLIT_HOR ? nInputChannels : 1;
+	long splitCols = channelSplit == ChannelSplit::SPLIT_VERT ? nInputChannels : 1;
+	if(inputDim.size() != 2) {
+		return dims;
+	}
+	inputDim = {
+		(unsigned) (inputDim[0] / splitRows), (unsigned) (inputDim[1] / splitCols)
+	};
+
+	for(unsigned i=0; i<convKernels.size(); i++) {
+		if(inputDim[0] == 0 || inputDim[1] == 0) {
+			return {};
+		}
+		dims.push_back(inputDim);
+
+		std::vector<unsigned> convDim = {};
+		for(unsigned d=0; d<2; d++) {
+			convDim.push_back(ts::convOutputSize(
+				inputDim[d], kernelDims[i][d],
+				kernelDims[i][3], kernelDims[i][4], kernelDims[i][5]
+			));
+		}
+		if(convDim[0] == 0 || convDim[1] == 0) {
+			return {};
+		}
+		inputDim = poolingOutputDim(pooling[i], convDim);
+	}
+
+	return dims;
+}
+
+
+
+template <typename T>
+std::vector<unsigned> ts::ConvolutionalNetwork<T>::guessInputSize() {
+	if(kernelDims.size() == 0 || outputDims.size() == 0) {
+		return {};
+	}
+
+	std::vector<unsigned> size = {};
+	for(unsigned d=0; d<2; d++) {
+		long extent = kernelDims[0][5] * (kernelDims[0][d] - 1) + 1;
+		long channelSize = (long) (outputDims[0][d] - 1) * kernelDims[0][3] +
+		extent - 2 * kernelDims[0][4];
+		size.push_back(std::max(channelSize, 1L));
+	}
+
+	if(channelSplit == ChannelSplit::SPLIT_HOR) {
+		size[0] *= nInputChannels;
+	}
+	else if(channelSplit == ChannelSplit::SPLIT_VERT) {
+		size[1] *= nInputChannels;
+	}
+	return size;
+}
+
+
+
+template <typename T>
+ts::ConvAlgorithm ts::ConvolutionalNetwork<T>::benchmarkLayer(
+	unsigned i, std::vector<unsigned> inputDim
+) {
+	std::vector<ts::ConvAlgorithm> candidates = {
+		ts::ConvAlgorithm::IM2COL,
+		ts::ConvAlgorithm::IMPLICIT_GEMM,
+		ts::ConvAlgorithm::WINOGRAD,
+		ts::ConvAlgorithm::FFT
+	};
+
+	ts::ConvAlgorithm bestAlgorithm = ts::ConvAlgorithm::IM2COL;
+	double bestTime = std::numeric_limits<double>::infinity();
+
+	long nChannels = convKernels[i].getValue().cols() /
+	(kernelDims[i][0] * kernelDims[i][1]);
+
+	for(ts::ConvAlgorithm algorithm : candidates) {
+		if(!isEligible(kernelDims[i], algorithm)) {
+			continue;
+		}
+
+		// Model tensors survive the resets between runs
+		ts::WengertList<T> benchList;
+		ts::WinogradCache<T> cache;
+
+		ts::Tensor<T> kernel = ts::Tensor<T>(
+			convKernels[i].getValue(), &benchList, true
+		);
+		if(algorithm == ts::ConvAlgorithm::WINOGRAD) {
+			cache.update(kernel.getValue(), TS_WINOGRAD_OUTPUT_TILE);
+		}
+
+		std::vector<ts::Tensor<T>> x = {};
+		for(long j=0; j<nChannels; j++) {
+			x.push_back(ts::Tensor<T>(
+				Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
+				.setRandom(inputDim[0], inputDim[1]),
+				&benchList, true
+			));
+		}
+
+		// The first run is a warm up
+		for(unsigned run=0; run<=TS_AUTOTUNE_RUNS; run++) {
+			std::chrono::steady_clock::time_point start =
+			std::chrono::steady_clock::now();
+
+			ts::squaredNorm(
+				convolve(kernel, x, kernelDims[i], algorithm, &cache)
+			).grad();
+			benchList.reset();
+
+			double time = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start
+			).count();
+
+			if(run > 0 && time < bestTime) {
+				bestTime = time;
+				bestAlgorithm = algorithm;
+			}
+		}
+	}
+
+	return bestAlgorithm;
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::setConvAlgorithms(
+	std::vector<ts::ConvAlgorithm> algorithms
+) {
+	convAlgorithms = algorithms;
+	parametersUpdated();
+}
+
+
+
+template <typename T>
+std::vector<ts::ConvAlgorithm> ts::ConvolutionalNetwork<T>::getConvAlgorithms() {
+	return convAlgorithms;
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::parametersUpdated() {
+	winogradCaches.resize(convKernels.size());
+
+	for(unsigned i=0; i<convKernels.size(); i++) {
+		if(
+			i < convAlgorithms.size() &&
+			convAlgorithms[i] == ts::ConvAlgorithm::WINOGRAD &&
+			isEligible(kernelDims[i], convAlgorithms[i]) &&
+			kernelDims[i][6] != (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE
+		) {
+			winogradCaches[i].update(convKernels[i].getValue(), TS_WINOGRAD_OUTPUT_TILE);
+		} else {
+			winogradCaches[i].clear();
+		}
+	}
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::autotune(
+	std::string cachePath, std::vector<unsigned> inputDim
+) {
+	std::vector<std::vector<unsigned>> inputDims = layerInputDims(
+		inputDim.size() == 0 ? inputSize : inputDim
+	);
+	if(inputDims.size() != convKernels.size()) {
+		std::cout << "ERROR: Invalid input size for autotuning" << std::endl;
+		return;
+	}
+
+	// Cache file lines are "<key> <algorithm>"
+	std::map<std::string, int> cache;
+	if(cachePath != "") {
+		std::ifstream in(cachePath);
+		std::string key;
+		int algorithm;
+
+		while(in >> key >> algorithm) {
+			cache[key] = algorithm;
+		}
+	}
+
+	std::string signature = ts::cpuSignature();
+	bool updated = false;
+
+	convAlgorithms.resize(convKernels.size());
+
+	for(unsigned i=0; i<convKernels.size(); i++) {
+
+		// Depthwise separable layers only have one implementation
+		if(kernelDims[i][6] == (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE) {
+			convAlgorithms[i] = ts::ConvAlgorithm::IM2COL;
+			continue;
+		}
+
+		// Key : input size / input channels / kernel dims / type / CPU
+		std::string key = std::to_string(inputDims[i][0]) + "x" +
+		std::to_string(inputDims[i][1]) + "/" +
+		std::to_string(
+			convKernels[i].getValue().cols() / (kernelDims[i][0] * kernelDims[i][1])
+		);
+		for(unsigned d=0; d<kernelDims[i].size(); d++) {
+			key += (d == 0 ? "/" : "x") + std::to_string(kernelDims[i][d]);
+		}
+		key += "/" + std::string(sizeof(T) == sizeof(float) ? "f" : "d") +
+		"/" + signature;
+
+		std::map<std::string, int>::iterator entry = cache.find(key);
+		if(
+			entry != cache.end() && entry->second >= 0 &&
+			entry->second <= (int) ts::ConvAlgorithm::FFT
+		) {
+			convAlgorithms[i] = (ts::ConvAlgorithm) entry->second;
+			continue;
+		}
+
+		convAlgorithms[i] = benchmarkLayer(i, inputDims[i]);
+		cache[key] = (int) convAlgorithms[i];
+		updated = true;
+	}
+
+	parametersUpdated();
+
+	if(!updated || cachePath == "") {
+		return;
+	}
+
+	std::ofstream out(cachePath + ".tmp");
+	for(std::pair<const std::string, int> &entry : cache) {
+		out << entry.first << " " << entry.second << std::endl;
+	}
+	out.close();
+
+	if(!out || !ts::commitFile(cachePath + ".tmp", cachePath)) {
+		std::cout << "ERROR: Could not write autotuning cache " << cachePath
+		<< std::endl;
+	}
+}
+
+
+
+template <typename T>
+unsigned ts::ConvolutionalNetwork<T>::inputChannels(unsigned i) {
+	if(i != 0) {
+		return kernelDims[i-1][2];
+	}
+	return channelSplit == ChannelSplit::NOSPLIT ? 1 : nInputChannels;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::ConvolutionalNetwork<T>::packInput(const ts::Tensor<T> &input) {
+	// Horizontally split channels already are a packed map
+	if(channelSplit != ChannelSplit::SPLIT_VERT) {
+		return input;
+	}
+	return ts::vertCat(ts::split(input, channelSplit, nInputChannels));
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::ConvolutionalNetwork<T>::convolveLayer(
+	unsigned i, const std::vector<ts::Tensor<T>> &maps
+) {
+	ts::ConvAlgorithm algorithm = i < convAlgorithms.size() ?
+	convAlgorithms[i] : ts::ConvAlgorithm::IM2COL;
+
+	bool separable =
+	kernelDims[i][6] == (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE;
+
+	std::vector<ts::Tensor<T>> outputs = {};
+
+	// im2col reads the packed maps in place, and the patches of all maps are
+	// multiplied at once
+	if(algorithm == ts::ConvAlgorithm::IM2COL && !separable) {
+		for(unsigned k=0; k<maps.size(); k++) {
+			outputs.push_back(ts::im2col(
+				maps[k], inputChannels(i),
+				{kernelDims[i][0], kernelDims[i][1]},
+				{kernelDims[i][3], kernelDims[i][3]},
+				{kernelDims[i][4], kernelDims[i][4]},
+				{kernelDims[i][5], kernelDims[i][5]}
+			));
+		}
+		return normalizeLayer(i, ts::matProd(convKernels[i], ts::horCat(outputs)));
+	}
+
+	// Other algorithms work on channels vectors
+	for(unsigned k=0; k<maps.size(); k++) {
+		std::vector<ts::Tensor<T>> inputVec = {maps[k]};
+		if(inputChannels(i) > 1) {
+			inputVec = ts::split(maps[k], ChannelSplit::SPLIT_HOR, inputChannels(i));
+		}
+
+		if(separable) {
+			outputs.push_back(ts::depthwiseConv(
+				convKernels[i], inputVec,
+				{kernelDims[i][0], kernelDims[i][1]},
+				{kernelDims[i][3], kernelDims[i][3]},
+				{kernelDims[i][4], kernelDims[i][4]},
+				{kernelDims[i][5], kernelDims[i][5]}
+			));
+			continue;
+		}
+
+		// Compute the multichannel convolution (as a single matrix product)
+		outputs.push_back(convolve(
+			convKernels[i], inputVec, kernelDims[i], algorithm,
+			i < winogradCaches.size() ? &(winogradCaches[i]) : NULL
+		));
+	}
+
+	// The pointwise convolutions of all maps are a single matrix product too
+	if(separable) {
+		return normalizeLayer(i, ts::matProd(pointwiseKernels[i], ts::horCat(outputs)));
+	}
+	return normalizeLayer(i, ts::horCat(outputs));
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::ConvolutionalNetwork<T>::normalizeLayer(
+	unsigned i, const ts::Tensor<T> &conv
+) {
+	if(i >= convNorms.size()) {
+		return conv;
+	}
+	return convNorms[i].compute(conv, this->training);
+}
+
+
+
+template <typename T>
+std::vector<ts::Tensor<T>> ts::ConvolutionalNetwork<T>::activateLayer(
+	unsigned i, const ts::Tensor<T> &conv, unsigned nMaps
+) {
+	std::vector<ts::Tensor<T>> convs = {conv};
+	if(nMaps > 1) {
+		convs = ts::split(conv, ChannelSplit::SPLIT_VERT, nMaps);
+	}
+
+	// A pooling layer of size 0 means we want to skip it
+	std::vector<ts::Tensor<T>> maps = {};
+	for(unsigned k=0; k<nMaps; k++) {
+		maps.push_back(ts::convBlock(
+			convs[k], convBiases[i], outputDims[i], pooling[i], convActivation
+		));
+	}
+	return maps;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::ConvolutionalNetwork<T>::computeFrom(
+	std::vector<ts::Tensor<T>> maps, unsigned firstLayer
+) {
+
+	// 1) Convolution / pooling computation loop
+	for(unsigned i=firstLayer; i<convKernels.size(); i++) {
+		maps = activateLayer(i, convolveLayer(i, maps), maps.size());
+	}
+
+
+	// 2) Flatten (or pool) convolution outputs (all channels are already
+	// gathered in the packed maps), one column per map
+	std::vector<ts::Tensor<T>> inputs = {};
+	for(unsigned k=0; k<maps.size(); k++) {
+		inputs.push_back(globalPooling ?
+			ts::globalAveragePooling(maps[k], inputChannels(convKernels.size())) :
+			flattening(maps[k])
+		);
+	}
+	ts::Tensor<T> input = ts::horCat(inputs);
+
+
+	// 3) Dense layers computation loop
+	for(unsigned i=0; i<weights.size(); i++) {
+		ts::Tensor<T> z = matProd(weights[i], input);
+		if(i < denseNorms.size()) {
+			z = denseNorms[i].compute(z, this->training);
+		}
+
+		if(i < weights.size() - 1) {
+			input = (*denseActivation)(ts::broadcastAdd(z, fullBiases[i]));
+		}
+		// Final layer (we might want another activation function)
+		else {
+			input = (*finalActivation)(ts::broadcastAdd(z, fullBiases[i]));
+		}
+	}
+
+	return input;
+}
+
+
+
+template <typename T>
+ts::Tensor<T> ts::ConvolutionalNetwork<T>::compute(ts::Tensor<T> input) {
+
+	// NOTE It might be a good idea to add an entire function to make sure that
+	// all parameters are compatible (in terms of size), and that output is
+	// computable
+
+
+	// Convert input to packed maps (channels stacked vertically) for use with
+	// the im2col method. This should be a faster way to compute convolutions.
+
+	return computeFrom({packInput(input)}, 0);
+}
+
+
+
+template <typename T>
+std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>
+ts::ConvolutionalNetwork<T>::computeDense(
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> image,
+	std::vector<unsigned> windowDim,
+	std::vector<unsigned> strides
+) {
+
+	// The first layers are computed once on the whole image, as long as the
+	// feature maps of all windows are blocks of the image feature maps :
+	// - convolutions must not be padded, and windows offsets must be
+	// multiples of the cumulated strides / pooling sizes
+	// - convolution biases must be the same for all positions of a channel
+	// (since they are added before the activation)
+	// The remaining layers and the dense head are computed for each window on
+	// blocks of the last shared feature maps.
+
+	std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>> res = {};
+
+	long splitRows = channelSplit == ChannelSplit::SPLIT_HOR ? nInputChannels : 1;
+	long splitCols = channelSplit == ChannelSplit::SPLIT_VERT ? nInputChannels : 1;
+
+	if(
+		windowDim.size() != 2 || strides.size() != 2 ||
+		strides[0] == 0 || strides[1] == 0 ||
+		image.rows() < (long) windowDim[0] || image.cols() < (long) windowDim[1]
+	) {
+		std::cout << "ERROR: Invalid window or strides for dense prediction"
+		<< std::endl;
+		return res;
+	}
+
+	// Sizes of one channel
+	std::vector<long> imageDim = {image.rows() / splitRows, image.cols() / splitCols};
+	std::vector<long> channelDim = {windowDim[0] / splitRows, windowDim[1] / splitCols};
+
+	long nRows = (imageDim[0] - channelDim[0]) / strides[0] + 1;
+	long nCols = (imageDim[1] - channelDim[1]) / strides[1] + 1;
+
+
+	// 1) Shared layers
+
+	ts::Tensor<T> shared = packInput(ts::Tensor<T>(image, &(this->wList)));
+	long sharedChannels = inputChannels(0);
+
+	std::vector<long> sharedDim = imageDim;
+	std::vector<long> factor = {1, 1};	// Image pixels per shared maps element
+	unsigned nShared = 0;	// Layers entirely computed on the image
+
+	// Set if the convolution of layer nShared is shared, but not its
+	// activation
+	bool convShared = false;
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> sharedConv;
+
+	for(unsigned i=0; i<convKernels.size(); i++) {
+		std::vector<long> convFactor = {
+			factor[0] * kernelDims[i][3], factor[1] * kernelDims[i][3]
+		};
+
+		if(
+			kernelDims[i][4] != 0 ||
+			strides[0] % convFactor[0] != 0 || strides[1] % convFactor[1] != 0
+		) {
+			break;
+		}
+
+		ts::Tensor<T> conv = convolveLayer(i, {shared});
+		factor = convFactor;
+		for(unsigned d=0; d<2; d++) {
+			sharedDim[d] = ts::convOutputSize(
+				sharedDim[d], kernelDims[i][d],
+				kernelDims[i][3], kernelDims[i][4], kernelDims[i][5]
+			);
+		}
+
+		std::vector<unsigned> &pool = pooling[i];
+		bool pooled = pool[0] != 0 && pool[1] != 0;
+
+		// Overlapping or padded pools can't be computed on the whole maps
+		bool sharedPooling = !pooled || (
+			pool[3] == 0 &&
+			(pool[2] == 0 || (pool[2] == pool[0] && pool[2] == pool[1]))
+		);
+
+		std::vector<long> poolFactor = factor;
+		if(pooled) {
+			poolFactor = {factor[0] * pool[0], factor[1] * pool[1]};
+		}
+
+		const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &bias =
+		convBiases[i].getValue();
+		bool uniformBias = (bias.colwise() - bias.col(0)).abs().maxCoeff() == 0;
+
+		if(
+			!uniformBias || !sharedPooling ||
+			strides[0] % poolFactor[0] != 0 || strides[1] % poolFactor[1] != 0
+		) {
+			convShared = true;
+			sharedConv = conv.getValue();
+			break;
+		}
+
+		conv = (*convActivation)(conv + ts::Tensor<T>(
+			bias.col(0).replicate(1, conv.getValue().cols()), &(this->wList)
+		));
+		shared = ts::packedCol2im(
+			conv, {(unsigned) sharedDim[0], (unsigned) sharedDim[1]}
+		);
+		sharedChannels = conv.getValue().rows();
+
+		// Maps are cropped to multiples of the pooling size (the windows maps
+		// always are)
+		if(pooled) {
+			long croppedRows = sharedDim[0] / pool[0] * pool[0];
+			long croppedCols = sharedDim[1] / pool[1] * pool[1];
+
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> cropped;
+			cropped.resize(sharedChannels * croppedRows, croppedCols);
+			for(long j=0; j<sharedChannels; j++) {
+				cropped.middleRows(j * croppedRows, croppedRows) =
+				shared.getValue().block(j * sharedDim[0], 0, croppedRows, croppedCols);
+			}
+
+			shared = pool[4] == (unsigned) ts::PoolingType::AVERAGE ?
+			ts::averagePooling(
+				ts::Tensor<T>(cropped, &(this->wList)), {pool[0], pool[1]}, {},
+				{0, 0}, sharedChannels
+			) :
+			ts::maxPooling(
+				ts::Tensor<T>(cropped, &(this->wList)), {pool[0], pool[1]}, {},
+				{0, 0}, sharedChannels
+			);
+
+			sharedDim[0] = croppedRows / pool[0];
+			sharedDim[1] = croppedCols / pool[1];
+		}
+
+		factor = poolFactor;
+		nShared++;
+	}
+
+	// Only the values of the shared maps are needed from now on
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> sharedMaps = shared.getValue();
+	shared = ts::Tensor<T>();
+	this->wList.reset();
+
+	// Size of the blocks of shared maps corresponding to one window
+	std::vector<long> blockDim = channelDim;
+	if(convShared) {
+		blockDim = {outputDims[nShared][0], outputDims[nShared][1]};
+	}
+	else if(nShared > 0) {
+		std::vector<unsigned> pooledDim = poolingOutputDim(
+			pooling[nShared-1], outputDims[nShared-1]
+		);
+		blockDim = {pooledDim[0], pooledDim[1]};
+	}
+
+
+	// 2) Remaining layers for each window
+
+	for(long i=0; i<nRows; i++) {
+		for(long j=0; j<nCols; j++) {
+			long x = i * strides[0] / factor[0];
+			long y = j * strides[1] / factor[1];
+
+			ts::Tensor<T> output;
+
+			if(convShared) {
+				// Convolution outputs are flattened in row-major order
+				Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> block;
+				block.resize(sharedConv.rows(), blockDim[0] * blockDim[1]);
+				for(long r=0; r<blockDim[0]; r++) {
+					block.middleCols(r * blockDim[1], blockDim[1]) =
+					sharedConv.middleCols((x + r) * sharedDim[1] + y, blockDim[1]);
+				}
+
+				output = computeFrom(
+					activateLayer(nShared, ts::Tensor<T>(block, &(this->wList)), 1),
+					nShared + 1
+				);
+			}
+
+			else {
+				Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> block;
+				block.resize(sharedChannels * blockDim[0], blockDim[1]);
+				for(long k=0; k<sharedChannels; k++) {
+					block.middleRows(k * blockDim[0], blockDim[0]) =
+					sharedMaps.block(k * sharedDim[0] + x, y, blockDim[0], blockDim[1]);
+				}
+
+				output = computeFrom({ts::Tensor<T>(block, &(this->wList))}, nShared);
+			}
+
+			if(res.size() == 0) {
+				res = std::vector<Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>>(
+					output.getValue().rows(),
+					Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>(nRows, nCols)
+				);
+			}
+			for(unsigned k=0; k<res.size(); k++) {
+				res[k](i, j) = output.getValue()(k, 0);
+			}
+
+			this->wList.reset();
+		}
+	}
+
+	return res;
+}
+
+
+
+template <typename T>
+Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>
+ts::ConvolutionalNetwork<T>::computeBatch(
+	const Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &image,
+	std::vector<unsigned> windowDim,
+	std::vector<std::vector<unsigned>> regions
+) {
+
+	// Regions go through the same layers as compute(), TS_BATCH_SIZE at a
+	// time : their convolutions (for im2col layers) and dense layers are
+	// computed as single matrix products on the whole batch.
+
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> res;
+
+	long splitRows = channelSplit == ChannelSplit::SPLIT_HOR ? nInputChannels : 1;
+	long splitCols = channelSplit == ChannelSplit::SPLIT_VERT ? nInputChannels : 1;
+
+	if(windowDim.size() != 2) {
+		std::cout << "ERROR: Invalid window for batched prediction" << std::endl;
+		return res;
+	}
+
+	// Sizes of one channel
+	std::vector<long> imageDim = {image.rows() / splitRows, image.cols() / splitCols};
+	std::vector<long> channelDim = {windowDim[0] / splitRows, windowDim[1] / splitCols};
+
+	for(unsigned k=0; k<regions.size(); k++) {
+		if(
+			regions[k].size() != 2 ||
+			regions[k][0] + channelDim[0] > imageDim[0] ||
+			regions[k][1] + channelDim[1] > imageDim[1]
+		) {
+			std::cout << "ERROR: Region " << k << " is outside of the image"
+			<< std::endl;
+			return res;
+		}
+	}
+
+	for(long begin=0; begin<(long) regions.size(); begin+=TS_BATCH_SIZE) {
+		long n = std::min((long) TS_BATCH_SIZE, (long) regions.size() - begin);
+
+		// Input of each region, with its channels split like the image ones
+		std::vector<ts::Tensor<T>> maps = {};
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> window(windowDim[0], windowDim[1]);
+
+		for(long k=0; k<n; k++) {
+			for(long r=0; r<splitRows; r++) {
+				for(long c=0; c<splitCols; c++) {
+					window.block(
+						r * channelDim[0], c * channelDim[1], channelDim[0], channelDim[1]
+					) = image.block(
+						r * imageDim[0] + regions[begin + k][0],
+						c * imageDim[1] + regions[begin + k][1],
+						channelDim[0], channelDim[1]
+					);
+				}
+			}
+			maps.push_back(packInput(ts::Tensor<T>(window, &(this->wList))));
+		}
+
+		ts::Tensor<T> output = computeFrom(maps, 0);
+
+		if(res.size() == 0) {
+			res.resize(output.getValue().rows(), regions.size());
+		}
+		res.middleCols(begin, n) = output.getValue();
+
+		this->wList.reset();
+	}
+
+	return res;
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::save(std::string filePath) {
 	std::ofstream out(filePath);
 
 	out << static_cast<std::underlying_type<ts::ChannelSplit>::type>(channelSplit) << std::endl;
@@ -590,6 +1862,16 @@ void ts::ConvolutionalNetwork<T>::save(std::string filePath) {
 	out << ts::serializeTensorsVector(weights);
 	out << ts::serializeTensorsVector(fullBiases);
 
+	out << ts::serializeTensorsVector(pointwiseKernels);
+
+	out << globalPooling << std::endl;
+
+	out << ts::BatchNormLayer<T>::serialize(convNorms);
+	out << ts::BatchNormLayer<T>::serialize(denseNorms);
+
+	std::vector<std::vector<unsigned>> inputSize_ = {inputSize};
+	out << ts::serializeUnsignedVec2D(inputSize_);
+
 	out.close();
 }
 
@@ -597,12 +1879,15 @@ void ts::ConvolutionalNetwork<T>::save(std::string filePath) {
 
 template <typename T>
 void ts::ConvolutionalNetwork<T>::load(std::string filePath) {
-	// Delete current model, reset wList
+	// Delete current model, clear wList
 	convKernels = {};
 	convBiases = {};
 	weights = {};
 	fullBiases = {};
-	this->wList.reset();
+	pointwiseKernels = {};
+	convNorms = {};
+	denseNorms = {};
+	this->wList.clear();
 
 	pooling = {};
 	kernelDims = {};
@@ -610,24 +1895,175 @@ void ts::ConvolutionalNetwork<T>::load(std::string filePath) {
 
 
 	// Load new model
-	std::string line;
 	std::ifstream in(filePath);
 
-	std::getline(in, line);
-	channelSplit = static_cast<ts::ChannelSplit>(std::stoi(line));
+	unsigned channelSplit_ = 0;
+	ts::readNumber(in.rdbuf(), channelSplit_);
+	channelSplit = static_cast<ts::ChannelSplit>(channelSplit_);
 
-	std::getline(in, line);
-	nInputChannels = std::stoi(line);
+	ts::readNumber(in.rdbuf(), nInputChannels);
 
 	pooling = ts::parseUnsignedVec2D(in);
 	kernelDims = ts::parseUnsignedVec2D(in);
 	outputDims = ts::parseUnsignedVec2D(in);
 
-	convKernels = ts::parseTensorsVector(in, &(this->wList));
-	convBiases = ts::parseTensorsVector(in, &(this->wList));
+	for(unsigned i=0; i<kernelDims.size(); i++) {
+		normalizeConvLayer(kernelDims[i]);
+	}
+	for(unsigned i=0; i<pooling.size(); i++) {
+		normalizePoolingLayer(pooling[i]);
+	}
+
+	convKernels = ts::parseTensorsVector(in, &(this->wList), true);
+	convBiases = ts::parseTensorsVector(in, &(this->wList), true);
+
+	weights = ts::parseTensorsVector(in, &(this->wList), true);
+	fullBiases = ts::parseTensorsVector(in, &(this->wList), true);
+
+	// Older models don't have pointwise kernels (standard layers only)
+	std::vector<ts::Tensor<T>> pointwise = ts::parseTensorsVector<T>(in, NULL, true);
+	for(unsigned i=0; i<convKernels.size(); i++) {
+		addPointwiseKernel(
+			i < pointwise.size() ?
+			pointwise[i].getValue() : Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
+		);
+	}
+
+	// Nor the global pooling flag
+	unsigned globalPooling_ = 0;
+	ts::readNumber(in.rdbuf(), globalPooling_);
+	globalPooling = globalPooling_ != 0;
 
-	weights = ts::parseTensorsVector(in, &(this->wList));
-	fullBiases = ts::parseTensorsVector(in, &(this->wList));
+	// Nor batch normalization
+	convNorms = ts::BatchNormLayer<T>::parse(in, &(this->wList));
+	denseNorms = ts::BatchNormLayer<T>::parse(in, &(this->wList));
+
+	// Nor the input size
+	std::vector<std::vector<unsigned>> inputSize_ = ts::parseUnsignedVec2D(in);
+	inputSize = inputSize_.size() == 1 && inputSize_[0].size() == 2 ?
+	inputSize_[0] : guessInputSize();
 
 	in.close();
+
+	parametersUpdated();
 }
+
+
+
+template <typename T>
+ts::ModelSnapshot<T> ts::ConvolutionalNetwork<T>::snapshot() {
+	// Metadata contains the same architecture fields as the text format
+
+	ts::ModelSnapshot<T> modelSnapshot;
+
+	modelSnapshot.metadata.push_back(
+		static_cast<std::underlying_type<ts::ChannelSplit>::type>(channelSplit)
+	);
+	modelSnapshot.metadata.push_back(nInputChannels);
+
+	ts::flattenUnsignedVec2D(pooling, modelSnapshot.metadata);
+	ts::flattenUnsignedVec2D(kernelDims, modelSnapshot.metadata);
+	ts::flattenUnsignedVec2D(outputDims, modelSnapshot.metadata);
+	modelSnapshot.metadata.push_back(globalPooling);
+
+	std::vector<std::vector<unsigned>> inputSize_ = {inputSize};
+	ts::flattenUnsignedVec2D(inputSize_, modelSnapshot.metadata);
+
+	std::vector<std::vector<ts::Tensor<T>> *> tensors = {
+		&convKernels, &convBiases, &weights, &fullBiases, &pointwiseKernels
+	};
+
+	for(unsigned i=0; i<tensors.size(); i++) {
+		modelSnapshot.groups.push_back({});
+		for(unsigned j=0; j<tensors[i]->size(); j++) {
+			modelSnapshot.groups[i].push_back((*tensors[i])[j].getValue());
+		}
+	}
+
+	modelSnapshot.groups.push_back(ts::BatchNormLayer<T>::flatten(convNorms));
+	modelSnapshot.groups.push_back(ts::BatchNormLayer<T>::flatten(denseNorms));
+
+	return modelSnapshot;
+}
+
+
+
+template <typename T>
+void ts::ConvolutionalNetwork<T>::restore(ts::ModelSnapshot<T> &snapshot) {
+	// Older snapshots don't have the pointwise kernels and batch normalization
+	// groups
+	if(
+		snapshot.groups.size() < 4 || snapshot.groups.size() > 7 ||
+		snapshot.metadata.size() < 2
+	) {
+		std::cout << "ERROR: Snapshot is not a CNN" << std::endl;
+		return;
+	}
+
+	// Delete current model, clear wList
+	convKernels = {};
+	convBiases = {};
+	weights = {};
+	fullBiases = {};
+	pointwiseKernels = {};
+	convNorms = {};
+	denseNorms = {};
+	this->wList.clear();
+
+
+	// Load new model
+
+	channelSplit = static_cast<ts::ChannelSplit>(snapshot.metadata[0]);
+	nInputChannels = snapshot.metadata[1];
+
+	unsigned position = 2;
+	pooling = ts::unflattenUnsignedVec2D(snapshot.metadata, position);
+	kernelDims = ts::unflattenUnsignedVec2D(snapshot.metadata, position);
+	outputDims = ts::unflattenUnsignedVec2D(snapshot.metadata, position);
+
+	// Older snapshots don't have the global pooling flag, nor the input size
+	globalPooling = position < snapshot.metadata.size() &&
+	snapshot.metadata[position] != 0;
+	position++;
+
+	std::vector<std::vector<unsigned>> inputSize_ =
+	ts::unflattenUnsignedVec2D(snapshot.metadata, position);
+
+	for(unsigned i=0; i<kernelDims.size(); i++) {
+		normalizeConvLayer(kernelDims[i]);
+	}
+	for(unsigned i=0; i<pooling.size(); i++) {
+		normalizePoolingLayer(pooling[i]);
+	}
+
+	inputSize = inputSize_.size() == 1 && inputSize_[0].size() == 2 ?
+	inputSize_[0] : guessInputSize();
+
+	std::vector<std::vector<ts::Tensor<T>> *> tensors = {
+		&convKernels, &convBiases, &weights, &fullBiases
+	};
+
+	for(unsigned i=0; i<tensors.size(); i++) {
+		for(unsigned j=0; j<snapshot.groups[i].size(); j++) {
+			tensors[i]->push_back(
+				ts::Tensor<T>(std::move(snapshot.groups[i][j]), &(this->wList), true)
+			);
+		}
+	}
+
+	// Older snapshots don't have pointwise kernels (standard layers only)
+	for(unsigned i=0; i<convKernels.size(); i++) {
+		addPointwiseKernel(
+			snapshot.groups.size() > 4 && i < snapshot.groups[4].size() ?
+			std::move(snapshot.groups[4][i]) :
+			Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic>()
+		);
+	}
+
+	if(snapshot.groups.size() > 6) {
+		convNorms = ts::BatchNormLayer<T>::unflatten(snapshot.groups[5], &(this->wList));
+		denseNorms = ts::BatchNormLayer<T>::unflatten(snapshot.groups[6], &(this->wList));
+	}
+
+	parametersUpdated();
+}
\ No newline at end of file
@@ -20,6 +20,18 @@ ts::TrainingData<T>::TrainingData(
 
 
 
+template <typename T>
+ts::TrainingData<T>::TrainingData(
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> newInput,
+		unsigned newLabel
+) {
+	input = newInput;
+	labeled = true;
+	label = newLabel;
+}
+
+
+
 	// ts::GaElement
 
 template <typename T>
@@ -92,7 +104,13 @@ void ts::GradientAccumulator<T>::increment(ts::Gradient<T> &gradient) {
 	for(unsigned i=0; i<elements.size(); i++) {
 		// We use two different indices systems here
 		// (one for the wList/grad and one for the gradient accumulator)
-		elements[i].gradSum += gradient.derivatives[elements[i].index];
+		Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &gradSum =
+		elements[i].gradSum;
+
+		ts::addKernel(
+			gradSum.data(), gradient.derivatives[elements[i].index].data(),
+			gradSum.size(), gradSum.data()
+		);
 	}
 }
 
@@ -100,14 +118,19 @@ void ts::GradientAccumulator<T>::increment(ts::Gradient<T> &gradient) {
 
 template <typename T>
 void ts::GradientAccumulator<T>::updateTensor(
-	ts::Model<T> &model, unsigned i,
-	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> value
+	ts::Model<T> &model, unsigned i, T rate
 ) {
 	// Update a tensor via the gradient accumulator
+	// (value -= rate * gradSum)
 	std::shared_ptr<ts::InputNode<T>> inputPtr =
 	std::static_pointer_cast<ts::InputNode<T>>(model.wList.nodes[i]);
 
-	inputPtr->optimizedTensor->value -= value;
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> &value =
+	inputPtr->optimizedTensor->value;
+
+	ts::stepKernel(
+		elements[i].gradSum.data(), value.size(), rate, value.data()
+	);
 }
 
 
@@ -128,43 +151,122 @@ ts::Optimizer<T>::Optimizer() {
 
 
 
-	// ts::GradientDescentOptimizer
+template <typename T>
+void ts::Optimizer<T>::processGradient(ts::Gradient<T> &gradient) {
+}
+
+
 
 template <typename T>
-ts::GradientDescentOptimizer<T>::GradientDescentOptimizer(T newLearningRate) {
-	learningRate = newLearningRate;
+void ts::Optimizer<T>::startSession(ts::Model<T> &model) {
+
+	// Close previous session if needed
+	if(sessionModel != NULL) {
+		endSession();
+	}
+
+	// Set up gradient accumulator (this also resets wList)
+	gradAccumulator = ts::GradientAccumulator<T>(model);
+	sessionModel = &model;
+	sessionModel->training = true;
+	nSteps = 0;
 }
 
 
 
 template <typename T>
-void ts::GradientDescentOptimizer<T>::updateModel(
-	ts::Model<T> &model, unsigned batchSize
+void ts::Optimizer<T>::endSession() {
+	if(sessionModel == NULL) {
+		return;
+	}
+
+	gradAccumulator.clear();
+	sessionModel->wList.reset();
+	sessionModel->training = false;
+	sessionModel = NULL;
+
+	// Make sure the last checkpoint is on disk before returning
+	checkpointWriter.wait();
+}
+
+
+
+template <typename T>
+std::vector<T> ts::Optimizer<T>::step(
+	std::vector< ts::TrainingData<T> > &batch
 ) {
-	// #pragma omp parallel for
-	for(unsigned i=0; i<this->gradAccumulator.elements.size(); i++) {
-		this->gradAccumulator.updateTensor(
-			model, i,
-			learningRate * this->gradAccumulator.elements[i].gradSum / batchSize
+	// Runs the model on one batch of data, and updates it with the
+	// accumulated gradient. No setup work is done here, so this can be called
+	// repeatedly on incoming batches.
+
+	if(sessionModel == NULL) {
+		std::cout << "ERROR: Optimizer step outside of a training session"
+		<< std::endl;
+		return {};
+	}
+
+	if(batch.size() == 0) {
+		return {};
+	}
+
+	ts::Model<T> &model = *sessionModel;
+	std::vector<T> losses(batch.size(), 0);
+
+	// Data instance
+	for(unsigned k=0; k<batch.size(); k++) {
+
+		ts::Tensor<T> input = ts::Tensor<T>(
+			batch[k].input, &(model.wList)
 		);
+
+		// Compute model and norm
+		ts::Tensor<T> output = model.compute(input);
+		ts::Tensor<T> norm;
+
+		if(batch[k].labeled) {
+			norm = ts::softmaxCrossEntropy(output, {batch[k].label});
+		} else {
+			ts::Tensor<T> expected = ts::Tensor<T>(
+				batch[k].expected, &(model.wList)
+			);
+			norm = (*normFunction)(output - expected);
+		}
+
+		// Get & process gradient, then increment gradient accumulator
+		ts::Gradient<T> gradient = norm.grad();
+		processGradient(gradient);
+		gradAccumulator.increment(gradient);
+
+		model.wList.reset();
+
+		losses[k] = norm.getValue()(0, 0);
 	}
+
+	updateModel(model, batch.size());
+	model.parametersUpdated();
+	gradAccumulator.reset();
+
+	nSteps++;
+	if(checkpointEvery != 0 && nSteps % checkpointEvery == 0) {
+		checkpointWriter.write(model, checkpointPath);
+	}
+
+	return losses;
 }
 
 
 
 template <typename T>
-std::vector<std::vector<std::vector< T >>> ts::GradientDescentOptimizer<T>::run(
+std::vector<std::vector<std::vector< T >>> ts::Optimizer<T>::run(
 	ts::Model<T> &model, std::vector<std::vector< ts::TrainingData<T> >> &batches
 ) {
 
-		// Set up gradient accumulator (this also resets wList)
-
-	this->gradAccumulator = ts::GradientAccumulator<T>(model);
+	startSession(model);
 
 
 		// Start running and training the model
 
-		std::vector<std::vector<std::vector< T >>> losses(this->epochs, (std::vector<std::vector<T>>) {});
+	std::vector<std::vector<std::vector< T >>> losses(this->epochs, (std::vector<std::vector<T>>) {});
 
 	// Epochs
 	for(unsigned i=0; i<this->epochs; i++) {
@@ -175,47 +277,42 @@ std::vector<std::vector<std::vector< T >>> ts::GradientDescentOptimizer<T>::run(
 
 		// Batches
 		for(unsigned j=0; j<batches.size(); j++) {
+			losses[i][j] = step(batches[j]);
 
-			losses[i][j] = std::vector<T>(batches[j].size(), 0);
-
-			// Data instance
-			for(unsigned k=0; k<batches[j].size(); k++) {
+			ts::progressBar(j + 1, batches.size());
+		}
+		std::cout << std::endl << std::endl;
+	}
 
-				ts::Tensor<T> input = ts::Tensor<T>(
-					batches[j][k].input, &(model.wList)
-				);
-				ts::Tensor<T> expected = ts::Tensor<T>(
-					batches[j][k].expected, &(model.wList)
-				);
 
-				// Compute model and norm
-				ts::Tensor<T> output = model.compute(input);
-				ts::Tensor<T> norm = (*this->normFunction)(output - expected);
+		// Clean
 
-				// Get gradient and increment gradient accumulator
-				ts::Gradient<T> gradient = norm.grad();
-				this->gradAccumulator.increment(gradient);
+	endSession();
 
-				model.wList.reset();
+	return losses;
+}
 
-				losses[i][j][k] = norm.getValue()(0, 0);
-			}
 
-			updateModel(model, batches[j].size());
-			this->gradAccumulator.reset();
 
-			ts::progressBar(j + 1, batches.size());
-		}
-		std::cout << std::endl << std::endl;
-	}
+	// ts::GradientDescentOptimizer
 
+template <typename T>
+ts::GradientDescentOptimizer<T>::GradientDescentOptimizer(T newLearningRate) {
+	learningRate = newLearningRate;
+}
 
-		// Clean
 
-	this->gradAccumulator.clear();
-	model.wList.reset();
 
-	return losses;
+template <typename T>
+void ts::GradientDescentOptimizer<T>::updateModel(
+	ts::Model<T> &model, unsigned batchSize
+) {
+	// #pragma omp parallel for
+	for(unsigned i=0; i<this->gradAccumulator.elements.size(); i++) {
+		this->gradAccumulator.updateTensor(
+			model, i, learningRate / batchSize
+		);
+	}
 }
 
 
@@ -243,10 +340,13 @@ void ts::AdamOptimizer<T>::updateModel(
 	// #pragma omp parallel for
 	for(unsigned i=0; i<this->gradAccumulator.elements.size(); i++) {
 		this->gradAccumulator.updateTensor(
-			model, i,
-			alpha * this->gradAccumulator.elements[i].gradSum / batchSize
+			model, i, alpha / batchSize
 		);
 	}
+
+	// Decay betas
+	decayedBeta1 = decayedBeta1 * beta1;
+	decayedBeta2 = decayedBeta2 * beta2;
 }
 
 
@@ -264,9 +364,6 @@ void ts::AdamOptimizer<T>::initMomentEstimates(
 		tmp.setZero(nodes[i]->rows, nodes[i]->cols);
 		m.push_back(tmp);
 		v.push_back(tmp);
-
-		mHat.push_back(Eigen::Array<T, 0, 0>());
-		vHat.push_back(Eigen::Array<T, 0, 0>());
 	}
 }
 
@@ -287,29 +384,34 @@ void ts::AdamOptimizer<T>::computeIncrement(
 		// Get index in the gradAccumulator system
 		iGrad = elements[iAcc].index;
 
-		// Compute biased moment estimates
-		m[iAcc] = beta1 * m[iAcc] + (1-beta1) * derivatives[iGrad];
-		v[iAcc] = beta2 * v[iAcc] + (1-beta2) * derivatives[iGrad] * derivatives[iGrad];
+		// Update the moment estimates, and replace gradient with its
+		// bias-corrected value (since gradient is used in the gradAccumulator
+		// increment method)
+		ts::adamKernel(
+			derivatives[iGrad].data(), derivatives[iGrad].size(),
+			beta1, beta2, 1 - decayedBeta1, 1 - decayedBeta2, epsilon,
+			m[iAcc].data(), v[iAcc].data()
+		);
+	}
+}
 
-		// Compute bias-corrected moment estimates
-		mHat[iAcc] = m[iAcc] / (1 - decayedBeta1);
-		vHat[iAcc] = v[iAcc] / (1 - decayedBeta2);
 
-		// Replace gradient with its corrected value
-		// (since gradient is used in the gradAccumulator increment method)
-		derivatives[iGrad] = mHat[iAcc] / (vHat[iAcc].sqrt() + epsilon);
-	}
+
+template <typename T>
+void ts::AdamOptimizer<T>::processGradient(ts::Gradient<T> &gradient) {
+	computeIncrement(
+		gradient.derivatives,
+		this->gradAccumulator.elements
+	);
 }
 
 
 
 template <typename T>
-std::vector<std::vector<std::vector< T >>> ts::AdamOptimizer<T>::run(
-	ts::Model<T> &model, std::vector<std::vector< ts::TrainingData<T> >> &batches
-) {
+void ts::AdamOptimizer<T>::startSession(ts::Model<T> &model) {
 
-		// Set up gradient accumulator (this also resets wList)
-	this->gradAccumulator = ts::GradientAccumulator<T>(model);
+	// Set up gradient accumulator (this also resets wList)
+	ts::Optimizer<T>::startSession(model);
 
 
 		//Init parameters
@@ -317,74 +419,14 @@ std::vector<std::vector<std::vector< T >>> ts::AdamOptimizer<T>::run(
 	initMomentEstimates(model.wList.nodes);
 	decayedBeta1 = beta1;
 	decayedBeta2 = beta2;
+}
 
 
-		// Start running and training the model
-
-		std::vector<std::vector<std::vector< T >>> losses(this->epochs, (std::vector<std::vector<T>>) {});
-
-	// Epochs
-	for(unsigned i=0; i<this->epochs; i++) {
-
-		std::cout << "Epoch " << i + 1 << "/" <<  this->epochs << ": " << std::endl;
-
-		losses[i] = std::vector<std::vector<T>>(batches.size(), (std::vector<T>) {});
-
-		// Batches
-		for(unsigned j=0; j<batches.size(); j++) {
-
-			losses[i][j] = std::vector<T>(batches[j].size(), 0);
-
-			// Data instance
-			for(unsigned k=0; k<batches[j].size(); k++) {
-
-				ts::Tensor<T> input = ts::Tensor<T>(
-					batches[j][k].input, &(model.wList)
-				);
-				ts::Tensor<T> expected = ts::Tensor<T>(
-					batches[j][k].expected, &(model.wList)
-				);
-
-				// Compute model and norm
-				ts::Tensor<T> output = model.compute(input);
-				ts::Tensor<T> norm = (*this->normFunction)(output - expected);
-
-				// Get & correct gradient, then increment gradient accumulator
-				ts::Gradient<T> gradient = norm.grad();
-				computeIncrement(
-					gradient.derivatives,
-					this->gradAccumulator.elements
-				);
-				this->gradAccumulator.increment(gradient);
-
-				model.wList.reset();
-
-				losses[i][j][k] = norm.getValue()(0, 0);
-			}
-
-			updateModel(model, batches[j].size());
-			this->gradAccumulator.reset();
-
-			// Decay betas
-			decayedBeta1 = decayedBeta1 * beta1;
-			decayedBeta2 = decayedBeta2 * beta2;
-
-			ts::progressBar(j + 1, batches.size());
-		}
-		std::cout << std::endl << std::endl;
-	}
-
-
-		// Clean
 
-	this->gradAccumulator.clear();
-	model.wList.reset();
+template <typename T>
+void ts::AdamOptimizer<T>::endSession() {
+	ts::Optimizer<T>::endSession();
 
 	m = {};
 	v = {};
-	mHat = {};
-	vHat = {};
-
-
-	return losses;
 }
@@ -5,6 +5,11 @@
 
 #include "../include/serializer.hpp"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 
 
 // Serializes a ts::Tensor in a string.
@@ -12,75 +17,50 @@
 // *ROWS*
 // *COLS*
 // *VAL*,*VAL*, *VAL*, ..., *VAL*
+// Values are written in row-major order, in their shortest form that can be
+// parsed back exactly.
 template <typename T>
 std::string ts::serializeTensor(ts::Tensor<T> &tensor) {
 
-	// Save array to string
-	std::ostringstream stringStream;
-	stringStream << tensor.getValue() << std::endl;
+	Eigen::Array<T, Eigen::Dynamic, Eigen::Dynamic> array = tensor.getValue();
 
-	std::string arrayString =  stringStream.str();
+	std::string out = std::to_string(array.rows()) + "\n";
+	out += std::to_string(array.cols()) + "\n";
 
+	// Most values fit in ~12 chars (float) or ~24 chars (double)
+	out.reserve(out.size() + array.size() * (4 + std::numeric_limits<T>::max_digits10));
 
-	// Because some extra spaces can be added by Eigen, we remove consecutive
-	// spaces/linebreaks
-	for(int i=arrayString.size()-2; i>=0; i--) {
-		if(
-			(arrayString[i] == ' ' || arrayString[i] == '\n') &&
-			(arrayString[i+1] == ' ' || arrayString[i+1] == '\n')
-		) {
-			arrayString.erase(i, 1);
+	for(unsigned i=0; i<array.rows(); i++) {
+		for(unsigned j=0; j<array.cols(); j++) {
+			if(i != 0 || j != 0) {
+				out += ',';
+			}
+			ts::writeNumber(out, array(i, j));
 		}
 	}
 
-	// We might have a trailing space remaining at index 0 ...
-	if(arrayString[0] == ' ') {
-		arrayString.erase(0, 1);
-	}
-
-	// ... as well as a \n at last position
-	if(arrayString[arrayString.size()-1] == '\n') {
-		arrayString.erase(arrayString.size()-1, 1);
-	}
-
-
-	// Finally, remove spaces and linebreaks
-	std::replace(arrayString.begin(), arrayString.end(), ' ', ',');
-	std::replace(arrayString.begin(), arrayString.end(), '\n', ',');
-
-
-	// Create out stream, return it as string
-	std::ostringstream outStream;
-
-	outStream << tensor.getValue().rows() << std::endl;
-	outStream << tensor.getValue().cols() << std::endl;
-	outStream << arrayString;
-
-	return outStream.str();
+	return out;
 }
 
 
 
 // Reads an ifstream starting at a serialized tensor, and parses it to a
 // ts::Tensor
+// Values are read directly from the stream buffer into the array (see
+// ts::readNumber).
 template <typename T>
 ts::Tensor<T> ts::parseTensor(
-	std::ifstream &in, ts::WengertList<T> * wList
+	std::ifstream &in, ts::WengertList<T> * wList, bool model
 ) {
 
-	std::string line;
+	std::streambuf * buffer = in.rdbuf();
 
-	// Get rows
-	std::getline(in, line);
-	unsigned rows = std::stoi(line);
-
-	// Get cols
-	std::getline(in, line);
-	unsigned cols = std::stoi(line);
-
-	// Get elements vector
-	std::getline(in, line);
-	std::vector<std::string> stringElements = ts::split(line, ',');
+	// Get rows & cols
+	unsigned rows = 0, cols = 0;
+	if(!ts::readNumber(buffer, rows) || !ts::readNumber(buffer, cols)) {
+		std::cout << "ERROR: Could not parse tensor dimensions" << std::endl;
+		return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+	}
 
 
 	// Initialize Eigen::Array
@@ -89,12 +69,15 @@ ts::Tensor<T> ts::parseTensor(
 
 	for(unsigned i=0; i<rows; i++) {
 		for(unsigned j=0; j<cols; j++) {
-			array(i, j) = std::stof(stringElements[i * cols + j]);
+			if(!ts::readNumber(buffer, array(i, j))) {
+				std::cout << "ERROR: Could not parse tensor element" << std::endl;
+				return ts::Tensor<T>(Eigen::Array<T, 0, 0>(), NULL);
+			}
 		}
 	}
 
 
-	return ts::Tensor<T>(array, wList);
+	return ts::Tensor<T>(std::move(array), wList, model);
 }
 
 
@@ -128,19 +111,353 @@ std::string ts::serializeTensorsVector(
 // a std::vector<ts::Tensor>
 template <typename T>
 std::vector<ts::Tensor<T>> ts::parseTensorsVector(
-	std::ifstream &in, ts::WengertList<T> * wList
+	std::ifstream &in, ts::WengertList<T> * wList, bool model
 ) {
 	std::vector<ts::Tensor<T>> vector = {};
 
-	std::string line;
-
-	// Get tensor size
-	std::getline(in, line);
-	unsigned size = std::stoi(line);
+	// Get tensor size (a missing vector, eg at the end of the file, is
+	// considered empty)
+	unsigned size = 0;
+	if(!ts::readNumber(in.rdbuf(), size)) {
+		return vector;
+	}
 
+	vector.reserve(size);
 	for(unsigned i=0; i<size; i++) {
-		vector.push_back(ts::parseTensor(in, wList));
+		vector.push_back(ts::parseTensor(in, wList, model));
 	}
 
 	return vector;
 }
+
+
+
+// Binary model files
+// All integers are stored as little-endian uint32 / uint64 and tensors
+// values as raw col-major arrays. The file has the following layout :
+// *HEADER (64 bytes)* : magic (8), version (4), data type size (4),
+//	metadata size (4), number of groups (4), number of tensors (4),
+//	alignment (4), file size (8), checksum (8), zero padding
+// *METADATA* : uint32 values
+// *GROUPS TABLE* : uint32 number of tensors in each group
+// *TENSORS TABLE* : (rows, cols, offset) uint64 triplets for each tensor
+// *DATA* : tensor values, each tensor starting at an aligned offset
+// The checksum is computed on everything following the header, chunk by chunk
+// (tables, then padding and values of each tensor).
+
+template <typename T>
+bool ts::writeBinarySnapshot(
+	std::string filePath, ts::ModelSnapshot<T> &snapshot
+) {
+
+	// Compute tables and layout
+
+	std::vector<uint32_t> groupsTable = {};
+	std::vector<uint64_t> tensorsTable = {};
+
+	uint64_t offset = TS_BINARY_HEADER_SIZE
+	+ snapshot.metadata.size() * sizeof(uint32_t)
+	+ snapshot.groups.size() * sizeof(uint32_t);
+
+	unsigned nTensors = 0;
+	for(unsigned i=0; i<snapshot.groups.size(); i++) {
+		nTensors += snapshot.groups[i].size();
+	}
+	offset += 3 * nTensors * sizeof(uint64_t);
+
+	for(unsigned i=0; i<snapshot.groups.size(); i++) {
+		groupsTable.push_back(snapshot.groups[i].size());
+
+		for(unsigned j=0; j<snapshot.groups[i].size(); j++) {
+			offset = (offset + TS_BINARY_ALIGNMENT - 1)
+			/ TS_BINARY_ALIGNMENT * TS_BINARY_ALIGNMENT;
+
+			tensorsTable.push_back(snapshot.groups[i][j].rows());
+			tensorsTable.push_back(snapshot.groups[i][j].cols());
+			tensorsTable.push_back(offset);
+
+			offset += snapshot.groups[i][j].size() * sizeof(T);
+		}
+	}
+
+	uint64_t fileSize = offset;
+
+
+	// Write everything but the header, while computing the checksum
+	// (the header is written last since it contains the checksum)
+
+	std::ofstream out(filePath, std::ios::binary);
+	if(!out) {
+		std::cout << "ERROR: Could not open " << filePath << std::endl;
+		return false;
+	}
+
+	char header[TS_BINARY_HEADER_SIZE] = {0};
+	out.write(header, TS_BINARY_HEADER_SIZE);
+
+	uint64_t checksum = 14695981039346656037ULL;
+	uint64_t position = TS_BINARY_HEADER_SIZE;
+
+	// Metadata and tables are gathered in the first chunk
+	std::vector<uint32_t> metadata(
+		snapshot.metadata.begin(), snapshot.metadata.end()
+	);
+
+	std::vector<char> tables(
+		metadata.size() * sizeof(uint32_t) +
+		groupsTable.size() * sizeof(uint32_t) +
+		tensorsTable.size() * sizeof(uint64_t)
+	);
+
+	char * ptr = tables.data();
+	std::memcpy(ptr, metadata.data(), metadata.size() * sizeof(uint32_t));
+	ptr += metadata.size() * sizeof(uint32_t);
+	std::memcpy(ptr, groupsTable.data(), groupsTable.size() * sizeof(uint32_t));
+	ptr += groupsTable.size() * sizeof(uint32_t);
+	std::memcpy(ptr, tensorsTable.data(), tensorsTable.size() * sizeof(uint64_t));
+
+	std::vector<std::pair<const char *, uint64_t>> chunks = {
+		{tables.data(), tables.size()}
+	};
+
+	unsigned k = 0;
+	for(unsigned i=0; i<snapshot.groups.size(); i++) {
+		for(unsigned j=0; j<snapshot.groups[i].size(); j++) {
+			chunks.push_back({
+				(const char *) snapshot.groups[i][j].data(),
+				snapshot.groups[i][j].size() * sizeof(T)
+			});
+		}
+	}
+
+	const char padding[TS_BINARY_ALIGNMENT] = {0};
+
+	for(unsigned i=0; i<chunks.size(); i++) {
+
+		// Pad tensors to their aligned offset
+		if(i >= 1) {
+			uint64_t paddingSize = tensorsTable[3 * k + 2] - position;
+			out.write(padding, paddingSize);
+			checksum = ts::fnv1a(padding, paddingSize, checksum);
+			position += paddingSize;
+			k++;
+		}
+
+		out.write(chunks[i].first, chunks[i].second);
+		checksum = ts::fnv1a(chunks[i].first, chunks[i].second, checksum);
+		position += chunks[i].second;
+	}
+
+
+	// Header
+
+	uint32_t headerFields[6] = {
+		TS_BINARY_VERSION,
+		sizeof(T),
+		(uint32_t) snapshot.metadata.size(),
+		(uint32_t) snapshot.groups.size(),
+		nTensors,
+		TS_BINARY_ALIGNMENT
+	};
+
+	std::memcpy(header, TS_BINARY_MAGIC, 8);
+	std::memcpy(header + 8, headerFields, sizeof(headerFields));
+	std::memcpy(header + 32, &fileSize, sizeof(uint64_t));
+	std::memcpy(header + 40, &checksum, sizeof(uint64_t));
+
+	out.seekp(0);
+	out.write(header, TS_BINARY_HEADER_SIZE);
+	out.close();
+
+	return !out.fail();
+}
+
+
+
+template <typename T>
+bool ts::readBinarySnapshot(
+	std::string filePath, ts::ModelSnapshot<T> &snapshot
+) {
+
+	// The file is memory-mapped, so that tensors can be read in place
+	// without any parsing or intermediary buffer.
+
+	snapshot.metadata = {};
+	snapshot.groups = {};
+
+	int fd = open(filePath.c_str(), O_RDONLY);
+	if(fd < 0) {
+		std::cout << "ERROR: Could not open " << filePath << std::endl;
+		return false;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (uint64_t) st.st_size < TS_BINARY_HEADER_SIZE) {
+		std::cout << "ERROR: " << filePath << " is not a binary model" << std::endl;
+		close(fd);
+		return false;
+	}
+
+	size_t size = st.st_size;
+	void * mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(mapping == MAP_FAILED) {
+		std::cout << "ERROR: Could not map " << filePath << std::endl;
+		return false;
+	}
+
+	const char * file = (const char *) mapping;
+	bool success = false;
+
+
+	// Parse and validate header
+
+	uint32_t headerFields[6];
+	uint64_t fileSize, checksum;
+
+	std::memcpy(headerFields, file + 8, sizeof(headerFields));
+	std::memcpy(&fileSize, file + 32, sizeof(uint64_t));
+	std::memcpy(&checksum, file + 40, sizeof(uint64_t));
+
+	uint32_t version = headerFields[0];
+	uint32_t typeSize = headerFields[1];
+	uint32_t metadataSize = headerFields[2];
+	uint32_t nGroups = headerFields[3];
+	uint32_t nTensors = headerFields[4];
+
+	uint64_t tablesEnd = TS_BINARY_HEADER_SIZE
+	+ ((uint64_t) metadataSize + (uint64_t) nGroups) * sizeof(uint32_t)
+	+ (uint64_t) 3 * nTensors * sizeof(uint64_t);
+
+	if(std::memcmp(file, TS_BINARY_MAGIC, 8) != 0) {
+		std::cout << "ERROR: " << filePath << " is not a binary model" << std::endl;
+	}
+	else if(version != TS_BINARY_VERSION) {
+		std::cout << "ERROR: Unsupported binary model version " << version
+		<< std::endl;
+	}
+	else if(typeSize != sizeof(float) && typeSize != sizeof(double)) {
+		std::cout << "ERROR: Unsupported data type in " << filePath << std::endl;
+	}
+	else if(fileSize != size || tablesEnd > size) {
+		std::cout << "ERROR: " << filePath << " is truncated" << std::endl;
+	}
+	else {
+		success = true;
+	}
+
+
+	// Read metadata and tables
+
+	const char * ptr = file + TS_BINARY_HEADER_SIZE;
+
+	std::vector<uint32_t> metadata(success ? metadataSize : 0);
+	std::vector<uint32_t> groupsTable(success ? nGroups : 0);
+	std::vector<uint64_t> tensorsTable(success ? 3 * nTensors : 0);
+
+	if(success) {
+		std::memcpy(metadata.data(), ptr, metadataSize * sizeof(uint32_t));
+		ptr += metadataSize * sizeof(uint32_t);
+
+		std::memcpy(groupsTable.data(), ptr, nGroups * sizeof(uint32_t));
+		ptr += nGroups * sizeof(uint32_t);
+
+		std::memcpy(tensorsTable.data(), ptr, 3 * nTensors * sizeof(uint64_t));
+	}
+
+
+	// Validate tables, and compute checksum on the same chunks as the writer
+	// (tables, then padding + values of each tensor)
+
+	if(success) {
+		uint64_t groupsTotal = 0;
+		for(unsigned i=0; i<nGroups; i++) {
+			groupsTotal += groupsTable[i];
+		}
+
+		uint64_t checksumValue = ts::fnv1a(
+			file + TS_BINARY_HEADER_SIZE, tablesEnd - TS_BINARY_HEADER_SIZE,
+			14695981039346656037ULL
+		);
+		uint64_t position = tablesEnd;
+
+		for(unsigned k=0; k<nTensors && groupsTotal == nTensors; k++) {
+			uint64_t rows = tensorsTable[3 * k];
+			uint64_t cols = tensorsTable[3 * k + 1];
+			uint64_t offset = tensorsTable[3 * k + 2];
+
+			// Bounds are checked without overflowing on corrupt tables
+			uint64_t maxElements = size / typeSize;
+			if(
+				rows > maxElements || cols > maxElements ||
+				(cols != 0 && rows > maxElements / cols) ||
+				offset < position || offset > size ||
+				offset % TS_BINARY_ALIGNMENT != 0
+			) {
+				groupsTotal = 0;
+				break;
+			}
+
+			uint64_t tensorSize = rows * cols * typeSize;
+			if(tensorSize > size - offset) {
+				groupsTotal = 0;
+				break;
+			}
+
+			checksumValue = ts::fnv1a(file + position, offset - position, checksumValue);
+			checksumValue = ts::fnv1a(file + offset, tensorSize, checksumValue);
+			position = offset + tensorSize;
+		}
+
+		if(groupsTotal != nTensors || position != size) {
+			std::cout << "ERROR: Invalid tensors table in " << filePath
+			<< std::endl;
+			success = false;
+		}
+		else if(checksumValue != checksum) {
+			std::cout << "ERROR: Checksum mismatch in " << filePath << std::endl;
+			success = false;
+		}
+	}
+
+
+	// Read tensors
+
+	if(success) {
+		snapshot.metadata = std::vector<unsigned>(metadata.begin(), metadata.end());
+
+		unsigned k = 0;
+		for(unsigned i=0; i<nGroups; i++) {
+			snapshot.groups.push_back({});
+
+			for(unsigned j=0; j<groupsTable[i]; j++) {
+				uint64_t rows = tensorsTable[3 * k];
+				uint64_t cols = tensorsTable[3 * k + 1];
+				uint64_t offset = tensorsTable[3 * k + 2];
+				k++;
+
+				// Wrap mapped memory and copy it into the tensor array
+				// (converting it if the file uses another data type)
+				if(typeSize == sizeof(float)) {
+					snapshot.groups[i].push_back(
+						Eigen::Map<const Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>>(
+							(const float *) (file + offset), rows, cols
+						).template cast<T>()
+					);
+				}
+				else {
+					snapshot.groups[i].push_back(
+						Eigen::Map<const Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>>(
+							(const double *) (file + offset), rows, cols
+						).template cast<T>()
+					);
+				}
+			}
+		}
+	}
+
+	munmap(mapping, size);
+
+	return success;
+}
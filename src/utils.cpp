@@ -5,6 +5,14 @@
 
 #include "../include/utils.hpp"
 
+#include <charconv>
+
+#include <omp.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+
 
 
 // Splits a string by a char delimiter and returns substrings in a vector
@@ -49,23 +57,22 @@ std::vector<std::vector<unsigned>> ts::parseUnsignedVec2D(
 ) {
 
 	std::vector<std::vector<unsigned>> vec2d = {};
-
-	std::string line;
+	std::streambuf * buffer = in.rdbuf();
 
 	// Get vec2dsize size
-	std::getline(in, line);
-	unsigned size2d = std::stoi(line);
+	unsigned size2d;
+	if(!ts::readNumber(buffer, size2d)) {
+		return vec2d;
+	}
 
 	for(unsigned i=0; i<size2d; i++) {
-		vec2d.push_back({});
+		unsigned size1d = 0;
+		ts::readNumber(buffer, size1d);
 
-		std::getline(in, line);
-		unsigned size1d = std::stoi(line);
+		vec2d.push_back(std::vector<unsigned>(size1d, 0));
 
 		for(unsigned j=0; j<size1d; j++) {
-			std::getline(in, line);
-			unsigned val = std::stoi(line);
-			vec2d[i].push_back(val);
+			ts::readNumber(buffer, vec2d[i][j]);
 		}
 	}
 
@@ -74,6 +81,338 @@ std::vector<std::vector<unsigned>> ts::parseUnsignedVec2D(
 
 
 
+// Read / write numbers in text streams
+// Characters are directly read from the stream buffer and converted with
+// std::from_chars, so no intermediary string is ever created.
+
+template <typename T>
+static bool readNumberFromBuffer(std::streambuf * buffer, T &value) {
+
+	// Longest token we expect (a double in scientific notation is ~25 chars)
+	const unsigned maxLength = 64;
+	char token[maxLength];
+	unsigned length = 0;
+
+	// Skip separators
+	int c = buffer->sgetc();
+	while(c == ',' || c == ' ' || c == '\n' || c == '\r') {
+		c = buffer->snextc();
+	}
+
+	// Read token
+	while(
+		c != std::char_traits<char>::eof() &&
+		c != ',' && c != ' ' && c != '\n' && c != '\r' &&
+		length < maxLength
+	) {
+		token[length++] = (char) c;
+		c = buffer->snextc();
+	}
+
+	// A longer token is invalid : it is skipped entirely, so that its end is
+	// not read as the next number
+	bool truncated = false;
+	while(
+		c != std::char_traits<char>::eof() &&
+		c != ',' && c != ' ' && c != '\n' && c != '\r'
+	) {
+		truncated = true;
+		c = buffer->snextc();
+	}
+
+	// Consume the separator following the token, so that a line-based reader
+	// can resume at the beginning of the next line
+	if(c == '\r') {
+		c = buffer->snextc();
+	}
+	if(c == ',' || c == '\n') {
+		buffer->sbumpc();
+	}
+
+	if(length == 0 || truncated) {
+		return false;
+	}
+
+	// The whole token must be a number (not "1.5x")
+	std::from_chars_result res = std::from_chars(token, token + length, value);
+	return res.ec == std::errc() && res.ptr == token + length;
+}
+
+
+
+bool ts::readNumber(std::streambuf * buffer, unsigned &value) {
+	return readNumberFromBuffer(buffer, value);
+}
+
+bool ts::readNumber(std::streambuf * buffer, float &value) {
+	return readNumberFromBuffer(buffer, value);
+}
+
+bool ts::readNumber(std::streambuf * buffer, double &value) {
+	return readNumberFromBuffer(buffer, value);
+}
+
+
+
+template <typename T>
+static void writeNumberToString(std::string &str, T value) {
+	char token[64];
+	std::to_chars_result res = std::to_chars(token, token + 64, value);
+	str.append(token, res.ptr);
+}
+
+
+
+void ts::writeNumber(std::string &str, float value) {
+	writeNumberToString(str, value);
+}
+
+void ts::writeNumber(std::string &str, double value) {
+	writeNumberToString(str, value);
+}
+
+
+
+// Flatten / unflatten 2D unsigned vector
+// The flat format is similar to the text one :
+// *N == VEC2D SIZE*, *SIZE 1*, *VAL*, ..., *SIZE 2*, *VAL*, ...
+
+void ts::flattenUnsignedVec2D(
+	std::vector<std::vector<unsigned>> &vec2d,
+	std::vector<unsigned> &flat
+) {
+	flat.push_back(vec2d.size());
+
+	for(unsigned i=0; i<vec2d.size(); i++) {
+		flat.push_back(vec2d[i].size());
+		flat.insert(flat.end(), vec2d[i].begin(), vec2d[i].end());
+	}
+}
+
+
+
+std::vector<std::vector<unsigned>> ts::unflattenUnsignedVec2D(
+	std::vector<unsigned> &flat, unsigned &position
+) {
+	// position is the index of the vec2d in flat, and will be moved after
+	// its last element
+
+	std::vector<std::vector<unsigned>> vec2d = {};
+
+	if(position >= flat.size()) {
+		return vec2d;
+	}
+
+	unsigned size2d = flat[position++];
+
+	for(unsigned i=0; i<size2d && position < flat.size(); i++) {
+		unsigned size1d = flat[position++];
+
+		if(position + size1d > flat.size()) {
+			break;
+		}
+
+		vec2d.push_back(std::vector<unsigned>(
+			flat.begin() + position, flat.begin() + position + size1d
+		));
+		position += size1d;
+	}
+
+	return vec2d;
+}
+
+
+
+uint64_t ts::fnv1a(const char * data, size_t size, uint64_t hash) {
+	// Pass 14695981039346656037 as the initial hash value, or the result of a
+	// previous call to hash data in several chunks.
+	// NOTE Data is hashed by 64 bits words (instead of bytes in the original
+	// algorithm), which is much faster on large parameter buffers.
+
+	size_t nWords = size / sizeof(uint64_t);
+	uint64_t word;
+
+	for(size_t i=0; i<nWords; i++) {
+		std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+		hash ^= word;
+		hash *= 1099511628211ULL;
+	}
+
+	for(size_t i=nWords * sizeof(uint64_t); i<size; i++) {
+		hash ^= (unsigned char) data[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+
+bool ts::commitFile(std::string tmpPath, std::string filePath) {
+	// The rename is atomic, so filePath always contains a complete file (either
+	// the previous one or the new one), even if the program crashes.
+
+	int fd = open(tmpPath.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	bool synced = fsync(fd) == 0;
+	close(fd);
+
+	if(!synced || std::rename(tmpPath.c_str(), filePath.c_str()) != 0) {
+		return false;
+	}
+
+	// Persist the rename itself by syncing the parent directory
+	size_t slash = filePath.find_last_of('/');
+	std::string directory = slash == std::string::npos ?
+	"." : filePath.substr(0, slash + 1);
+
+	fd = open(directory.c_str(), O_RDONLY);
+	if(fd >= 0) {
+		fsync(fd);
+		close(fd);
+	}
+
+	return true;
+}
+
+
+
+std::string ts::cpuSignature() {
+	std::string signature = "";
+
+#if defined(__x86_64__) || defined(__i386__)
+	signature += "x86";
+
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("sse4.2")) {
+		signature += "+sse4.2";
+	}
+	if(__builtin_cpu_supports("avx")) {
+		signature += "+avx";
+	}
+	if(__builtin_cpu_supports("avx2")) {
+		signature += "+avx2";
+	}
+	if(__builtin_cpu_supports("fma")) {
+		signature += "+fma";
+	}
+	if(__builtin_cpu_supports("avx512f")) {
+		signature += "+avx512f";
+	}
+#elif defined(__aarch64__)
+	signature += "arm64";
+#else
+	signature += "unknown";
+#endif
+
+	signature += "/" + std::to_string(omp_get_max_threads()) + "t";
+
+	return signature;
+}
+
+
+
+#if TS_KERNEL_DISPATCH
+// One version per level of TS_TARGET_CLONES : the loader resolves these with
+// the same priorities as the kernels clones
+__attribute__((target("default")))
+static std::string isaName() {
+	return "default";
+}
+
+__attribute__((target("arch=x86-64-v2")))
+static std::string isaName() {
+	return "x86-64-v2";
+}
+
+__attribute__((target("arch=x86-64-v3")))
+static std::string isaName() {
+	return "x86-64-v3";
+}
+
+__attribute__((target("arch=x86-64-v4")))
+static std::string isaName() {
+	return "x86-64-v4";
+}
+#endif
+
+
+
+std::string ts::kernelIsa() {
+#if TS_KERNEL_DISPATCH
+	return isaName();
+#else
+	return "default";
+#endif
+}
+
+
+
+unsigned ts::convOutputSize(
+	unsigned inputSize, unsigned kernelSize,
+	unsigned stride, unsigned padding, unsigned dilation
+) {
+	long extent = (long) dilation * ((long) kernelSize - 1) + 1;
+	long paddedSize = (long) inputSize + 2 * (long) padding;
+
+	if(kernelSize == 0 || stride == 0 || extent > paddedSize) {
+		return 0;
+	}
+
+	return (paddedSize - extent) / stride + 1;
+}
+
+
+
+unsigned ts::poolingOutputSize(
+	unsigned inputSize, unsigned poolSize, unsigned stride, unsigned padding
+) {
+	long paddedSize = (long) inputSize + 2 * (long) padding;
+
+	if(
+		poolSize == 0 || stride == 0 || padding >= poolSize ||
+		poolSize > paddedSize || (paddedSize - poolSize) % stride != 0
+	) {
+		return 0;
+	}
+
+	return (paddedSize - poolSize) / stride + 1;
+}
+
+
+
+ts::ConvGeometry ts::convGeometry(
+	std::vector<long> inputDim, std::vector<long> kernelDim,
+	std::vector<long> stride, std::vector<long> padding,
+	std::vector<long> dilation
+) {
+	ts::ConvGeometry geometry;
+
+	geometry.rows = inputDim[0];
+	geometry.cols = inputDim[1];
+	geometry.kernelRows = kernelDim[0];
+	geometry.kernelCols = kernelDim[1];
+	geometry.strideRows = stride[0];
+	geometry.strideCols = stride[1];
+	geometry.paddingRows = padding[0];
+	geometry.paddingCols = padding[1];
+	geometry.dilationRows = dilation[0];
+	geometry.dilationCols = dilation[1];
+
+	geometry.outRows = ts::convOutputSize(
+		inputDim[0], kernelDim[0], stride[0], padding[0], dilation[0]
+	);
+	geometry.outCols = ts::convOutputSize(
+		inputDim[1], kernelDim[1], stride[1], padding[1], dilation[1]
+	);
+
+	return geometry;
+}
+
+
+
 void ts::progressBar(unsigned current, unsigned max) {
 	float progress = (float) current / (float) max;
 
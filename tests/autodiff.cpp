@@ -107,6 +107,8 @@ TEST(Operators, SimpleDiv) {
 
 	ts::Gradient<float> grad = res.grad();
 
+	EXPECT_EQ(res.getValue()(0, 0), a.getValue()(0, 0) / b.getValue()(0, 0));
+
 	EXPECT_EQ(grad.getValue(a)(0, 0), 1.0f / b.getValue()(0, 0));
 	EXPECT_EQ(
 		grad.getValue(b)(0, 0),
@@ -272,6 +274,145 @@ TEST(AutodiffTest, Relu) {
 
 
 
+TEST(AutodiffTest, ActivationKernels) {
+	// Values and derivatives of the vectorized activations, on several
+	// kernel blocks (and a partial mask word for relu / leakyRelu)
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x_;
+	x_.setRandom(2500, 1);
+	x_ *= 5;
+	x_(0, 0) = 100;
+	x_(1, 0) = -100;
+	x_(2, 0) = 0;
+	ts::Tensor<float> x = ts::Tensor<float>(x_, &wList);
+
+	ts::Tensor<float> sigmoid = ts::sigmoid(x);
+	ts::Tensor<float> relu = ts::relu(x);
+	ts::Tensor<float> leakyRelu = ts::leakyRelu(x);
+	ts::Tensor<float> tanh = ts::tanh(x);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> sigmoidDx =
+	sigmoid.grad().getValue(x);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> reluDx =
+	relu.grad().getValue(x);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> leakyReluDx =
+	leakyRelu.grad().getValue(x);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> tanhDx =
+	tanh.grad().getValue(x);
+
+	for(unsigned i=0; i<x_.rows(); i++) {
+		float s = 1 / (1 + std::exp(-x_(i, 0)));
+		EXPECT_NEAR(sigmoid.getValue()(i, 0), s, 1e-6);
+		EXPECT_NEAR(sigmoidDx(i, 0), s * (1 - s), 1e-6);
+
+		EXPECT_EQ(relu.getValue()(i, 0), x_(i, 0) > 0 ? x_(i, 0) : 0.0f);
+		EXPECT_EQ(reluDx(i, 0), x_(i, 0) > 0 ? 1.0f : 0.0f);
+
+		EXPECT_EQ(leakyRelu.getValue()(i, 0), x_(i, 0) > 0 ? x_(i, 0) : 0.1f * x_(i, 0));
+		EXPECT_EQ(leakyReluDx(i, 0), x_(i, 0) > 0 ? 1.0f : 0.1f);
+
+		float t = std::tanh(x_(i, 0));
+		EXPECT_NEAR(tanh.getValue()(i, 0), t, 1e-6);
+		EXPECT_NEAR(tanhDx(i, 0), 1 - t * t, 1e-5);
+	}
+}
+
+
+
+TEST(AutodiffTest, KernelIsa) {
+	// The kernels variant is selected once when the library is loaded
+
+	std::string isa = ts::kernelIsa();
+
+	EXPECT_TRUE(
+		isa == "x86-64-v4" || isa == "x86-64-v3" ||
+		isa == "x86-64-v2" || isa == "default"
+	);
+	EXPECT_EQ(ts::kernelIsa(), isa);
+}
+
+
+
+TEST(AutodiffTest, Softmax) {
+	// Softmax of each column, and derivative of a norm of its result
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, 4, 1> x_;
+	x_ <<
+	1.0,
+	2.0,
+	-1.0,
+	100.0;
+	ts::Tensor<float> x = ts::Tensor<float>(x_, &wList);
+
+	Eigen::Array<float, 4, 1> target_;
+	target_ << 0, 1, 0, 0;
+	ts::Tensor<float> target = ts::Tensor<float>(target_, &wList);
+
+	ts::Tensor<float> s = ts::softmax(x);
+	ts::Gradient<float> grad = ts::squaredNorm(s - target).grad();
+
+	// Large inputs don't overflow
+	Eigen::Array<float, 4, 1> expected = (x_ - x_.maxCoeff()).exp();
+	expected /= expected.sum();
+
+	// dx = s * (g - s.g), with g = 2 * (s - target)
+	Eigen::Array<float, 4, 1> g = 2 * (expected - target_);
+	Eigen::Array<float, 4, 1> expectedDx = expected * (g - (expected * g).sum());
+
+	for(unsigned i=0; i<4; i++) {
+		EXPECT_NEAR(s.getValue()(i, 0), expected(i, 0), 1e-6);
+		EXPECT_NEAR(grad.getValue(x)(i, 0), expectedDx(i, 0), 1e-6);
+	}
+	EXPECT_NEAR(s.getValue().sum(), 1, 1e-6);
+}
+
+
+
+TEST(AutodiffTest, SoftmaxCrossEntropy) {
+	// Fused loss on 2 samples, with logits that would overflow a naive
+	// softmax
+
+	ts::WengertList<double> wList;
+
+	Eigen::Array<double, 3, 2> x_;
+	x_ <<
+	1.0, 1000.0,
+	2.0, -5.0,
+	-1.0, 999.0;
+	ts::Tensor<double> x = ts::Tensor<double>(x_, &wList);
+
+	ts::Tensor<double> loss = ts::softmaxCrossEntropy(x, {1, 2});
+	ts::Gradient<double> grad = loss.grad();
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> dx = grad.getValue(x);
+
+	// Single node on top of x
+	EXPECT_EQ(wList.size(), 2);
+
+	double expectedLoss = 0;
+	for(unsigned j=0; j<2; j++) {
+		Eigen::Array<double, 3, 1> s = (x_.col(j) - x_.col(j).maxCoeff()).exp();
+		s /= s.sum();
+
+		unsigned label = j == 0 ? 1 : 2;
+		expectedLoss -= std::log(s(label));
+
+		for(unsigned i=0; i<3; i++) {
+			EXPECT_NEAR(dx(i, j), s(i) - (i == label), 1e-9);
+		}
+	}
+	EXPECT_NEAR(loss.getValue()(0, 0), expectedLoss, 1e-9);
+
+	// Labels must match the columns and classes
+	EXPECT_EQ(ts::softmaxCrossEntropy(x, {1}).getValue().size(), 0);
+	EXPECT_EQ(ts::softmaxCrossEntropy(x, {1, 3}).getValue().size(), 0);
+}
+
+
+
 TEST(AutodiffTest, MatProd) {
 	// Tests a matrix-matrix product, as well as the gradient protection
 	// mechanism (when computing grad of a non scalar tensor)
@@ -306,6 +447,134 @@ TEST(AutodiffTest, MatProd) {
 
 
 
+TEST(AutodiffTest, BroadcastAdd) {
+	// Adds a column vector to each column of a matrix : the vector derivative
+	// is the sum of the result derivative columns
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> a_;
+	a_.setRandom(3, 4);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> b_;
+	b_.setRandom(3, 1);
+
+	ts::Tensor<float> a = ts::Tensor<float>(a_, &wList);
+	ts::Tensor<float> b = ts::Tensor<float>(b_, &wList);
+
+	ts::Tensor<float> c = ts::broadcastAdd(a, b);
+	ts::Gradient<float> grad = ts::squaredNorm(c).grad();
+
+	for(unsigned i=0; i<3; i++) {
+		for(unsigned j=0; j<4; j++) {
+			EXPECT_EQ(c.getValue()(i, j), a_(i, j) + b_(i, 0));
+			EXPECT_FLOAT_EQ(grad.getValue(a)(i, j), 2 * c.getValue()(i, j));
+		}
+		EXPECT_FLOAT_EQ(grad.getValue(b)(i, 0), 2 * c.getValue().row(i).sum());
+	}
+
+	// Only column vectors can be broadcast
+	EXPECT_EQ(ts::broadcastAdd(a, a).getValue().size(), 0);
+}
+
+
+
+TEST(AutodiffTest, BatchNorm) {
+	// Each row is normalized with constant statistics, then scaled and shifted
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x_;
+	x_.setRandom(3, 4);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> scale_;
+	scale_.setRandom(3, 1);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> shift_;
+	shift_.setRandom(3, 1);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mean;
+	mean.setRandom(3, 1);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> variance;
+	variance.setRandom(3, 1);
+	variance = variance.abs() + 0.5;
+
+	ts::Tensor<float> x = ts::Tensor<float>(x_, &wList);
+	ts::Tensor<float> scale = ts::Tensor<float>(scale_, &wList);
+	ts::Tensor<float> shift = ts::Tensor<float>(shift_, &wList);
+
+	ts::Tensor<float> y = ts::batchNorm(x, scale, shift, mean, variance, 1e-5f);
+	ts::Gradient<float> grad = ts::squaredNorm(y).grad();
+
+	for(unsigned i=0; i<3; i++) {
+		float invStd = 1 / std::sqrt(variance(i, 0) + 1e-5f);
+		float scaleGrad = 0;
+
+		for(unsigned j=0; j<4; j++) {
+			float normalized = (x_(i, j) - mean(i, 0)) * invStd;
+			EXPECT_FLOAT_EQ(
+				y.getValue()(i, j), scale_(i, 0) * normalized + shift_(i, 0)
+			);
+			EXPECT_FLOAT_EQ(
+				grad.getValue(x)(i, j), 2 * y.getValue()(i, j) * scale_(i, 0) * invStd
+			);
+			scaleGrad += 2 * y.getValue()(i, j) * normalized;
+		}
+
+		EXPECT_NEAR(grad.getValue(scale)(i, 0), scaleGrad, 1e-5);
+		EXPECT_FLOAT_EQ(grad.getValue(shift)(i, 0), 2 * y.getValue().row(i).sum());
+	}
+
+	// Statistics must have one value per row
+	EXPECT_EQ(
+		ts::batchNorm(x, scale, shift, mean, x_, 1e-5f).getValue().size(), 0
+	);
+
+
+	// With the statistics of x, each row of the normalized x has a zero mean
+	// and unit variance, and the gradient of x (through the statistics) matches
+	// finite differences
+
+	ts::WengertList<double> dList;
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> dx_;
+	dx_.setRandom(3, 5);
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> weights;
+	weights.setRandom(3, 5);
+
+	ts::Tensor<double> dx = ts::Tensor<double>(dx_, &dList);
+	ts::Tensor<double> dScale = ts::Tensor<double>(scale_.cast<double>(), &dList);
+	ts::Tensor<double> dShift = ts::Tensor<double>(shift_.cast<double>(), &dList);
+
+	ts::Tensor<double> z = ts::batchNorm(dx, dScale, dShift, 0.);
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> normalized =
+	(z.getValue().colwise() - shift_.cast<double>().col(0)).colwise() /
+	scale_.cast<double>().col(0);
+	EXPECT_TRUE(normalized.rowwise().mean().isZero(1e-9));
+	EXPECT_TRUE(normalized.square().rowwise().mean().isOnes(1e-9));
+
+	ts::Tensor<double> weightsTensor = ts::Tensor<double>(weights, &dList);
+	ts::Gradient<double> dGrad = ts::squaredNorm(z * weightsTensor).grad();
+
+	for(unsigned i=0; i<3; i++) {
+		for(unsigned j=0; j<5; j++) {
+			Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> shifted = dx_;
+			shifted(i, j) += 1e-6;
+
+			ts::WengertList<double> fdList;
+			ts::Tensor<double> fdZ = ts::batchNorm(
+				ts::Tensor<double>(shifted, &fdList),
+				ts::Tensor<double>(scale_.cast<double>(), &fdList),
+				ts::Tensor<double>(shift_.cast<double>(), &fdList), 0.
+			);
+			double difference =
+			((fdZ.getValue() * weights).square().sum() -
+			(z.getValue() * weights).square().sum()) / 1e-6;
+
+			EXPECT_NEAR(dGrad.getValue(dx)(i, j), difference, 1e-4);
+		}
+	}
+}
+
+
+
 TEST(AutodiffTest, SimpleNN) {
 	// Simulates a simple feedforward neural network with no hidden layer, and
 	// its cost function. We'll compute the gradient of this function on a
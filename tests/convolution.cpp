@@ -133,6 +133,124 @@ TEST(Convolution, MaxPooling) {
 
 
 
+TEST(Convolution, PoolingStridePadding) {
+	// Compare max / average pooling with non-square, overlapping and padded
+	// pools to a direct computation on the padded matrix
+
+	ts::WengertList<double> wList;
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> x_;
+	x_.setRandom(7, 9);
+	ts::Tensor<double> x = ts::Tensor<double>(x_, &wList);
+
+	std::vector<std::vector<unsigned>> pools = {{2, 3}, {3, 3}, {3, 2}};
+	std::vector<std::vector<unsigned>> strides = {{1, 3}, {2, 2}, {1, 1}};
+	std::vector<std::vector<unsigned>> paddings = {{0, 0}, {1, 1}, {1, 0}};
+
+	for(unsigned n=0; n<pools.size(); n++) {
+		std::vector<unsigned> &pool = pools[n];
+		std::vector<unsigned> &stride = strides[n];
+		std::vector<unsigned> &padding = paddings[n];
+
+		long rows = (7 + 2 * padding[0] - pool[0]) / stride[0] + 1;
+		long cols = (9 + 2 * padding[1] - pool[1]) / stride[1] + 1;
+
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> padded;
+		padded.setConstant(7 + 2 * padding[0], 9 + 2 * padding[1], -1e9);
+		padded.block(padding[0], padding[1], 7, 9) = x_;
+
+		ts::Tensor<double> maxRes = ts::maxPooling(x, pool, stride, padding);
+		ts::Tensor<double> avgRes = ts::averagePooling(x, pool, stride, padding);
+
+		ASSERT_EQ(maxRes.getValue().rows(), rows);
+		ASSERT_EQ(maxRes.getValue().cols(), cols);
+		ASSERT_EQ(avgRes.getValue().rows(), rows);
+		ASSERT_EQ(avgRes.getValue().cols(), cols);
+
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> maxGrad, avgGrad;
+		maxGrad.setZero(padded.rows(), padded.cols());
+		avgGrad.setZero(padded.rows(), padded.cols());
+		double area = pool[0] * pool[1];
+
+		for(long i=0; i<rows; i++) {
+			for(long j=0; j<cols; j++) {
+				Eigen::Index r, c;
+				double max = padded.block(
+					i * stride[0], j * stride[1], pool[0], pool[1]
+				).maxCoeff(&r, &c);
+				double sum = (padded.block(
+					i * stride[0], j * stride[1], pool[0], pool[1]
+				) > -1e9).select(
+					padded.block(i * stride[0], j * stride[1], pool[0], pool[1]), 0
+				).sum();
+
+				EXPECT_NEAR(maxRes.getValue()(i, j), max, 1e-12);
+				EXPECT_NEAR(avgRes.getValue()(i, j), sum / area, 1e-12);
+
+				// Derivatives of the squared norms
+				maxGrad(i * stride[0] + r, j * stride[1] + c) += 2 * max;
+				avgGrad.block(i * stride[0], j * stride[1], pool[0], pool[1]) +=
+				2 * sum / (area * area);
+			}
+		}
+
+		ts::Gradient<double> grad = ts::squaredNorm(maxRes).grad();
+		EXPECT_TRUE(grad.getValue(x).isApprox(
+			maxGrad.block(padding[0], padding[1], 7, 9), 1e-12
+		));
+
+		grad = ts::squaredNorm(avgRes).grad();
+		EXPECT_TRUE(grad.getValue(x).isApprox(
+			avgGrad.block(padding[0], padding[1], 7, 9), 1e-12
+		));
+	}
+
+
+	// Pools must cover the padded matrix exactly, and can't contain only
+	// padding
+
+	EXPECT_EQ(ts::maxPooling(x, {2, 2}, {2, 2}).getValue().size(), 0);
+	EXPECT_EQ(ts::averagePooling(x, {2, 3}, {1, 3}, {2, 0}).getValue().size(), 0);
+}
+
+
+
+TEST(Convolution, GlobalAveragePooling) {
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x_;
+	x_.setRandom(3 * 4, 5);
+	ts::Tensor<float> x = ts::Tensor<float>(x_, &wList);
+
+	ts::Tensor<float> res = ts::globalAveragePooling(x, 3);
+	ts::Gradient<float> grad = ts::squaredNorm(res).grad();
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> dx = grad.getValue(x);
+
+
+	// Check result and derivatives (each channel mean is spread on its 20
+	// elements)
+
+	ASSERT_EQ(res.getValue().rows(), 3);
+	ASSERT_EQ(res.getValue().cols(), 1);
+
+	for(unsigned c=0; c<3; c++) {
+		float mean = x_.middleRows(c * 4, 4).mean();
+		EXPECT_NEAR(res.getValue()(c, 0), mean, 1e-6);
+
+		for(unsigned i=0; i<4; i++) {
+			for(unsigned j=0; j<5; j++) {
+				EXPECT_NEAR(dx(c * 4 + i, j), 2 * mean / 20, 1e-6);
+			}
+		}
+	}
+
+	// The rows of the map must be a multiple of the number of channels
+	EXPECT_EQ(ts::globalAveragePooling(x, 5).getValue().size(), 0);
+}
+
+
+
 TEST(Convolution, Split) {
 
 	ts::WengertList<float> wList;
@@ -237,6 +355,36 @@ TEST(Convolution, VerticalConcatenation) {
 
 
 
+TEST(Convolution, HorizontalConcatenation) {
+
+	ts::WengertList<float> wList;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x_;
+	x_.setRandom(3, 2);
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> y_;
+	y_.setRandom(3, 4);
+	ts::Tensor<float> x = ts::Tensor<float>(x_, &wList);
+	ts::Tensor<float> y = ts::Tensor<float>(y_, &wList);
+
+	ts::Tensor<float> res = ts::horCat<float>({x, y});
+
+	ASSERT_EQ(res.getValue().rows(), 3);
+	ASSERT_EQ(res.getValue().cols(), 6);
+	EXPECT_TRUE(res.getValue().leftCols(2).isApprox(x_));
+	EXPECT_TRUE(res.getValue().rightCols(4).isApprox(y_));
+
+	// Each parent gets its own columns of the derivative
+	ts::Gradient<float> grad = ts::squaredNorm(res).grad();
+	EXPECT_TRUE(grad.getValue(x).isApprox(2 * x_));
+	EXPECT_TRUE(grad.getValue(y).isApprox(2 * y_));
+
+	// All tensors must have the same height
+	EXPECT_EQ(ts::horCat<float>({x, ts::Tensor<float>(x_.transpose(), &wList)})
+	.getValue().size(), 0);
+}
+
+
+
 TEST(Convolution, Flattening) {
 	// We'll test the flattening of a matrix to a vector
 
@@ -335,21 +483,21 @@ TEST(Convolution, Im2Col) {
 	// Test partial derivatives
 	Eigen::Array<float, 3, 3> expectedDx1;
 	expectedDx1 <<
-	 2, 12, 10,
-	12, 40, 28,
-	10, 28, 18;
+	 2,  8,  6,
+	16, 40, 24,
+	14, 32, 18;
 
 	Eigen::Array<float, 3, 3> expectedDx2;
 	expectedDx2 <<
-	22,  52,  30,
-	52, 120,  68,
-	30,  68,  38;
+	22,  48,  26,
+	56, 120,  64,
+	34,  72,  38;
 
 	Eigen::Array<float, 3, 3> expectedDx3;
 	expectedDx3 <<
-	42,  92,  50,
-	92, 200, 108,
-	50, 108,  58;
+	42,  88,  46,
+	96, 200, 104,
+	54, 112,  58;
 
 	Eigen::Array<float, 3, 3> dx1 = grad.getValue(x[0]);
 	Eigen::Array<float, 3, 3> dx2 = grad.getValue(x[1]);
@@ -367,6 +515,357 @@ TEST(Convolution, Im2Col) {
 
 
 
+TEST(Convolution, Im2ColStridePaddingDilation) {
+	// Compare an im2col convolution with stride, padding and dilation to a
+	// naive implementation, and check its gradient with finite differences
+
+	ts::WengertList<double> wList;
+
+	unsigned rows = 7, cols = 6;
+	std::vector<unsigned> kernelDim = {3, 2};
+	std::vector<unsigned> stride = {2, 1};
+	std::vector<unsigned> padding = {1, 2};
+	std::vector<unsigned> dilation = {1, 2};
+
+	std::vector<Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>> x_ = {
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(rows, cols),
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(rows, cols)
+	};
+	std::vector<ts::Tensor<double>> x = {
+		ts::Tensor<double>(x_[0], &wList),
+		ts::Tensor<double>(x_[1], &wList)
+	};
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> ker_ =
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(1, 12);
+	ts::Tensor<double> ker = ts::Tensor<double>(ker_, &wList);
+
+	ts::Tensor<double> mat = ts::im2col(x, kernelDim, stride, padding, dilation);
+	ts::Tensor<double> conv = ts::matProd(ker, mat);
+
+	unsigned outRows = (rows + 2 * 1 - 3) / 2 + 1;
+	unsigned outCols = (cols + 2 * 2 - 3) / 1 + 1;
+	ASSERT_EQ(mat.getValue().rows(), 12);
+	ASSERT_EQ(mat.getValue().cols(), outRows * outCols);
+
+
+	// Naive convolution on zero padded inputs
+
+	for(unsigned r=0; r<outRows; r++) {
+		for(unsigned c=0; c<outCols; c++) {
+			double expected = 0;
+
+			for(unsigned i=0; i<2; i++) {
+				Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> padded;
+				padded.setZero(rows + 2, cols + 4);
+				padded.block(1, 2, rows, cols) = x_[i];
+
+				for(unsigned kc=0; kc<2; kc++) {
+					for(unsigned kr=0; kr<3; kr++) {
+						expected += ker_(0, i * 6 + kc * 3 + kr) *
+						padded(r * 2 + kr, c + kc * 2);
+					}
+				}
+			}
+
+			EXPECT_NEAR(conv.getValue()(0, r * outCols + c), expected, 1e-12);
+		}
+	}
+
+
+	// Gradient (finite differences are exact for a quadratic function)
+
+	ts::Gradient<double> grad = ts::squaredNorm(mat).grad();
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> dx = grad.getValue(x[1]);
+
+	double h = 0.001;
+	for(unsigned i=0; i<rows; i++) {
+		for(unsigned j=0; j<cols; j++) {
+			std::vector<Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>> xPlus = x_;
+			std::vector<Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>> xMinus = x_;
+			xPlus[1](i, j) += h;
+			xMinus[1](i, j) -= h;
+
+			ts::WengertList<double> tmpList;
+			std::vector<ts::Tensor<double>> tPlus = {
+				ts::Tensor<double>(xPlus[0], &tmpList),
+				ts::Tensor<double>(xPlus[1], &tmpList)
+			};
+			std::vector<ts::Tensor<double>> tMinus = {
+				ts::Tensor<double>(xMinus[0], &tmpList),
+				ts::Tensor<double>(xMinus[1], &tmpList)
+			};
+
+			double fPlus = ts::squaredNorm(
+				ts::im2col(tPlus, kernelDim, stride, padding, dilation)
+			).getValue()(0, 0);
+			double fMinus = ts::squaredNorm(
+				ts::im2col(tMinus, kernelDim, stride, padding, dilation)
+			).getValue()(0, 0);
+
+			EXPECT_NEAR(dx(i, j), (fPlus - fMinus) / (2 * h), 1e-6);
+		}
+	}
+}
+
+
+
+TEST(Convolution, DepthwiseConv) {
+	// Compare a depthwise convolution to per channel im2col convolutions, for
+	// both values and gradients
+
+	unsigned rows = 8, cols = 7, channels = 3;
+	std::vector<unsigned> kernelDim = {3, 2};
+	std::vector<unsigned> stride = {2, 1};
+	std::vector<unsigned> padding = {1, 1};
+	std::vector<unsigned> dilation = {1, 2};
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> ker_ =
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(channels, 6);
+
+	ts::WengertList<double> wList;
+	ts::WengertList<double> refList;
+
+	ts::Tensor<double> ker = ts::Tensor<double>(ker_, &wList);
+	std::vector<ts::Tensor<double>> x = {};
+	std::vector<ts::Tensor<double>> refKer = {};
+	std::vector<ts::Tensor<double>> refX = {};
+	std::vector<ts::Tensor<double>> refConv = {};
+
+	for(unsigned i=0; i<channels; i++) {
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> x_;
+		x_.setRandom(rows, cols);
+
+		x.push_back(ts::Tensor<double>(x_, &wList));
+		refX.push_back(ts::Tensor<double>(x_, &refList));
+		refKer.push_back(ts::Tensor<double>(ker_.row(i), &refList));
+
+		std::vector<ts::Tensor<double>> channel = {refX[i]};
+		refConv.push_back(ts::matProd(
+			refKer[i], ts::im2col(channel, kernelDim, stride, padding, dilation)
+		));
+	}
+
+	ts::Tensor<double> conv = ts::depthwiseConv(
+		ker, x, kernelDim, stride, padding, dilation
+	);
+	ts::Tensor<double> ref = ts::vertCat(refConv);
+
+	ASSERT_EQ(conv.getValue().rows(), channels);
+	ASSERT_EQ(conv.getValue().cols(), ref.getValue().cols());
+	EXPECT_TRUE(conv.getValue().isApprox(ref.getValue(), 1e-12));
+
+
+	// Gradients
+
+	ts::Gradient<double> grad = ts::squaredNorm(conv).grad();
+	ts::Gradient<double> refGrad = ts::squaredNorm(ref).grad();
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> dKer = grad.getValue(ker);
+	ASSERT_EQ(dKer.rows(), channels);
+	ASSERT_EQ(dKer.cols(), 6);
+
+	for(unsigned i=0; i<channels; i++) {
+		EXPECT_TRUE(dKer.row(i).isApprox(refGrad.getValue(refKer[i]), 1e-10));
+		EXPECT_TRUE(grad.getValue(x[i]).isApprox(refGrad.getValue(refX[i]), 1e-10));
+	}
+
+
+	// Kernel and channels mismatch
+
+	ts::Tensor<double> invalid = ts::depthwiseConv(
+		ts::Tensor<double>(ker_.topRows(2), &wList), x, kernelDim
+	);
+	EXPECT_EQ(invalid.getValue().size(), 0);
+}
+
+
+
+TEST(Convolution, ImplicitConv) {
+	// Compare an implicit GEMM convolution to an im2col convolution (inputs
+	// are large enough for the implicit convolution to be computed in several
+	// tiles)
+
+	ts::WengertList<double> wList;
+
+	unsigned rows = 101, cols = 97;
+	std::vector<unsigned> kernelDim = {3, 3};
+	std::vector<unsigned> stride = {2, 1};
+	std::vector<unsigned> padding = {1, 1};
+	std::vector<unsigned> dilation = {2, 1};
+
+	std::vector<ts::Tensor<double>> x = {};
+	for(unsigned i=0; i<3; i++) {
+		x.push_back(ts::Tensor<double>(
+			Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(rows, cols),
+			&wList
+		));
+	}
+
+	ts::Tensor<double> ker = ts::Tensor<double>(
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(4, 27),
+		&wList
+	);
+
+	ts::Tensor<double> expected = ts::matProd(
+		ker, ts::im2col(x, kernelDim, stride, padding, dilation)
+	);
+	ts::Tensor<double> conv = ts::implicitConv(
+		ker, x, kernelDim, stride, padding, dilation
+	);
+
+	ASSERT_EQ(conv.getValue().rows(), expected.getValue().rows());
+	ASSERT_EQ(conv.getValue().cols(), expected.getValue().cols());
+	EXPECT_TRUE(conv.getValue().isApprox(expected.getValue(), 1e-12));
+
+
+	// Gradients
+
+	ts::Gradient<double> expectedGrad = ts::squaredNorm(expected).grad();
+	ts::Gradient<double> grad = ts::squaredNorm(conv).grad();
+
+	EXPECT_TRUE(grad.getValue(ker).isApprox(expectedGrad.getValue(ker), 1e-12));
+	for(unsigned i=0; i<x.size(); i++) {
+		EXPECT_TRUE(
+			grad.getValue(x[i]).isApprox(expectedGrad.getValue(x[i]), 1e-12)
+		);
+	}
+
+
+	// Kernel and input channels must match
+
+	ts::Tensor<double> wrongKer = ts::Tensor<double>(
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(4, 18),
+		&wList
+	);
+	EXPECT_EQ(ts::implicitConv(wrongKer, x, kernelDim).getValue().size(), 0);
+}
+
+
+
+TEST(Convolution, Winograd) {
+	// Compare Winograd convolutions to an im2col convolution (output sizes
+	// are not multiples of the tiles sizes)
+
+	ts::WengertList<double> wList;
+
+	unsigned rows = 13, cols = 11;
+	std::vector<unsigned> padding = {1, 0};
+
+	std::vector<ts::Tensor<double>> x = {};
+	for(unsigned i=0; i<3; i++) {
+		x.push_back(ts::Tensor<double>(
+			Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(rows, cols),
+			&wList
+		));
+	}
+
+	ts::Tensor<double> ker = ts::Tensor<double>(
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(5, 27),
+		&wList
+	);
+
+	ts::Tensor<double> expected = ts::matProd(
+		ker, ts::im2col(x, {3, 3}, {1, 1}, padding)
+	);
+	ts::Gradient<double> expectedGrad = ts::squaredNorm(expected).grad();
+
+	for(unsigned outputTile : {2, 4}) {
+		ts::Tensor<double> conv = ts::winogradConv(ker, x, padding, outputTile);
+
+		ASSERT_EQ(conv.getValue().rows(), expected.getValue().rows());
+		ASSERT_EQ(conv.getValue().cols(), expected.getValue().cols());
+		EXPECT_TRUE(conv.getValue().isApprox(expected.getValue(), 1e-10));
+
+		ts::Gradient<double> grad = ts::squaredNorm(conv).grad();
+
+		EXPECT_TRUE(grad.getValue(ker).isApprox(expectedGrad.getValue(ker), 1e-10));
+		for(unsigned i=0; i<x.size(); i++) {
+			EXPECT_TRUE(
+				grad.getValue(x[i]).isApprox(expectedGrad.getValue(x[i]), 1e-10)
+			);
+		}
+	}
+
+
+	// Cached kernel transforms are used until the cache is updated, and
+	// ignored if they don't match the convolution
+
+	ts::WinogradCache<double> cache;
+	cache.update(ker.getValue(), 4);
+	ts::Tensor<double> conv = ts::winogradConv(ker, x, padding, 4, &cache);
+	EXPECT_TRUE(conv.getValue().isApprox(expected.getValue(), 1e-10));
+
+	ts::Tensor<double> newKer = ts::Tensor<double>(
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(5, 27),
+		&wList
+	);
+	conv = ts::winogradConv(newKer, x, padding, 4, &cache);
+	EXPECT_TRUE(conv.getValue().isApprox(expected.getValue(), 1e-10));
+
+	expected = ts::matProd(newKer, ts::im2col(x, {3, 3}, {1, 1}, padding));
+	conv = ts::winogradConv(newKer, x, padding, 2, &cache);
+	EXPECT_TRUE(conv.getValue().isApprox(expected.getValue(), 1e-10));
+
+	cache.update(newKer.getValue(), 4);
+	conv = ts::winogradConv(newKer, x, padding, 4, &cache);
+	EXPECT_TRUE(conv.getValue().isApprox(expected.getValue(), 1e-10));
+
+
+	// Only F(2x2, 3x3) and F(4x4, 3x3) are supported
+	EXPECT_EQ(ts::winogradConv(ker, x, padding, 3).getValue().size(), 0);
+}
+
+
+
+TEST(Convolution, FFTConv) {
+	// Compare a FFT convolution to an im2col convolution (with a non square
+	// kernel, and inputs whose padded sizes are not powers of 2)
+
+	ts::WengertList<double> wList;
+
+	unsigned rows = 19, cols = 14;
+	std::vector<unsigned> kernelDim = {5, 4};
+	std::vector<unsigned> padding = {2, 1};
+
+	std::vector<ts::Tensor<double>> x = {};
+	for(unsigned i=0; i<2; i++) {
+		x.push_back(ts::Tensor<double>(
+			Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(rows, cols),
+			&wList
+		));
+	}
+
+	ts::Tensor<double> ker = ts::Tensor<double>(
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(3, 40),
+		&wList
+	);
+
+	ts::Tensor<double> expected = ts::matProd(
+		ker, ts::im2col(x, kernelDim, {1, 1}, padding)
+	);
+	ts::Tensor<double> conv = ts::fftConv(ker, x, kernelDim, padding);
+
+	ASSERT_EQ(conv.getValue().rows(), expected.getValue().rows());
+	ASSERT_EQ(conv.getValue().cols(), expected.getValue().cols());
+	EXPECT_TRUE(conv.getValue().isApprox(expected.getValue(), 1e-10));
+
+
+	// Gradients
+
+	ts::Gradient<double> expectedGrad = ts::squaredNorm(expected).grad();
+	ts::Gradient<double> grad = ts::squaredNorm(conv).grad();
+
+	EXPECT_TRUE(grad.getValue(ker).isApprox(expectedGrad.getValue(ker), 1e-10));
+	for(unsigned i=0; i<x.size(); i++) {
+		EXPECT_TRUE(
+			grad.getValue(x[i]).isApprox(expectedGrad.getValue(x[i]), 1e-10)
+		);
+	}
+}
+
+
+
 TEST(Convolution, Col2Im) {
 
 	ts::WengertList<float> wList;
@@ -428,6 +927,169 @@ TEST(Convolution, Col2Im) {
 
 
 
+TEST(Convolution, PackedMaps) {
+	// Compare im2col, col2im and pooling on packed maps to the same operations
+	// on channels vectors, for both values and gradients
+
+	unsigned rows = 7, cols = 6, channels = 3;
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> x_;
+	x_.setRandom(channels * rows, cols);
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> ker_;
+	ker_.setRandom(2, channels * 3 * 2);
+
+	ts::WengertList<double> wList;
+	ts::WengertList<double> refList;
+
+	ts::Tensor<double> x = ts::Tensor<double>(x_, &wList);
+	ts::Tensor<double> ker = ts::Tensor<double>(ker_, &wList);
+	ts::Tensor<double> refX = ts::Tensor<double>(x_, &refList);
+	ts::Tensor<double> refKer = ts::Tensor<double>(ker_, &refList);
+
+	std::vector<ts::Tensor<double>> refVec = ts::split(
+		refX, ts::ChannelSplit::SPLIT_HOR, channels
+	);
+
+	// Strided / padded / dilated convolution, back to maps
+	ts::Tensor<double> mat = ts::im2col(x, channels, {3, 2}, {2, 1}, {1, 1}, {1, 2});
+	ts::Tensor<double> refMat = ts::im2col(refVec, {3, 2}, {2, 1}, {1, 1}, {1, 2});
+	ASSERT_EQ(mat.getValue().rows(), refMat.getValue().rows());
+	ASSERT_EQ(mat.getValue().cols(), refMat.getValue().cols());
+	EXPECT_TRUE(mat.getValue().isApprox(refMat.getValue(), 1e-12));
+
+	std::vector<unsigned> outputDim = {4, 6};
+	ts::Tensor<double> maps = ts::packedCol2im(ts::matProd(ker, mat), outputDim);
+	ts::Tensor<double> refMaps = ts::vertCat(
+		ts::col2im(ts::matProd(refKer, refMat), outputDim)
+	);
+	EXPECT_TRUE(maps.getValue().isApprox(refMaps.getValue(), 1e-12));
+
+	// Overlapping max pooling and padded average pooling of each channel
+	ts::Tensor<double> maxPooled = ts::maxPooling(maps, {2, 3}, {2, 1}, {0, 0}, 2);
+	ts::Tensor<double> avgPooled = ts::averagePooling(maps, {3, 3}, {1, 1}, {1, 1}, 2);
+
+	std::vector<ts::Tensor<double>> refMapsVec = ts::col2im(
+		ts::matProd(refKer, refMat), outputDim
+	);
+	std::vector<ts::Tensor<double>> refMaxVec = {};
+	std::vector<ts::Tensor<double>> refAvgVec = {};
+	for(unsigned i=0; i<refMapsVec.size(); i++) {
+		refMaxVec.push_back(ts::maxPooling(refMapsVec[i], {2, 3}, {2, 1}));
+		refAvgVec.push_back(
+			ts::averagePooling(refMapsVec[i], {3, 3}, {1, 1}, {1, 1})
+		);
+	}
+	ts::Tensor<double> refMaxPooled = ts::vertCat(refMaxVec);
+	ts::Tensor<double> refAvgPooled = ts::vertCat(refAvgVec);
+
+	EXPECT_TRUE(maxPooled.getValue().isApprox(refMaxPooled.getValue(), 1e-12));
+	EXPECT_TRUE(avgPooled.getValue().isApprox(refAvgPooled.getValue(), 1e-12));
+
+
+	// Gradients
+
+	ts::Gradient<double> grad =
+	(ts::squaredNorm(maxPooled) + ts::squaredNorm(avgPooled)).grad();
+	ts::Gradient<double> refGrad =
+	(ts::squaredNorm(refMaxPooled) + ts::squaredNorm(refAvgPooled)).grad();
+
+	EXPECT_TRUE(grad.getValue(x).isApprox(refGrad.getValue(refX), 1e-10));
+	EXPECT_TRUE(grad.getValue(ker).isApprox(refGrad.getValue(refKer), 1e-10));
+
+
+	// The rows of the maps must be a multiple of the number of channels
+
+	EXPECT_EQ(ts::im2col(x, 4, {3, 3}).getValue().size(), 0);
+	EXPECT_EQ(ts::maxPooling(x, {2, 2}, {}, {0, 0}, 4).getValue().size(), 0);
+}
+
+
+
+TEST(Convolution, ConvBlock) {
+	// Compare fused convolution blocks (packed maps) to separate bias /
+	// activation / col2im / pooling operations on each channel, with and
+	// without pooling, for full and per-channel biases
+
+	ts::WengertList<double> wList;
+
+	// Some large |z| make sure sigmoid saturates instead of overflowing
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> conv_;
+	conv_.setRandom(3, 6 * 8);
+	conv_(0, 0) = 1000;
+	conv_(1, 9) = -1000;
+	conv_(2, 20) = 800;
+
+	ts::Tensor<double> conv = ts::Tensor<double>(conv_, &wList);
+	ts::Tensor<double> bias = ts::Tensor<double>(
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(3, 6 * 8),
+		&wList
+	);
+	ts::Tensor<double> channelBias = ts::Tensor<double>(
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(3, 1),
+		&wList
+	);
+
+	std::vector<ts::Tensor<double> (*)(const ts::Tensor<double>&)> activations = {
+		&(ts::relu), &(ts::leakyRelu), &(ts::sigmoid), &(ts::rescale)
+	};
+	std::vector<std::vector<unsigned>> pools = {
+		{2, 2}, {3, 2}, {0, 0}, {3, 3, 1, 1, (unsigned) ts::PoolingType::AVERAGE}
+	};
+
+	for(unsigned b=0; b<2; b++) {
+		for(unsigned i=0; i<activations.size(); i++) {
+			for(unsigned j=0; j<pools.size(); j++) {
+				std::vector<ts::Tensor<double>> expected = ts::col2im(
+					(*activations[i])(
+						b == 0 ? conv + bias : ts::broadcastAdd(conv, channelBias)
+					),
+					{6, 8}
+				);
+				for(unsigned k=0; k<expected.size(); k++) {
+					if(j < 2) {
+						expected[k] = ts::maxPooling(expected[k], pools[j]);
+					}
+					else if(j == 3) {
+						expected[k] = ts::averagePooling(expected[k], {3, 3}, {1, 1}, {1, 1});
+					}
+				}
+
+				ts::Tensor<double> res = ts::convBlock(
+					conv, b == 0 ? bias : channelBias, {6, 8}, pools[j], activations[i]
+				);
+				ts::Tensor<double> expectedMaps = ts::vertCat(expected);
+
+				ASSERT_EQ(res.getValue().rows(), expectedMaps.getValue().rows());
+				ASSERT_EQ(res.getValue().cols(), expectedMaps.getValue().cols());
+				EXPECT_FALSE(res.getValue().hasNaN());
+				EXPECT_TRUE(res.getValue().isApprox(expectedMaps.getValue(), 1e-12));
+
+				ts::Gradient<double> expectedGrad = ts::squaredNorm(expectedMaps).grad();
+				ts::Gradient<double> grad = ts::squaredNorm(res).grad();
+
+				EXPECT_TRUE(
+					grad.getValue(conv).isApprox(expectedGrad.getValue(conv), 1e-12)
+				);
+				EXPECT_TRUE(
+					grad.getValue(bias).isApprox(expectedGrad.getValue(bias), 1e-12) &&
+					grad.getValue(channelBias).isApprox(
+						expectedGrad.getValue(channelBias), 1e-12
+					)
+				);
+			}
+		}
+	}
+
+
+	// Output size must be a multiple of the pooling size
+
+	EXPECT_EQ(
+		ts::convBlock(conv, bias, {6, 8}, {4, 4}, &(ts::relu)).getValue().size(), 0
+	);
+}
+
+
+
 int main(int argc, char **argv) {
 	std::cout << "*** CONVOLUTION TEST SUITE ***" << std::endl;
 
@@ -7,6 +7,7 @@
 #include <gtest/gtest.h>
 #include <iostream>
 #include <math.h>
+#include <cstdio>
 
 #include "../include/tensorslow.h"
 
@@ -124,6 +125,59 @@ TEST(MultiLayerPerceptron, ForwardPass) {
 
 
 
+TEST(MultiLayerPerceptron, BatchNorm) {
+	// Running statistics are only updated in training mode, and folding the
+	// normalization into the weights doesn't change the outputs
+
+	ts::MultiLayerPerceptron<float> model(4, {5, 6, 2}, true);
+	ASSERT_EQ(model.norms.size(), 2);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x;
+	x.setRandom(4, 1);
+
+	model.training = true;
+	for(unsigned i=0; i<10; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> sample;
+		sample.setRandom(4, 1);
+		model.compute(ts::Tensor<float>(sample, &(model.wList)));
+		model.wList.reset();
+	}
+	model.training = false;
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> mean = model.norms[0].mean;
+	EXPECT_NE(mean.abs().sum(), 0);
+
+	ts::Tensor<float> output = model.compute(ts::Tensor<float>(x, &(model.wList)));
+	ASSERT_EQ(output.getValue().rows(), 2);
+	EXPECT_TRUE(model.norms[0].mean.isApprox(mean));
+
+	// Statistics are saved with the model
+	model.save("tests/mlp_norm.ts");
+	model.saveBinary("tests/mlp_norm.tsb");
+	ts::MultiLayerPerceptron<float> textModel =
+	ts::MultiLayerPerceptron<float>::fromFile("tests/mlp_norm.ts");
+	ts::MultiLayerPerceptron<float> binaryModel =
+	ts::MultiLayerPerceptron<float>::fromFile("tests/mlp_norm.tsb");
+	std::remove("tests/mlp_norm.ts");
+	std::remove("tests/mlp_norm.tsb");
+
+	ASSERT_EQ(textModel.norms.size(), 2);
+	EXPECT_TRUE(textModel.compute(ts::Tensor<float>(x, &(textModel.wList)))
+	.getValue().isApprox(output.getValue(), 1e-5));
+	EXPECT_TRUE(binaryModel.compute(ts::Tensor<float>(x, &(binaryModel.wList)))
+	.getValue().isApprox(output.getValue(), 1e-5));
+
+	// Folding
+	model.wList.reset();
+	model.foldBatchNorm();
+	EXPECT_EQ(model.norms.size(), 0);
+	EXPECT_EQ(model.wList.size(), 6);
+	EXPECT_TRUE(model.compute(ts::Tensor<float>(x, &(model.wList)))
+	.getValue().isApprox(output.getValue(), 1e-5));
+}
+
+
+
 TEST(Convolution, FullCNN) {
 
 	// Test a full CNN model (without fully connected layers) on a pre computed
@@ -244,6 +298,592 @@ TEST(Convolution, FullCNN) {
 
 
 
+TEST(Convolution, StridedCNN) {
+
+	// Build a CNN with strided / padded / dilated convolutions, and make sure
+	// its output dimensions are consistent
+
+	ts::ConvolutionalNetwork<float> model(
+		{17, 12},
+		ts::ChannelSplit::NOSPLIT, 1,
+		{{3, 3, 4, 2, 1, 1}, {3, 3, 2, 1, 0, 2}},
+		{{0, 0}, {0, 0}},
+		{3}
+	);
+
+	// 17x12 -> 9x6 -> 5x2
+	ASSERT_EQ(model.outputDims.size(), 2);
+	EXPECT_EQ(model.outputDims[0][0], 9);
+	EXPECT_EQ(model.outputDims[0][1], 6);
+	EXPECT_EQ(model.outputDims[1][0], 5);
+	EXPECT_EQ(model.outputDims[1][1], 2);
+	EXPECT_EQ(model.weights[0].getValue().cols(), 5 * 2 * 2);
+
+	ts::Tensor<float> x = ts::Tensor<float>(
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>().setRandom(17, 12),
+		&(model.wList)
+	);
+
+	ts::Tensor<float> output = model.compute(x);
+	ASSERT_EQ(output.getValue().rows(), 3);
+
+	// Implicit GEMM convolutions give the same output
+	model.setConvAlgorithms({
+		ts::ConvAlgorithm::IMPLICIT_GEMM, ts::ConvAlgorithm::IMPLICIT_GEMM
+	});
+	ts::Tensor<float> implicitOutput = model.compute(x);
+	EXPECT_TRUE(implicitOutput.getValue().isApprox(output.getValue(), 1e-5));
+
+	// Layers descriptions are completed with default values
+	ts::ConvolutionalNetwork<float> defaultModel(
+		{10, 10},
+		ts::ChannelSplit::NOSPLIT, 1,
+		{{3, 3, 2}},
+		{{2, 2}},
+		{}
+	);
+	ASSERT_EQ(defaultModel.kernelDims[0].size(), 7);
+	EXPECT_EQ(defaultModel.kernelDims[0][3], 1);
+	EXPECT_EQ(defaultModel.kernelDims[0][4], 0);
+	EXPECT_EQ(defaultModel.kernelDims[0][5], 1);
+	EXPECT_EQ(
+		defaultModel.kernelDims[0][6], (unsigned) ts::ConvLayerType::STANDARD
+	);
+
+	// Winograd and FFT convolutions give the same output (on an eligible
+	// layer)
+	ts::Tensor<float> defaultInput = ts::Tensor<float>(
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>().setRandom(10, 10),
+		&(defaultModel.wList)
+	);
+	ts::Tensor<float> defaultOutput = defaultModel.compute(defaultInput);
+	defaultModel.setConvAlgorithms({ts::ConvAlgorithm::WINOGRAD});
+	ts::Tensor<float> winogradOutput = defaultModel.compute(defaultInput);
+	EXPECT_TRUE(winogradOutput.getValue().isApprox(defaultOutput.getValue(), 1e-4));
+	defaultModel.setConvAlgorithms({ts::ConvAlgorithm::FFT});
+	ts::Tensor<float> fftOutput = defaultModel.compute(defaultInput);
+	EXPECT_TRUE(fftOutput.getValue().isApprox(defaultOutput.getValue(), 1e-4));
+}
+
+
+
+TEST(Convolution, ChannelBiases) {
+
+	// A CNN with per-channel biases computes the same outputs as a CNN with
+	// full biases of equal values, and its bias derivatives are the sums of
+	// the full ones
+
+	std::vector<std::vector<unsigned>> convLayers = {{3, 3, 3}, {3, 3, 2, 2, 1}};
+	std::vector<std::vector<unsigned>> poolingLayers = {{2, 2}, {0, 0}};
+
+	ts::ConvolutionalNetwork<float> model(
+		{2 * 12, 12}, ts::ChannelSplit::SPLIT_HOR, 2,
+		convLayers, poolingLayers, {4, 2}, true
+	);
+	ts::ConvolutionalNetwork<float> fullModel(
+		{2 * 12, 12}, ts::ChannelSplit::SPLIT_HOR, 2,
+		convLayers, poolingLayers, {4, 2}
+	);
+
+	ASSERT_EQ(model.convBiases.size(), 2);
+	for(unsigned i=0; i<model.convBiases.size(); i++) {
+		ASSERT_EQ(model.convBiases[i].getValue().cols(), 1);
+
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> bias;
+		bias.setRandom(model.convBiases[i].getValue().rows(), 1);
+		model.convBiases[i] = ts::Tensor<float>(bias, &(model.wList), true);
+
+		fullModel.convKernels[i] = ts::Tensor<float>(
+			model.convKernels[i].getValue(), &(fullModel.wList), true
+		);
+		fullModel.convBiases[i] = ts::Tensor<float>(
+			bias.replicate(1, fullModel.convBiases[i].getValue().cols()),
+			&(fullModel.wList), true
+		);
+	}
+	for(unsigned i=0; i<model.weights.size(); i++) {
+		fullModel.weights[i] = ts::Tensor<float>(
+			model.weights[i].getValue(), &(fullModel.wList), true
+		);
+		fullModel.fullBiases[i] = ts::Tensor<float>(
+			model.fullBiases[i].getValue(), &(fullModel.wList), true
+		);
+	}
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x;
+	x.setRandom(2 * 12, 12);
+
+	ts::Tensor<float> output = model.compute(ts::Tensor<float>(x, &(model.wList)));
+	ts::Tensor<float> fullOutput =
+	fullModel.compute(ts::Tensor<float>(x, &(fullModel.wList)));
+	EXPECT_TRUE(output.getValue().isApprox(fullOutput.getValue(), 1e-5));
+
+	ts::Gradient<float> grad = ts::squaredNorm(output).grad();
+	ts::Gradient<float> fullGrad = ts::squaredNorm(fullOutput).grad();
+	for(unsigned i=0; i<model.convBiases.size(); i++) {
+		EXPECT_TRUE(grad.getValue(model.convBiases[i]).isApprox(
+			fullGrad.getValue(fullModel.convBiases[i]).rowwise().sum(), 1e-4
+		));
+	}
+
+	// Per-channel biases are kept when saving / loading the model
+	model.save("tests/channel_biases.ts");
+	ts::ConvolutionalNetwork<float> loaded =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/channel_biases.ts");
+	std::remove("tests/channel_biases.ts");
+
+	ASSERT_EQ(loaded.convBiases.size(), 2);
+	EXPECT_EQ(loaded.convBiases[0].getValue().cols(), 1);
+	ts::Tensor<float> loadedOutput =
+	loaded.compute(ts::Tensor<float>(x, &(loaded.wList)));
+	EXPECT_TRUE(loadedOutput.getValue().isApprox(output.getValue(), 1e-5));
+}
+
+
+
+TEST(Convolution, DepthwiseSeparableCNN) {
+
+	// A depthwise separable layer computes a depthwise convolution followed
+	// by a pointwise one, with fewer parameters than a standard layer
+
+	unsigned separable = (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE;
+
+	ts::ConvolutionalNetwork<float> model(
+		{2 * 12, 12}, ts::ChannelSplit::SPLIT_HOR, 2,
+		{{3, 3, 4}, {3, 3, 6, 1, 1, 1, separable}},
+		{{2, 2}, {0, 0}},
+		{3}
+	);
+
+	ASSERT_EQ(model.pointwiseKernels.size(), 2);
+	EXPECT_EQ(model.pointwiseKernels[0].getValue().size(), 0);
+	EXPECT_EQ(model.convKernels[1].getValue().rows(), 4);
+	EXPECT_EQ(model.convKernels[1].getValue().cols(), 3 * 3);
+	EXPECT_EQ(model.pointwiseKernels[1].getValue().rows(), 6);
+	EXPECT_EQ(model.pointwiseKernels[1].getValue().cols(), 4);
+	EXPECT_EQ(model.outputDims[1][0], 5);
+	EXPECT_EQ(model.outputDims[1][1], 5);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x;
+	x.setRandom(2 * 12, 12);
+	ts::Tensor<float> output = model.compute(ts::Tensor<float>(x, &(model.wList)));
+	ASSERT_EQ(output.getValue().rows(), 3);
+
+	// Same output with the explicit ops
+	ts::Tensor<float> maps = ts::convBlock(
+		ts::matProd(
+			model.convKernels[0],
+			ts::im2col(
+				ts::split(
+					ts::Tensor<float>(x, &(model.wList)), ts::ChannelSplit::SPLIT_HOR, 2
+				),
+				{3, 3}
+			)
+		),
+		model.convBiases[0], model.outputDims[0], model.pooling[0],
+		model.convActivation
+	);
+	ts::Tensor<float> conv = ts::matProd(
+		model.pointwiseKernels[1],
+		ts::depthwiseConv(
+			model.convKernels[1], ts::split(maps, ts::ChannelSplit::SPLIT_HOR, 4),
+			{3, 3}, {1, 1}, {1, 1}
+		)
+	);
+	maps = ts::convBlock(
+		conv, model.convBiases[1], model.outputDims[1], model.pooling[1],
+		model.convActivation
+	);
+	ts::Tensor<float> expected = ts::sigmoid(
+		ts::matProd(model.weights[0], ts::flattening(maps)) +
+		model.fullBiases[0]
+	);
+	EXPECT_TRUE(output.getValue().isApprox(expected.getValue(), 1e-5));
+
+	// Pointwise kernels are trained
+	ts::Gradient<float> grad = ts::squaredNorm(output).grad();
+	EXPECT_EQ(grad.getValue(model.pointwiseKernels[1]).rows(), 6);
+
+	// Batched prediction goes through the same layers
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> batch =
+	model.computeBatch(x, {2 * 12, 12}, {{0, 0}});
+	ASSERT_EQ(batch.cols(), 1);
+	EXPECT_TRUE(batch.col(0).isApprox(output.getValue().col(0), 1e-5));
+
+	// Layer types and pointwise kernels are kept when saving / loading
+	model.save("tests/depthwise.ts");
+	ts::ConvolutionalNetwork<float> loaded =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/depthwise.ts");
+	std::remove("tests/depthwise.ts");
+
+	ASSERT_EQ(loaded.pointwiseKernels.size(), 2);
+	EXPECT_EQ(loaded.kernelDims[1][6], separable);
+	ts::Tensor<float> loadedOutput =
+	loaded.compute(ts::Tensor<float>(x, &(loaded.wList)));
+	EXPECT_TRUE(loadedOutput.getValue().isApprox(output.getValue(), 1e-5));
+}
+
+
+
+TEST(Convolution, GlobalPoolingCNN) {
+
+	// With global average pooling, the dense head only gets the mean of each
+	// channel of the last feature maps
+
+	ts::ConvolutionalNetwork<float> model(
+		{2 * 14, 14}, ts::ChannelSplit::SPLIT_HOR, 2,
+		{{3, 3, 4}, {3, 3, 5}},
+		{{2, 2}, {0, 0}},
+		{6, 3}, false, true
+	);
+
+	EXPECT_TRUE(model.globalPooling);
+	ASSERT_EQ(model.weights[0].getValue().cols(), 5);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x;
+	x.setRandom(2 * 14, 14);
+	ts::Tensor<float> output = model.compute(ts::Tensor<float>(x, &(model.wList)));
+	ASSERT_EQ(output.getValue().rows(), 3);
+
+	// Same output with the explicit ops
+	ts::Tensor<float> maps = ts::convBlock(
+		ts::matProd(
+			model.convKernels[0],
+			ts::im2col(ts::Tensor<float>(x, &(model.wList)), 2, {3, 3})
+		),
+		model.convBiases[0], model.outputDims[0], model.pooling[0],
+		model.convActivation
+	);
+	maps = ts::convBlock(
+		ts::matProd(model.convKernels[1], ts::im2col(maps, 4, {3, 3})),
+		model.convBiases[1], model.outputDims[1], model.pooling[1],
+		model.convActivation
+	);
+	ts::Tensor<float> hidden = ts::relu(
+		ts::matProd(model.weights[0], ts::globalAveragePooling(maps, 5)) +
+		model.fullBiases[0]
+	);
+	ts::Tensor<float> expected = ts::sigmoid(
+		ts::matProd(model.weights[1], hidden) + model.fullBiases[1]
+	);
+	EXPECT_TRUE(output.getValue().isApprox(expected.getValue(), 1e-5));
+
+	// Batched prediction
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> batch =
+	model.computeBatch(x, {2 * 14, 14}, {{0, 0}});
+	ASSERT_EQ(batch.cols(), 1);
+	EXPECT_TRUE(batch.col(0).isApprox(output.getValue().col(0), 1e-5));
+
+	// The option is kept in both file formats
+	model.save("tests/global_pooling.ts");
+	model.saveBinary("tests/global_pooling.tsb");
+	ts::ConvolutionalNetwork<float> textModel =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/global_pooling.ts");
+	ts::ConvolutionalNetwork<float> binaryModel =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/global_pooling.tsb");
+	std::remove("tests/global_pooling.ts");
+	std::remove("tests/global_pooling.tsb");
+
+	EXPECT_TRUE(textModel.globalPooling);
+	EXPECT_TRUE(binaryModel.globalPooling);
+	EXPECT_TRUE(textModel.compute(ts::Tensor<float>(x, &(textModel.wList)))
+	.getValue().isApprox(output.getValue(), 1e-5));
+	EXPECT_TRUE(binaryModel.compute(ts::Tensor<float>(x, &(binaryModel.wList)))
+	.getValue().isApprox(output.getValue(), 1e-5));
+}
+
+
+
+TEST(Convolution, BatchNormCNN) {
+
+	// Normalization of standard and depthwise separable convolutions and of
+	// hidden dense layers, folded into their kernels and weights
+
+	ts::ConvolutionalNetwork<float> model(
+		{2 * 12, 12}, ts::ChannelSplit::SPLIT_HOR, 2,
+		{{3, 3, 4}, {3, 3, 5, 1, 1, 1, (unsigned) ts::ConvLayerType::DEPTHWISE_SEPARABLE}},
+		{{2, 2}, {0, 0}},
+		{6, 3}, true, false, true
+	);
+	ASSERT_EQ(model.convNorms.size(), 2);
+	ASSERT_EQ(model.denseNorms.size(), 1);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> x;
+	x.setRandom(2 * 24, 24);
+
+	model.training = true;
+	for(unsigned i=0; i<5; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> sample;
+		sample.setRandom(2 * 12, 12);
+		model.compute(ts::Tensor<float>(sample, &(model.wList)));
+		model.wList.reset();
+	}
+	model.training = false;
+
+	std::vector<std::vector<unsigned>> regions = {{0, 0}, {3, 5}, {12, 12}};
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> batch =
+	model.computeBatch(x, {2 * 12, 12}, regions);
+	ASSERT_EQ(batch.cols(), 3);
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> window(2 * 12, 12);
+	window << x.block(3, 5, 12, 12), x.block(24 + 3, 5, 12, 12);
+	ts::Tensor<float> output =
+	model.compute(ts::Tensor<float>(window, &(model.wList)));
+	EXPECT_TRUE(batch.col(1).isApprox(output.getValue().col(0), 1e-5));
+
+	// Statistics are saved with the model
+	model.save("tests/cnn_norm.ts");
+	model.saveBinary("tests/cnn_norm.tsb");
+	ts::ConvolutionalNetwork<float> textModel =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/cnn_norm.ts");
+	ts::ConvolutionalNetwork<float> binaryModel =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/cnn_norm.tsb");
+	std::remove("tests/cnn_norm.ts");
+	std::remove("tests/cnn_norm.tsb");
+
+	ASSERT_EQ(textModel.convNorms.size(), 2);
+	ASSERT_EQ(binaryModel.denseNorms.size(), 1);
+	EXPECT_TRUE(textModel.computeBatch(x, {2 * 12, 12}, regions)
+	.isApprox(batch, 1e-5));
+	EXPECT_TRUE(binaryModel.computeBatch(x, {2 * 12, 12}, regions)
+	.isApprox(batch, 1e-5));
+
+	// Folding
+	model.wList.reset();
+	model.foldBatchNorm();
+	EXPECT_EQ(model.convNorms.size(), 0);
+	EXPECT_EQ(model.denseNorms.size(), 0);
+	EXPECT_TRUE(model.computeBatch(x, {2 * 12, 12}, regions)
+	.isApprox(batch, 1e-5));
+	EXPECT_TRUE(model.compute(ts::Tensor<float>(window, &(model.wList)))
+	.getValue().isApprox(output.getValue(), 1e-5));
+}
+
+
+
+TEST(Convolution, Autotune) {
+
+	// Autotune a CNN, then make sure later runs reuse the cached results
+
+	std::remove("tests/autotune.cache");
+
+	ts::ConvolutionalNetwork<float> model(
+		{20, 20},
+		ts::ChannelSplit::NOSPLIT, 1,
+		{{3, 3, 4}, {5, 5, 4, 2, 1, 1}},
+		{{0, 0}, {0, 0}},
+		{3}
+	);
+
+	model.autotune("tests/autotune.cache");
+	ASSERT_EQ(model.getConvAlgorithms().size(), 2);
+
+	// Strided layers are not eligible for Winograd or FFT
+	EXPECT_TRUE(
+		model.getConvAlgorithms()[1] == ts::ConvAlgorithm::IM2COL ||
+		model.getConvAlgorithms()[1] == ts::ConvAlgorithm::IMPLICIT_GEMM
+	);
+
+	std::vector<std::string> keys = {};
+	std::ifstream in("tests/autotune.cache");
+	std::string key;
+	int algorithm;
+	while(in >> key >> algorithm) {
+		keys.push_back(key);
+	}
+	in.close();
+	ASSERT_EQ(keys.size(), 2);
+
+	// Force the implicit GEMM in the cache
+	std::ofstream out("tests/autotune.cache");
+	for(unsigned i=0; i<keys.size(); i++) {
+		out << keys[i] << " " << (int) ts::ConvAlgorithm::IMPLICIT_GEMM << std::endl;
+	}
+	out.close();
+
+	ts::ConvolutionalNetwork<float> newModel(
+		{20, 20},
+		ts::ChannelSplit::NOSPLIT, 1,
+		{{3, 3, 4}, {5, 5, 4, 2, 1, 1}},
+		{{0, 0}, {0, 0}},
+		{3}
+	);
+	newModel.autotune("tests/autotune.cache");
+	ASSERT_EQ(newModel.getConvAlgorithms().size(), 2);
+	EXPECT_EQ(newModel.getConvAlgorithms()[0], ts::ConvAlgorithm::IMPLICIT_GEMM);
+	EXPECT_EQ(newModel.getConvAlgorithms()[1], ts::ConvAlgorithm::IMPLICIT_GEMM);
+
+	// The tuned model still computes the same output
+	ts::Tensor<float> x = ts::Tensor<float>(
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>().setRandom(20, 20),
+		&(newModel.wList)
+	);
+	ts::Tensor<float> output = newModel.compute(x);
+	newModel.setConvAlgorithms({});
+	EXPECT_TRUE(newModel.compute(x).getValue().isApprox(output.getValue(), 1e-5));
+
+	// Layers are keyed by the actual input size, which is saved with the
+	// model (a 21x21 input would give the same strided first layer output)
+	ts::ConvolutionalNetwork<float> strided(
+		{22, 22},
+		ts::ChannelSplit::NOSPLIT, 1,
+		{{3, 3, 2, 2}},
+		{{0, 0}},
+		{2}
+	);
+	strided.save("tests/strided.ts");
+	ts::ConvolutionalNetwork<float> loaded =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/strided.ts");
+	std::remove("tests/strided.ts");
+	EXPECT_EQ(loaded.inputSize, std::vector<unsigned>({22, 22}));
+
+	std::remove("tests/autotune.cache");
+	loaded.autotune("tests/autotune.cache");
+	in.open("tests/autotune.cache");
+	ASSERT_TRUE(in >> key >> algorithm);
+	in.close();
+	std::remove("tests/autotune.cache");
+	EXPECT_EQ(key.substr(0, 6), "22x22/");
+}
+
+
+
+TEST(Convolution, DensePrediction) {
+
+	// Compare dense predictions to window by window computations, when all
+	// layers are shared, when only the first convolution is shared (biases
+	// depend on positions) and when nothing is shared (padding)
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> image;
+	image.setRandom(2 * 22, 19);	// 2 channels of 22x19
+
+	std::vector<std::vector<std::vector<unsigned>>> convLayers = {
+		{{3, 3, 3}, {3, 3, 2}},
+		{{3, 3, 3}, {3, 3, 2}},
+		{{3, 3, 3, 1, 1, 1}, {3, 3, 2}}
+	};
+
+	for(unsigned n=0; n<convLayers.size(); n++) {
+		ts::ConvolutionalNetwork<float> model(
+			{2 * 12, 12},
+			ts::ChannelSplit::SPLIT_HOR, 2,
+			convLayers[n],
+			{{2, 2}, {0, 0}},
+			{4, 2}
+		);
+
+		for(unsigned i=0; i<model.convBiases.size(); i++) {
+			Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> bias =
+			model.convBiases[i].getValue();
+
+			// Same bias for all positions of a channel, except for the 2nd model
+			if(n == 1) {
+				bias.setRandom();
+			}
+			else {
+				Eigen::Array<float, Eigen::Dynamic, 1> channelBias;
+				channelBias.setRandom(bias.rows());
+				bias = channelBias.replicate(1, bias.cols());
+			}
+
+			model.convBiases[i] = ts::Tensor<float>(bias, &(model.wList), true);
+		}
+
+		std::vector<Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>> dense =
+		model.computeDense(image, {2 * 12, 12}, {2, 4});
+
+		ASSERT_EQ(dense.size(), 2);
+		ASSERT_EQ(dense[0].rows(), 6);
+		ASSERT_EQ(dense[0].cols(), 2);
+
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> window;
+		window.resize(2 * 12, 12);
+
+		for(unsigned i=0; i<dense[0].rows(); i++) {
+			for(unsigned j=0; j<dense[0].cols(); j++) {
+				window.block(0, 0, 12, 12) = image.block(i * 2, j * 4, 12, 12);
+				window.block(12, 0, 12, 12) = image.block(22 + i * 2, j * 4, 12, 12);
+
+				ts::Tensor<float> output = model.compute(
+					ts::Tensor<float>(window, &(model.wList))
+				);
+
+				EXPECT_NEAR(dense[0](i, j), output.getValue()(0, 0), 1e-5);
+				EXPECT_NEAR(dense[1](i, j), output.getValue()(1, 0), 1e-5);
+
+				model.wList.reset();
+			}
+		}
+	}
+}
+
+
+
+TEST(Convolution, BatchPrediction) {
+
+	// Compare batched predictions of random regions (more than one batch) to
+	// region by region computations, with non-overlapping max pooling and
+	// with overlapping, padded average pooling
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> image;
+	image.setRandom(25, 2 * 30);	// 2 channels of 25x30
+
+	std::vector<std::vector<std::vector<unsigned>>> pools = {
+		{{2, 2}, {0, 0}},
+		{{3, 3, 1, 1, (unsigned) ts::PoolingType::AVERAGE}, {0, 0}}
+	};
+
+	for(unsigned i=0; i<pools.size(); i++) {
+		ts::ConvolutionalNetwork<float> model(
+			{12, 2 * 14},
+			ts::ChannelSplit::SPLIT_VERT, 2,
+			{{3, 3, 3}, {3, 3, 2, 2, 1}},
+			pools[i],
+			{4, 2}
+		);
+
+		// Batches are computed with the layers algorithms too
+		if(i == 1) {
+			model.setConvAlgorithms({
+				ts::ConvAlgorithm::WINOGRAD, ts::ConvAlgorithm::IMPLICIT_GEMM
+			});
+		}
+
+		std::vector<std::vector<unsigned>> regions = {};
+		for(unsigned k=0; k<TS_BATCH_SIZE + 6; k++) {
+			regions.push_back({(unsigned) rand() % 14, (unsigned) rand() % 17});
+		}
+
+		int tapeSize = model.wList.size();
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> batch =
+		model.computeBatch(image, {12, 2 * 14}, regions);
+
+		ASSERT_EQ(batch.rows(), 2);
+		ASSERT_EQ(batch.cols(), regions.size());
+		EXPECT_EQ(model.wList.size(), tapeSize);
+
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> window;
+		window.resize(12, 2 * 14);
+
+		for(unsigned k=0; k<regions.size(); k++) {
+			window.block(0, 0, 12, 14) = image.block(regions[k][0], regions[k][1], 12, 14);
+			window.block(0, 14, 12, 14) =
+			image.block(regions[k][0], 30 + regions[k][1], 12, 14);
+
+			ts::Tensor<float> output = model.compute(
+				ts::Tensor<float>(window, &(model.wList))
+			);
+
+			EXPECT_NEAR(batch(0, k), output.getValue()(0, 0), 1e-5);
+			EXPECT_NEAR(batch(1, k), output.getValue()(1, 0), 1e-5);
+
+			model.wList.reset();
+		}
+	}
+}
+
+
+
 int main(int argc, char **argv) {
 	std::cout << "*** MODELS TEST SUITE ***" << std::endl;
 
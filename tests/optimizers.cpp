@@ -119,6 +119,202 @@ TEST(GradientDescent, Polynom) {
 
 
 
+TEST(GradientDescent, WinogradCNN) {
+	// The Winograd kernel transforms of a CNN must follow its updates
+
+	ts::ConvolutionalNetwork<double> model(
+		{8, 8},
+		ts::ChannelSplit::NOSPLIT, 1,
+		{{3, 3, 2, 1, 1}},
+		{{2, 2}},
+		{2}
+	);
+	model.setConvAlgorithms({ts::ConvAlgorithm::WINOGRAD});
+	model.toggleGlobalOptimize(true);
+
+	ts::GradientDescentOptimizer<double> optimizer(0.5);
+
+	std::vector<ts::TrainingData<double>> batch = {};
+	for(unsigned i=0; i<4; i++) {
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> input =
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(8, 8);
+
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> expected =
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(2, 1);
+
+		batch.push_back(ts::TrainingData<double>(input, expected));
+	}
+
+	optimizer.startSession(model);
+	for(unsigned i=0; i<3; i++) {
+		optimizer.step(batch);
+	}
+	optimizer.endSession();
+
+	ts::Tensor<double> input(batch[0].input, &(model.wList));
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> output =
+	model.compute(input).getValue();
+	model.wList.reset();
+
+	model.setConvAlgorithms({});
+	input = ts::Tensor<double>(batch[0].input, &(model.wList));
+	EXPECT_TRUE(model.compute(input).getValue().isApprox(output, 1e-10));
+}
+
+
+
+TEST(Adam, OnlineSteps) {
+	// Train a model incrementally with the session / step API, as if batches
+	// were coming from a stream
+
+	ts::Polynom<float> model(1, {2, 2});
+	model.toggleGlobalOptimize(true);
+
+	ts::AdamOptimizer<float> optimizer;
+	optimizer.alpha = 0.05;
+
+
+	// Step outside of a session should do nothing
+
+	std::vector<ts::TrainingData<float>> batch = {};
+	for(unsigned i=0; i<5; i++) {
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> input =
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>()
+		.setRandom(model.rows(), model.cols());
+
+		batch.push_back(ts::TrainingData<float>(input, 3.0f * input + 1.0f));
+	}
+
+	EXPECT_EQ(optimizer.step(batch).size(), 0);
+
+
+	// Run steps and make sure the loss is decreasing
+
+	optimizer.startSession(model);
+
+	std::vector<float> firstLosses = optimizer.step(batch);
+	ASSERT_EQ(firstLosses.size(), batch.size());
+
+	std::vector<float> lastLosses;
+	for(unsigned i=0; i<200; i++) {
+		lastLosses = optimizer.step(batch);
+	}
+
+	optimizer.endSession();
+
+	float firstSum = 0;
+	float lastSum = 0;
+	for(unsigned i=0; i<batch.size(); i++) {
+		firstSum += firstLosses[i];
+		lastSum += lastLosses[i];
+	}
+
+	EXPECT_LT(lastSum, firstSum);
+
+	// wList should only contain the model's coefficients
+	EXPECT_EQ(model.wList.size(), 2);
+}
+
+
+
+TEST(Adam, Classification) {
+	// Train a MLP on labeled data (softmax cross entropy on its logits)
+
+	ts::MultiLayerPerceptron<float> model(2, {8, 2});
+	model.finalActivation = &(ts::identity);
+	model.toggleGlobalOptimize(true);
+
+	ts::AdamOptimizer<float> optimizer;
+	optimizer.alpha = 0.02;
+
+	std::vector<ts::TrainingData<float>> batch = {};
+	for(unsigned i=0; i<20; i++) {
+		// Classes are separated by a margin around x = 0
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> input =
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic>().setRandom(2, 1);
+		input(0, 0) += input(0, 0) > 0 ? 0.5 : -0.5;
+
+		batch.push_back(ts::TrainingData<float>(input, input(0, 0) > 0 ? 1 : 0));
+	}
+
+	optimizer.startSession(model);
+
+	std::vector<float> firstLosses = optimizer.step(batch);
+	ASSERT_EQ(firstLosses.size(), batch.size());
+
+	std::vector<float> lastLosses;
+	for(unsigned i=0; i<200; i++) {
+		lastLosses = optimizer.step(batch);
+	}
+
+	optimizer.endSession();
+
+	float firstSum = 0;
+	float lastSum = 0;
+	for(unsigned i=0; i<batch.size(); i++) {
+		firstSum += firstLosses[i];
+		lastSum += lastLosses[i];
+	}
+
+	EXPECT_LT(lastSum, firstSum);
+
+	// Predictions on the training data
+	unsigned nSuccesses = 0;
+	for(unsigned i=0; i<batch.size(); i++) {
+		ts::Tensor<float> input(batch[i].input, &(model.wList));
+		Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> output =
+		model.compute(input).getValue();
+		model.wList.reset();
+
+		unsigned prediction = output(1, 0) > output(0, 0) ? 1 : 0;
+		nSuccesses += prediction == batch[i].label;
+	}
+
+	EXPECT_GE(nSuccesses, 18);
+}
+
+
+
+TEST(Adam, Checkpoints) {
+	// Checkpoints written during a session should contain the latest
+	// parameters once the session is over
+
+	ts::MultiLayerPerceptron<double> model(3, {4, 2});
+	model.toggleGlobalOptimize(true);
+
+	ts::AdamOptimizer<double> optimizer;
+	optimizer.checkpointEvery = 3;
+	optimizer.checkpointPath = "tests/checkpoint.tsb";
+
+	std::vector<ts::TrainingData<double>> batch = {};
+	for(unsigned i=0; i<4; i++) {
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> input =
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(3, 1);
+
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> expected =
+		Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic>().setRandom(2, 1);
+
+		batch.push_back(ts::TrainingData<double>(input, expected));
+	}
+
+	optimizer.startSession(model);
+	for(unsigned i=0; i<9; i++) {
+		optimizer.step(batch);
+	}
+	optimizer.endSession();
+
+	ts::MultiLayerPerceptron<double> checkpoint =
+	ts::MultiLayerPerceptron<double>::fromFile("tests/checkpoint.tsb");
+
+	ASSERT_EQ(checkpoint.weights.size(), model.weights.size());
+	for(unsigned i=0; i<model.weights.size(); i++) {
+		EXPECT_TRUE((checkpoint.weights[i].getValue() == model.weights[i].getValue()).all());
+		EXPECT_TRUE((checkpoint.biases[i].getValue() == model.biases[i].getValue()).all());
+	}
+}
+
+
+
 int main(int argc, char **argv) {
 	std::cout << "*** OPTIMIZERS TEST SUITE ***" << std::endl;
 
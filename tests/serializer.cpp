@@ -5,6 +5,7 @@
 
 #include <gtest/gtest.h>
 #include <iostream>
+#include <sstream>
 
 #include "../include/tensorslow.h"
 
@@ -99,6 +100,77 @@ TEST(Utilities, Vector) {
 
 
 
+TEST(Utilities, DoublePrecision) {
+	// Doubles must survive a text round trip without any precision loss, and
+	// the parser must still accept files written by older versions (Eigen
+	// formatting with 6 significant digits)
+
+	ts::WengertList<double> wList;
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> arr;
+	arr.setRandom(7, 13);
+	arr(0, 0) = 1.0 / 3.0;
+	arr(1, 0) = -1e-300;
+	arr(2, 0) = 12345678.123456789;
+	ts::Tensor<double> a(arr, &wList);
+
+	std::ofstream out("tests/double.ts");
+	out << ts::serializeTensor(a) << std::endl;
+	out << "2\n3\n0.333333,-1e-05,2,4,5,6\n";
+	out << "1\n2\n1,2\n";
+	out.close();
+
+	std::ifstream in("tests/double.ts");
+	ts::Tensor<double> b = ts::parseTensor(in, &wList);
+	ts::Tensor<double> c = ts::parseTensor(in, &wList);
+	ts::Tensor<double> d = ts::parseTensor(in, &wList);
+	in.close();
+
+	ASSERT_EQ(b.getValue().rows(), 7);
+	ASSERT_EQ(b.getValue().cols(), 13);
+	for(unsigned i=0; i<7; i++) {
+		for(unsigned j=0; j<13; j++) {
+			EXPECT_EQ(arr(i, j), b.getValue()(i, j));
+		}
+	}
+
+	ASSERT_EQ(c.getValue().rows(), 2);
+	ASSERT_EQ(c.getValue().cols(), 3);
+	EXPECT_EQ(c.getValue()(0, 0), 0.333333);
+	EXPECT_EQ(c.getValue()(0, 1), -1e-05);
+	EXPECT_EQ(c.getValue()(1, 0), 4.0);
+	EXPECT_EQ(c.getValue()(0, 2), 2.0);
+
+	ASSERT_EQ(d.getValue().rows(), 1);
+	EXPECT_EQ(d.getValue()(0, 1), 2.0);
+}
+
+
+
+TEST(Utilities, InvalidNumbers) {
+	// Tokens that are only partially numbers, or too long to be read at once,
+	// must be rejected without shifting the following numbers
+
+	std::string longToken(70, '1');
+	std::istringstream in("1.5x,12abc 7\n" + longToken + ",3\n");
+
+	double d;
+	unsigned u;
+
+	EXPECT_FALSE(ts::readNumber(in.rdbuf(), d));
+	EXPECT_FALSE(ts::readNumber(in.rdbuf(), u));
+	ASSERT_TRUE(ts::readNumber(in.rdbuf(), u));
+	EXPECT_EQ(u, 7);
+
+	EXPECT_FALSE(ts::readNumber(in.rdbuf(), d));
+	ASSERT_TRUE(ts::readNumber(in.rdbuf(), d));
+	EXPECT_EQ(d, 3.0);
+
+	EXPECT_FALSE(ts::readNumber(in.rdbuf(), d));
+}
+
+
+
 TEST(Models, Polynom) {
 	// Try to save and load a ts::Polynom
 
@@ -220,6 +292,178 @@ TEST(Models, ConvolutionalNetwork) {
 
 
 
+TEST(Binary, ConvolutionalNetwork) {
+	// Save and load a ts::ConvolutionalNetwork with the binary format
+
+	ts::ConvolutionalNetwork<double> srcModel(
+		{30, 10},
+		ts::ChannelSplit::SPLIT_HOR, 3,
+		{{3, 3, 2}},
+		{{2,2}},
+		{5, 6}
+	);
+	srcModel.saveBinary("tests/cnn.tsb");
+
+	ts::ConvolutionalNetwork<double> dstModel(
+		{10, 10},
+		ts::ChannelSplit::NOSPLIT, 1,
+		{{3, 3, 4}},
+		{{0, 0}},
+		{2}
+	);
+	dstModel.loadBinary("tests/cnn.tsb");
+
+
+	// Parameters should be exactly the same (no precision loss)
+
+	ASSERT_EQ(srcModel.convKernels.size(), dstModel.convKernels.size());
+	ASSERT_EQ(srcModel.weights.size(), dstModel.weights.size());
+
+	for(unsigned i=0; i<srcModel.weights.size(); i++) {
+		ASSERT_EQ(srcModel.weights[i].getValue().rows(), dstModel.weights[i].getValue().rows());
+		ASSERT_EQ(srcModel.weights[i].getValue().cols(), dstModel.weights[i].getValue().cols());
+		EXPECT_TRUE((srcModel.weights[i].getValue() == dstModel.weights[i].getValue()).all());
+	}
+
+
+	// Compare outputs
+
+	Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> randomInput;
+	randomInput.setRandom(30, 10);
+
+	ts::Tensor<double> srcInput = ts::Tensor<double>(randomInput, &(srcModel.wList));
+	ts::Tensor<double> dstInput = ts::Tensor<double>(randomInput, &(dstModel.wList));
+
+	ts::Tensor<double> srcOutput = srcModel.compute(srcInput);
+	ts::Tensor<double> dstOutput = dstModel.compute(dstInput);
+
+	ASSERT_EQ(dstOutput.getValue().rows(), 6);
+
+	for(unsigned i=0; i<6; i++) {
+		EXPECT_EQ(srcOutput.getValue()(i, 0), dstOutput.getValue()(i, 0));
+	}
+}
+
+
+
+TEST(Models, FromFile) {
+	// Create models directly from text and binary files
+
+	ts::ConvolutionalNetwork<float> srcModel(
+		{30, 10},
+		ts::ChannelSplit::SPLIT_HOR, 3,
+		{{3, 3, 2}},
+		{{2,2}},
+		{5, 6}
+	);
+	srcModel.save("tests/cnn.ts");
+	srcModel.saveBinary("tests/cnn.tsb");
+
+	ts::ConvolutionalNetwork<float> textModel =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/cnn.ts");
+	ts::ConvolutionalNetwork<float> binaryModel =
+	ts::ConvolutionalNetwork<float>::fromFile("tests/cnn.tsb");
+
+	// Only the parameters should be in the wLists
+	unsigned nParameters =
+	2 * srcModel.convKernels.size() + 2 * srcModel.weights.size();
+	ASSERT_EQ(textModel.wList.size(), nParameters);
+	ASSERT_EQ(binaryModel.wList.size(), nParameters);
+
+
+	// Compare outputs (parameters must survive a wList reset)
+
+	textModel.wList.reset();
+	binaryModel.wList.reset();
+
+	Eigen::Array<float, Eigen::Dynamic, Eigen::Dynamic> randomInput;
+	randomInput.setRandom(30, 10);
+
+	ts::Tensor<float> srcInput = ts::Tensor<float>(randomInput, &(srcModel.wList));
+	ts::Tensor<float> textInput = ts::Tensor<float>(randomInput, &(textModel.wList));
+	ts::Tensor<float> binaryInput = ts::Tensor<float>(randomInput, &(binaryModel.wList));
+
+	ts::Tensor<float> srcOutput = srcModel.compute(srcInput);
+	ts::Tensor<float> textOutput = textModel.compute(textInput);
+	ts::Tensor<float> binaryOutput = binaryModel.compute(binaryInput);
+
+	ASSERT_EQ(textOutput.getValue().rows(), 6);
+	ASSERT_EQ(binaryOutput.getValue().rows(), 6);
+
+	for(unsigned i=0; i<6; i++) {
+		EXPECT_EQ(srcOutput.getValue()(i, 0), textOutput.getValue()(i, 0));
+		EXPECT_EQ(srcOutput.getValue()(i, 0), binaryOutput.getValue()(i, 0));
+	}
+}
+
+
+
+TEST(Binary, Checksum) {
+	// A corrupted binary file should be rejected
+
+	ts::MultiLayerPerceptron<float> srcModel(4, {3});
+	srcModel.saveBinary("tests/mlp.tsb");
+
+	ts::ModelSnapshot<float> snapshot;
+	ASSERT_TRUE(ts::readBinarySnapshot("tests/mlp.tsb", snapshot));
+	ASSERT_EQ(snapshot.groups.size(), 3);	// Weights, biases, normalizations
+
+
+	// Flip one byte of the last tensor
+
+	std::fstream file("tests/mlp.tsb", std::ios::binary | std::ios::in | std::ios::out);
+	file.seekg(-1, std::ios::end);
+	char c = file.get();
+	file.seekp(-1, std::ios::end);
+	file.put(c ^ 0x01);
+	file.close();
+
+	EXPECT_FALSE(ts::readBinarySnapshot("tests/mlp.tsb", snapshot));
+	EXPECT_EQ(snapshot.groups.size(), 0);
+}
+
+
+
+TEST(Binary, CorruptSizes) {
+	// Sizes that overflow the bounds checks should be rejected
+
+	ts::MultiLayerPerceptron<float> srcModel(4, {3});
+	ts::ModelSnapshot<float> snapshot;
+
+
+	// Metadata size wrapping the tables size in 32 bits
+
+	srcModel.saveBinary("tests/mlp.tsb");
+
+	std::fstream file("tests/mlp.tsb", std::ios::binary | std::ios::in | std::ios::out);
+	uint32_t metadataSize = 0xFFFFFFFF;
+	file.seekp(16);
+	file.write((const char *) &metadataSize, sizeof(uint32_t));
+	file.close();
+
+	EXPECT_FALSE(ts::readBinarySnapshot("tests/mlp.tsb", snapshot));
+
+
+	// Tensor size wrapping in 64 bits (2^62 * 4 rows * 4 bytes)
+
+	srcModel.saveBinary("tests/mlp.tsb");
+
+	file.open("tests/mlp.tsb", std::ios::binary | std::ios::in | std::ios::out);
+	uint32_t sizes[2];
+	file.seekg(16);
+	file.read((char *) sizes, sizeof(sizes));
+
+	uint64_t rows = 1ULL << 62;
+	file.seekp(64 + (sizes[0] + sizes[1]) * sizeof(uint32_t));
+	file.write((const char *) &rows, sizeof(uint64_t));
+	file.close();
+
+	EXPECT_FALSE(ts::readBinarySnapshot("tests/mlp.tsb", snapshot));
+	EXPECT_EQ(snapshot.groups.size(), 0);
+}
+
+
+
 int main(int argc, char **argv) {
 	std::cout << "*** SERIALIZER TEST SUITE ***" << std::endl;
 